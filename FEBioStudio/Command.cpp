@@ -98,3 +98,10 @@ void CCmdGroup::SetViewState(VIEW_STATE state)
 	CCommand::SetViewState(state);
 	for (int i = 0; i < m_Cmd.size(); i++) m_Cmd[i]->SetViewState(state);
 }
+
+size_t CCmdGroup::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (int i = 0; i < m_Cmd.size(); i++) mem += m_Cmd[i]->MemoryUsage();
+	return mem;
+}
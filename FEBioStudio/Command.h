@@ -81,6 +81,9 @@ public:
 	virtual void SetViewState(VIEW_STATE state);
 	VIEW_STATE GetViewState();
 
+	// estimate of the memory (in bytes) held by this command for undo/redo
+	virtual size_t MemoryUsage() const { return 0; }
+
 protected:
 	// doc/view state variables
 	VIEW_STATE	m_state;
@@ -113,6 +116,8 @@ public:
 
 	void SetViewState(VIEW_STATE state) override;
 
+	size_t MemoryUsage() const override;
+
 protected:
 	CCmdPtrArray	m_Cmd;	// array of pointer to commands
 };
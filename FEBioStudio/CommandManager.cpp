@@ -31,6 +31,14 @@ SOFTWARE.*/
 #include <GeomLib/GObject.h>
 
 std::string CBasicCmdManager::m_err;
+size_t CBasicCmdManager::m_maxMemory = 0;
+
+size_t CCmdStack::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (CCommand* pcmd : c) mem += pcmd->MemoryUsage();
+	return mem;
+}
 
 CBasicCmdManager::CBasicCmdManager()
 {
@@ -49,6 +57,8 @@ void CBasicCmdManager::AddCommand(CCommand* pcmd)
 	// clear the redo stack
 	int N = (int)m_Redo.size();
 	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+
+	TrimHistory();
 }
 
 bool CBasicCmdManager::DoCommand(CCommand* pcmd)
@@ -84,6 +94,8 @@ bool CBasicCmdManager::DoCommand(CCommand* pcmd)
 	int N = (int)m_Redo.size();
 	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
 
+	TrimHistory();
+
 	return true;
 }
 
@@ -128,6 +140,26 @@ void CBasicCmdManager::Clear()
 	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
 }
 
+void CBasicCmdManager::SetMemoryLimit(size_t maxBytes) { m_maxMemory = maxBytes; }
+size_t CBasicCmdManager::GetMemoryLimit() { return m_maxMemory; }
+
+void CBasicCmdManager::TrimHistory()
+{
+	if (m_maxMemory == 0) return;
+
+	// The redo stack was just cleared, so only the undo stack needs to be checked.
+	// We always keep the last command, so the user can undo it. 
+	size_t mem = m_Undo.MemoryUsage();
+	while ((mem > m_maxMemory) && (m_Undo.size() > 1))
+	{
+		CCommand* pcmd = m_Undo.bottom();
+		size_t cmdMem = pcmd->MemoryUsage();
+		m_Undo.pop_bottom();
+		delete pcmd;
+		mem -= cmdMem;
+	}
+}
+
 const char* CBasicCmdManager::GetUndoCmdName() { return (m_Undo.size() ? m_Undo.top()->GetName() : 0); }
 const char* CBasicCmdManager::GetRedoCmdName() { return (m_Redo.size() ? m_Redo.top()->GetName() : 0); }
 
@@ -207,6 +239,8 @@ bool CCommandManager::DoCommand(CCommand* pcmd)
 	int N = (int)m_Redo.size();
 	for (int i=0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
 
+	TrimHistory();
+
 	return true;
 }
 
@@ -31,7 +31,17 @@ SOFTWARE.*/
 class CCommand;
 class CUndoDocument;
 
-typedef std::stack<CCommand*> CCmdStack;
+// command stack that also gives access to the oldest command, 
+// so that the history can be trimmed.
+class CCmdStack : public std::stack<CCommand*>
+{
+public:
+	CCommand* bottom() { return c.front(); }
+	void pop_bottom() { c.pop_front(); }
+
+	// memory used by all commands on the stack
+	size_t MemoryUsage() const;
+};
 
 class CBasicCmdManager
 {
@@ -55,10 +65,20 @@ public:
 	const char* GetUndoCmdName();
 	const char* GetRedoCmdName();
 
+	// set the max memory (in bytes) that the undo history can use (0 = no limit)
+	static void SetMemoryLimit(size_t maxBytes);
+	static size_t GetMemoryLimit();
+
+protected:
+	// delete the oldest commands until the history fits in the memory limit
+	void TrimHistory();
+
 protected:
 	CCmdStack	m_Undo;	// the undo stack
 	CCmdStack	m_Redo;	// the redo stack
 
+	static size_t	m_maxMemory;	// memory limit for the undo history
+
 public:
 	static const std::string& GetErrorString() { return m_err; }
 	void SetErrorString(const std::string& err) { m_err = err; }
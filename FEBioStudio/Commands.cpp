@@ -2202,6 +2202,11 @@ void CCmdDeleteFESelection::UnExecute()
 	FSMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
 }
 
+size_t CCmdDeleteFESelection::MemoryUsage() const
+{
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 //=============================================================================
 // CCmdDeleteFESurfaceSelection
 //-----------------------------------------------------------------------------
@@ -2248,6 +2253,11 @@ void CCmdDeleteFESurfaceSelection::UnExecute()
 	FSSurfaceMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
 }
 
+size_t CCmdDeleteFESurfaceSelection::MemoryUsage() const
+{
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 //////////////////////////////////////////////////////////////////////
 // CCmdHideObject
 //////////////////////////////////////////////////////////////////////
@@ -2769,11 +2779,33 @@ CCmdApplyFEModifier::CCmdApplyFEModifier(FEModifier* pmod, GObject* po, FSGroup*
 
 	// store the old mesh
 	m_pold = po->GetFEMesh();
+	m_bdelta = false;
+}
+
+//-----------------------------------------------------------------------------
+// Apply a mesh delta to the object's current mesh and update the object.
+static void applyMeshDelta(GObject* po, FSMesh* pm, const FSMeshDelta& delta, bool bnew, bool bup = false)
+{
+	delta.Apply(*pm, bnew);
+	pm->UpdateNormals();
+	pm->UpdateBoundingBox();
+	try
+	{
+		// This could throw a GObjecException
+		po->ReplaceFEMesh(pm, bup);
+	}
+	catch (...)
+	{
+		delta.Apply(*pm, !bnew);
+		pm->UpdateNormals();
+		pm->UpdateBoundingBox();
+		throw;
+	}
 }
 
 void CCmdApplyFEModifier::Execute()
 {
-	if (m_pnew == 0)
+	if ((m_pnew == 0) && (m_bdelta == false))
 	{
 		// create a new mesh
 		if (m_psel)
@@ -2784,10 +2816,24 @@ void CCmdApplyFEModifier::Execute()
 		// let's make sure the command worked
 		if (m_pnew == 0) throw CCmdFailed(this, m_pmod->GetErrorString());
 
+		// if the modifier only moved nodes, we only need to store the delta
+		if (m_pold && (m_pnew != m_pold) && m_delta.Create(*m_pold, *m_pnew))
+		{
+			delete m_pnew;
+			m_pnew = 0;
+			m_bdelta = true;
+		}
+
 		// make sure the new mesh is selected
 		if (m_pobj) m_pobj->Select();
 	}
 
+	if (m_bdelta)
+	{
+		applyMeshDelta(m_pobj, m_pold, m_delta, true);
+		return;
+	}
+
 	if (m_pnew)
 	{
 		// replace the old mesh with the new
@@ -2813,8 +2859,11 @@ void CCmdApplyFEModifier::Execute()
 
 void CCmdApplyFEModifier::UnExecute()
 {
-	// get the FSModel
-	if (m_pnew)
+	if (m_bdelta)
+	{
+		applyMeshDelta(m_pobj, m_pold, m_delta, false);
+	}
+	else if (m_pnew)
 	{
 		// replace the old mesh with the new
 		m_pobj->ReplaceFEMesh(m_pnew);
@@ -2826,6 +2875,12 @@ void CCmdApplyFEModifier::UnExecute()
 }
 
 
+size_t CCmdApplyFEModifier::MemoryUsage() const
+{
+	if (m_bdelta) return m_delta.MemoryUsage();
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 //=============================================================================
 // CCmdApplySurfaceModifier
 //-----------------------------------------------------------------------------
@@ -2905,6 +2960,11 @@ void CCmdApplySurfaceModifier::UnExecute()
 	}
 }
 
+size_t CCmdApplySurfaceModifier::MemoryUsage() const
+{
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 //=============================================================================
 // CCmdChangeFEMesh
 //-----------------------------------------------------------------------------
@@ -2915,10 +2975,33 @@ CCmdChangeFEMesh::CCmdChangeFEMesh(GObject* po, FSMesh* pm, bool bup) : CCommand
 	m_update = bup;
 	m_po = po;
 	m_pnew = pm;
+	m_pmesh = nullptr;
+	m_bfirst = true;
+	m_bnew = false;
 }
 
 void CCmdChangeFEMesh::Execute()
 {
+	if (m_bfirst)
+	{
+		// if the new mesh only differs in its node positions, we only need to store the delta
+		m_bfirst = false;
+		FSMesh* pm = m_po->GetFEMesh();
+		if (pm && m_pnew && (pm != m_pnew) && m_delta.Create(*pm, *m_pnew))
+		{
+			delete m_pnew;
+			m_pnew = nullptr;
+			m_pmesh = pm;
+		}
+	}
+
+	if (m_pmesh)
+	{
+		applyMeshDelta(m_po, m_pmesh, m_delta, !m_bnew, m_update);
+		m_bnew = !m_bnew;
+		return;
+	}
+
 	FSMesh* pm = m_po->GetFEMesh();
 	m_po->ReplaceFEMesh(m_pnew, m_update);
 
@@ -2930,6 +3013,12 @@ void CCmdChangeFEMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFEMesh::MemoryUsage() const
+{
+	if (m_pmesh) return m_delta.MemoryUsage();
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 //=============================================================================
 // CCmdChangeFESurfaceMesh
 //-----------------------------------------------------------------------------
@@ -2961,6 +3050,11 @@ void CCmdChangeFESurfaceMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFESurfaceMesh::MemoryUsage() const
+{
+	return (m_pnew ? MeshMemoryUsage(*m_pnew) : 0);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // CCmdChangeView
@@ -38,6 +38,7 @@ SOFTWARE.*/
 #include <GeomLib/GGroup.h>
 #include <FEMLib/GDiscreteObject.h>
 #include <GeomLib/GMeshObject.h>
+#include <MeshLib/FEMeshDelta.h>
 #include <MeshTools/GModifiedObject.h>
 #include <MeshTools/FESurfaceModifier.h>
 #include <GeomLib/GSurfaceMeshObject.h>
@@ -975,6 +976,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GMeshObject*	m_pobj;
 	FSMesh*			m_pold;
@@ -993,6 +996,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GSurfaceMeshObject*	m_pobj;
 	FSSurfaceMesh*		m_pold;
@@ -1136,12 +1141,16 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*		m_pobj;
 	FSMesh*			m_pold;	// old, unmodified mesh
 	FSMesh*			m_pnew;	// new, modified mesh
 	FEModifier*		m_pmod;
 	FSGroup*		m_psel;
+	FSMeshDelta		m_delta;	// used instead of m_pnew when the modifier only moved nodes
+	bool			m_bdelta;
 };
 
 //-----------------------------------------------------------------------------
@@ -1155,6 +1164,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*			m_pobj;
 	FSSurfaceMesh*		m_pold;	// old, unmodified mesh
@@ -1174,10 +1185,16 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool		m_update;
 	GObject*	m_po;
 	FSMesh*		m_pnew;
+	FSMesh*		m_pmesh;	// mesh that the delta is applied to
+	FSMeshDelta	m_delta;	// used instead of m_pnew when only the nodes moved
+	bool		m_bfirst;
+	bool		m_bnew;		// is the delta's new state applied?
 };
 
 //-----------------------------------------------------------------------------
@@ -1190,6 +1207,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool				m_update;
 	GSurfaceMeshObject*	m_po;
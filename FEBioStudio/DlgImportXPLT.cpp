@@ -31,6 +31,9 @@ SOFTWARE.*/
 #include <QDialogButtonBox>
 #include <QBoxLayout>
 #include <QLabel>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QFormLayout>
 
 
 // converts a string to a list of numbers. 
@@ -103,6 +106,8 @@ public:
 	QRadioButton* pb3;
 	QRadioButton* pb4;
 	QLineEdit* pitems;
+	QCheckBox* paging;
+	QSpinBox*  cacheSize;
 
 public:
 	void setupUi(QDialog* parent)
@@ -121,6 +126,18 @@ public:
 		pv->addWidget(pitems = new QLineEdit);
 		pv->addWidget(new QLabel("(e.g.:1,2,3:6,10:100:5)"));
 
+		pv->addWidget(paging = new QCheckBox("Read state data on demand"));
+		cacheSize = new QSpinBox;
+		cacheSize->setRange(0, 1024*1024);
+		cacheSize->setSingleStep(256);
+		cacheSize->setValue(0);
+		cacheSize->setSpecialValueText("no limit");
+		cacheSize->setSuffix(" MB");
+		cacheSize->setEnabled(false);
+		QFormLayout* pf = new QFormLayout;
+		pf->addRow("Memory limit for states:", cacheSize);
+		pv->addLayout(pf);
+
 		QDialogButtonBox* bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 
 		pv->addWidget(bb);
@@ -129,6 +146,7 @@ public:
 		QObject::connect(bb, SIGNAL(accepted()), parent, SLOT(accept()));
 		QObject::connect(bb, SIGNAL(rejected()), parent, SLOT(reject()));
 		QObject::connect(pitems, SIGNAL(textEdited(const QString&)), pb3, SLOT(click()));
+		QObject::connect(paging, SIGNAL(toggled(bool)), cacheSize, SLOT(setEnabled(bool)));
 	}
 };
 
@@ -136,6 +154,10 @@ CDlgImportXPLT::CDlgImportXPLT(QWidget* parent) : QDialog(parent), ui(new Ui::CD
 {
 	ui->setupUi(this);
 	setWindowTitle("Import XPLT");
+
+	m_nop = 0;
+	m_bpaging = false;
+	m_cacheSize = 0;
 }
 
 void CDlgImportXPLT::accept()
@@ -150,5 +172,8 @@ void CDlgImportXPLT::accept()
 	strcpy(buf, s.c_str());
 	string_to_int_list(buf, m_item);
 
+	m_bpaging = ui->paging->isChecked();
+	m_cacheSize = ui->cacheSize->value();
+
 	QDialog::accept();
 }
@@ -42,6 +42,8 @@ public:
 public:
 	int					m_nop;
 	std::vector<int>	m_item;
+	bool				m_bpaging;		// read states on demand
+	int					m_cacheSize;	// max memory for states (in MB, 0 = no limit)
 
 private:
 	Ui::CDlgImportXPLT* ui;
@@ -155,6 +155,8 @@ public:
 		addEnumProperty(&m_theme, "Theme")->setEnumValues(themes);
 		addProperty("Recent files list", CProperty::Action)->info = QString("Clear");
 		addIntProperty(&m_autoSaveInterval, "AutoSave Interval (s)");
+		addIntProperty(&m_undoMemoryLimit, "Undo memory limit (MB, 0 = no limit)");
+		addIntProperty(&m_plotCacheLimit, "Plot cache memory limit (MB, 0 = no limit)");
 	}
 
 	void SetPropertyValue(int i, const QVariant& v) override
@@ -176,6 +178,8 @@ public:
 	bool	m_bcmd;
 	int		m_theme;
 	int		m_autoSaveInterval;
+	int		m_undoMemoryLimit;
+	int		m_plotCacheLimit;
 };
 
 //-----------------------------------------------------------------------------
@@ -1087,6 +1091,8 @@ void CDlgSettings::UpdateSettings()
 	ui->m_ui->m_bcmd = m_pwnd->clearCommandStackOnSave();
 	ui->m_ui->m_theme = m_pwnd->currentTheme();
 	ui->m_ui->m_autoSaveInterval = m_pwnd->autoSaveInterval();
+	ui->m_ui->m_undoMemoryLimit = m_pwnd->undoMemoryLimit();
+	ui->m_ui->m_plotCacheLimit = m_pwnd->plotCacheLimit();
 
 	ui->m_select->m_bconnect = view.m_bconn;
 	ui->m_select->m_ntagInfo = view.m_ntagInfo;
@@ -1223,6 +1229,8 @@ void CDlgSettings::apply()
 
 	m_pwnd->setClearCommandStackOnSave(ui->m_ui->m_bcmd);
 	m_pwnd->setAutoSaveInterval(ui->m_ui->m_autoSaveInterval);
+	m_pwnd->setUndoMemoryLimit(ui->m_ui->m_undoMemoryLimit);
+	m_pwnd->setPlotCacheLimit(ui->m_ui->m_plotCacheLimit);
 
 	int oldTheme = m_pwnd->currentTheme();
 	if (ui->m_ui->m_theme != oldTheme)
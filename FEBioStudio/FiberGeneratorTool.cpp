@@ -60,6 +60,7 @@ public:
 
 	QComboBox*	m_matList;
 
+	QComboBox*	m_solver;
 	QLineEdit*	m_maxIters;
 	QLineEdit*	m_tol;
 	QLineEdit*	m_sor;
@@ -92,6 +93,7 @@ public:
 		QFormLayout* f = new QFormLayout;
 		f->setContentsMargins(0,0,0,0);
 		f->addRow("Material:", m_matList = new QComboBox);
+		f->addRow("Solver:", m_solver = new QComboBox); m_solver->addItems(QStringList() << "SOR" << "CG (Jacobi)" << "CG (incomplete Cholesky)");
 		f->addRow("Max iterations:", m_maxIters = new QLineEdit); m_maxIters->setText(QString::number(1000));
 		f->addRow("Tolerance:", m_tol = new QLineEdit); m_tol->setText(QString::number(1e-4));
 		f->addRow("SOR parameter:", m_sor = new QLineEdit); m_sor->setText(QString::number(1.8));
@@ -320,7 +322,9 @@ void CFiberGeneratorTool::OnApply()
 	int maxIter = ui->m_maxIters->text().toInt();
 	double tol = ui->m_tol->text().toDouble();
 	double w = ui->m_sor->text().toDouble();
+	int solver = ui->m_solver->currentIndex();
 
+	wnd->AddLogEntry(QString("solver        = %1\n").arg(ui->m_solver->currentText()));
 	wnd->AddLogEntry(QString("max iters     = %1\n").arg(maxIter));
 	wnd->AddLogEntry(QString("tolerance     = %1\n").arg(tol));
 	wnd->AddLogEntry(QString("SOR parameter = %1\n").arg(w));
@@ -330,6 +334,7 @@ void CFiberGeneratorTool::OnApply()
 	L.SetMaxIterations(maxIter);
 	L.SetTolerance(tol);
 	L.SetRelaxation(w);
+	L.SetSolverMethod(solver);
 	bool b = L.Solve(pm, val, bn, 1);
 	int niters = L.GetIterationCount();
 	wnd->AddLogEntry(QString("%1").arg(b ? "Converged!\n" : "NOT converged!\n"));
@@ -48,6 +48,7 @@ SOFTWARE.*/
 #include <GLLib/glx.h>
 #include <GLLib/GDecoration.h>
 #include <PostLib/ColorMap.h>
+#include <PostLib/AnimationQueue.h>
 #include <GLLib/GLCamera.h>
 #include <GLLib/GLContext.h>
 #include <QAction>
@@ -1400,7 +1401,8 @@ QImage CGLView::CaptureScreen()
 
 bool CGLView::NewAnimation(const char* szfile, CAnimation* video, GLenum fmt)
 {
-	m_video = video;
+	// frames are encoded on background threads so that rendering isn't held up
+	m_video = new CAnimationQueue(video);
 	SetVideoFormat(fmt);
 
 	// get the width/height of the animation
@@ -1471,14 +1473,20 @@ void CGLView::StopAnimation()
 		int nframes = m_video->Frames();
 
 		// close the stream
+		// (this writes the frames that are still queued)
 		m_video->Close();
+		bool bfailed = m_video->WriteFailed();
 
 		// delete the object
 		delete m_video;
 		m_video = nullptr;
 
-		// say something if frames is 0. 
-		if (nframes == 0)
+		// say something if a frame failed or if frames is 0. 
+		if (bfailed)
+		{
+			QMessageBox::critical(this, "FEBio Studio", "An error occurred while writing frame to video stream.");
+		}
+		else if (nframes == 0)
 		{
 			QMessageBox::warning(this, "FEBio Studio", "This animation contains no frames. Only an empty video file was saved.");
 		}
@@ -1693,8 +1701,8 @@ void CGLView::paintGL()
 		QImage im = CaptureScreen();
 		if (m_video->Write(im) == false)
 		{
+			// this reports the error
 			StopAnimation();
-			QMessageBox::critical(this, "FEBio Studio", "An error occurred while writing frame to video stream.");
 		}
 	}
 
@@ -47,6 +47,7 @@ class ICPRegistrationToolUI : public QWidget
 private:
     QLineEdit* m_tol;
     QLineEdit* m_maxiter;
+    QCheckBox* m_plane;
     CSelectionBox* m_src;
     CSelectionBox* m_trg;
 
@@ -63,6 +64,7 @@ public:
         QFormLayout* f = new QFormLayout;
         f->addRow("Tolerance:", m_tol = new QLineEdit); m_tol->setValidator(new QDoubleValidator());
         f->addRow("Max. iterations:", m_maxiter = new QLineEdit); m_maxiter->setValidator(new QIntValidator(1, 10000));
+        f->addRow("", m_plane = new QCheckBox("point-to-plane"));
         QPushButton* apply = new QPushButton("Apply");
 
         f->setAlignment(Qt::AlignRight);
@@ -112,6 +114,7 @@ public:
 
     double tolerance() { return m_tol->text().toDouble(); }
     int maxIterations() { return m_maxiter->text().toInt(); }
+    bool pointToPlane() { return m_plane->isChecked(); }
 
 	bool UpdateSelectionList(FEItemListBuilder*& pl, FEItemListBuilder* items)
 	{
@@ -294,7 +297,8 @@ QWidget* CICPRegistrationTool::createUi()
     return ui;
 }
 
-vector<vec3d> extractSurfaceNodes(GObject* po, vector<GPart*> partList)
+// extract the surface nodes of the parts and optionally their (global) normals
+vector<vec3d> extractSurfaceNodes(GObject* po, vector<GPart*> partList, vector<vec3d>* normals = nullptr)
 {
 	vector<vec3d> points;
 	FSMesh* pm = po->GetFEMesh();
@@ -330,6 +334,24 @@ vector<vec3d> extractSurfaceNodes(GObject* po, vector<GPart*> partList)
 		}
 	}
 
+	// average the face normals at the nodes
+	vector<vec3d> nn;
+	if (normals)
+	{
+		nn.assign(pm->Nodes(), vec3d(0, 0, 0));
+		for (int i = 0; i < pm->Faces(); ++i)
+		{
+			FSFace& face = pm->Face(i);
+			if (face.IsExternal())
+			{
+				int nf = face.Nodes();
+				for (int j = 0; j < nf; ++j) nn[face.n[j]] += to_vec3d(face.m_nn[j]);
+			}
+		}
+		normals->clear();
+		normals->reserve(pm->Nodes());
+	}
+
 	const Transform& Q = po->GetTransform();
 	points.reserve(pm->Nodes());
 	for (int i = 0; i < pm->Nodes(); ++i)
@@ -340,6 +362,13 @@ vector<vec3d> extractSurfaceNodes(GObject* po, vector<GPart*> partList)
 			vec3d r = ni.pos();
 			vec3d p = Q.LocalToGlobal(r);
 			points.push_back(p);
+
+			if (normals)
+			{
+				vec3d n = Q.GetRotation() * nn[i];
+				n.Normalize();
+				normals->push_back(n);
+			}
 		}
 	}
 
@@ -381,12 +410,14 @@ void CICPRegistrationTool::OnApply()
 
 	// extract all the surface nodes from the parts 
 	vector<vec3d> srcNodes = extractSurfaceNodes(srcObj, srcParts);
-	vector<vec3d> trgNodes = extractSurfaceNodes(trgObj, trgParts);
+	vector<vec3d> trgNormals;
+	vector<vec3d> trgNodes = extractSurfaceNodes(trgObj, trgParts, (ui->pointToPlane() ? &trgNormals : nullptr));
 
 	GICPRegistration icp;
 	icp.SetTolerance(ui->tolerance());
 	icp.SetMaxIterations(ui->maxIterations());
-	Transform Q = icp.Register(trgNodes, srcNodes);
+	if (ui->pointToPlane()) icp.SetMethod(GICPRegistration::POINT_TO_PLANE);
+	Transform Q = icp.Register(trgNodes, trgNormals, srcNodes);
 
 	vec3d t = Q.GetPosition();
 	quatd q = Q.GetRotation();
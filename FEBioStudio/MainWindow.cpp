@@ -59,11 +59,13 @@ SOFTWARE.*/
 #include <FEBio/FEBioExport4.h>
 #include "FEBioJob.h"
 #include <PostLib/ColorMap.h>
+#include <PostLib/DataMap.h>
 #include <FSCore/FSDir.h>
 #include <QInputDialog>
 #include <QUuid>
 #include "DlgCheck.h"
 #include "IconProvider.h"
+#include "CommandManager.h"
 #include "Logger.h"
 #include "SSHHandler.h"
 #include "SSHThread.h"
@@ -1031,6 +1033,8 @@ void CMainWindow::OpenPostFile(const QString& fileName, CModelDocument* modelDoc
 				{
 					xplt->SetReadStateFlag(dlg.m_nop);
 					xplt->SetReadStatesList(dlg.m_item);
+					xplt->SetStatePaging(dlg.m_bpaging);
+					xplt->SetStateCacheSize(dlg.m_cacheSize);
 				}
 				else
 				{
@@ -1910,6 +1914,30 @@ int CMainWindow::autoSaveInterval()
 	return ui->m_autoSaveInterval;
 }
 
+void CMainWindow::setUndoMemoryLimit(int mb)
+{
+	if (mb < 0) mb = 0;
+	ui->m_undoMemoryLimit = mb;
+	CCommandManager::SetMemoryLimit((size_t)mb * 1024 * 1024);
+}
+
+int CMainWindow::undoMemoryLimit()
+{
+	return ui->m_undoMemoryLimit;
+}
+
+void CMainWindow::setPlotCacheLimit(int mb)
+{
+	if (mb < 0) mb = 0;
+	ui->m_plotCacheLimit = mb;
+	Post::DataMapBudget::Shared()->SetLimit((size_t)mb * 1024 * 1024);
+}
+
+int CMainWindow::plotCacheLimit()
+{
+	return ui->m_plotCacheLimit;
+}
+
 QString CMainWindow::GetServerMessage()
 {
     return ui->m_serverMessage;
@@ -1955,6 +1983,8 @@ void CMainWindow::writeSettings()
 	settings.setValue("state", saveState());
 	settings.setValue("theme", ui->m_theme);
 	settings.setValue("autoSaveInterval", ui->m_autoSaveInterval);
+	settings.setValue("undoMemoryLimit", ui->m_undoMemoryLimit);
+	settings.setValue("plotCacheLimit", ui->m_plotCacheLimit);
 	settings.setValue("defaultUnits", ui->m_defaultUnits);
 	settings.setValue("bgColor1", (int)vs.m_col1.to_uint());
 	settings.setValue("bgColor2", (int)vs.m_col2.to_uint());
@@ -2081,6 +2111,8 @@ void CMainWindow::readSettings()
 	restoreState(settings.value("state").toByteArray());
 	ui->m_theme = settings.value("theme", 0).toInt();
 	ui->m_autoSaveInterval = settings.value("autoSaveInterval", 600).toInt();
+	setUndoMemoryLimit(settings.value("undoMemoryLimit", ui->m_undoMemoryLimit).toInt());
+	setPlotCacheLimit(settings.value("plotCacheLimit", ui->m_plotCacheLimit).toInt());
 	ui->m_defaultUnits = settings.value("defaultUnits", 0).toInt();
 	vs.m_col1 = GLColor(settings.value("bgColor1", (int)vs.m_col1.to_uint()).toInt());
 	vs.m_col2 = GLColor(settings.value("bgColor2", (int)vs.m_col2.to_uint()).toInt());
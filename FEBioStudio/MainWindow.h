@@ -187,6 +187,14 @@ public:
 	void setAutoSaveInterval(int interval);
 	int autoSaveInterval();
 
+	// memory limit of the undo history (in MB)
+	void setUndoMemoryLimit(int mb);
+	int undoMemoryLimit();
+
+	// memory limit of the per-state data cached by the post plots (in MB)
+	void setPlotCacheLimit(int mb);
+	int plotCacheLimit();
+
 	// autoUpdate Check
     QString GetServerMessage();
 	bool updaterPresent();
@@ -601,9 +601,8 @@ bool CModelDocument::ExportMaterials(const std::string& fileName, const vector<G
 		}
 		ar.EndChunk();
 	}
-	ar.Close();
 
-	return true;
+	return ar.Close();
 }
 
 bool CModelDocument::ImportMaterials(const std::string& fileName)
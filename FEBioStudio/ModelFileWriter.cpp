@@ -52,6 +52,9 @@ bool CModelFileWriter::Write(const char* szfile)
 		return false;
 	}
 
+	// make sure all the data was written
+	if (ar.Close() == false) return false;
+
 	// TODO: moved this to the save functions in CDocument so that it does not clear the modified
 	// flag when the document is autosaved. Does this interfere with CMainWindow::on_actionConvertFeb_triggered
 	// or CMainWindow::on_actionConvertGeo_triggered since this is called there.
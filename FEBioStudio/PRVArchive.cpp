@@ -41,6 +41,13 @@ bool PRVArchive::Load(const char* szfile)
 	return m_ar.Open(m_fp, 0x00505256);
 }
 
+float PRVArchive::GetFileProgress() const
+{
+	// the file pointer does not move when the archive is memory-mapped
+	if (m_ar.IsMapped()) return (float)m_ar.Tell() / (float)m_ar.FileSize();
+	return FileReader::GetFileProgress();
+}
+
 void PRVArchive::Close()
 {
 	m_ar.Close();
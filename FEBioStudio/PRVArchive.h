@@ -44,6 +44,8 @@ public:
 
 	IArchive& GetArchive() { return m_ar; }
 
+	float GetFileProgress() const override;
+
 	void Close();
 
 private:
@@ -359,6 +359,9 @@ public:
 	QTimer* m_autoSaveTimer;
 	int m_autoSaveInterval;
 
+	int m_undoMemoryLimit;	// in MB (0 = no limit)
+	int m_plotCacheLimit;	// in MB (0 = no limit)
+
 	int		m_defaultUnits;
 
 	CUpdateWidget m_updateWidget;
@@ -377,6 +380,8 @@ public:
 		m_defaultUnits = 0;
 		m_clearUndoOnSave = true;
 		m_autoSaveInterval = 600;
+		m_undoMemoryLimit = 2048;
+		m_plotCacheLimit = 2048;
 
 		measureTool = nullptr;
 		planeCutTool = nullptr;
@@ -31,6 +31,21 @@ SOFTWARE.*/
 
 using std::stringstream;
 
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#define ftell64(a)     _ftelli64(a)
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+// size of the output archive's write buffers
+const size_t OARCHIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
 //=============================================================================
 IOMemBuffer::IOMemBuffer()
 {
@@ -86,6 +101,10 @@ IArchive::IArchive()
 	m_delfp = false;
 	m_nversion = 0;
 	m_fp = 0;
+	m_pdata = nullptr;
+	m_ndata = 0;
+	m_pos = 0;
+	m_hmap = nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -106,6 +125,8 @@ void IArchive::Close()
 {
 	while (m_Chunk.empty() == false) CloseChunk();
 
+	UnmapFile();
+
 	// reset pointers
 	if (m_delfp) fclose(m_fp);
 	m_fp = 0;
@@ -134,9 +155,13 @@ bool IArchive::Open(FILE* fp, unsigned int signature)
 	// store the file pointer
 	m_fp = fp;
 
+	// try to map the file into memory, so we don't need a system call for each read.
+	// If that fails, we'll just read the file with fread.
+	MapFile();
+
 	// read the master tag
 	unsigned int ntag;
-	if (fread(&ntag, sizeof(int), 1, m_fp) != 1) 
+	if (readData(&ntag, sizeof(int), 1) != 1) 
 	{
 		Close();
 		return false;
@@ -185,7 +210,7 @@ int IArchive::OpenChunk()
 	if (pc->nsize == 0) m_bend = true;
 
 	// record the position
-	pc->lpos = ftell(m_fp);
+	pc->lpos = Tell();
 
 	// add it to the stack
 	m_Chunk.push(pc);
@@ -199,17 +224,17 @@ void IArchive::CloseChunk()
 	CHUNK* pc = m_Chunk.top(); m_Chunk.pop();
 
 	// get the current file position
-	long lpos = ftell(m_fp);
+	long long lpos = Tell();
 
 	// calculate the offset to the end of the chunk
-	int noff = pc->nsize - (lpos - pc->lpos);
+	long long noff = pc->nsize - (lpos - pc->lpos);
 
 	// skip any remaining part in the chunk
 	// I wonder if this can really happen
 	if (noff != 0)
 	{
-		fseek(m_fp, noff, SEEK_CUR);
-		lpos = ftell(m_fp);
+		Skip(noff);
+		lpos = Tell();
 	}
 
 	// delete this chunk
@@ -224,7 +249,7 @@ void IArchive::CloseChunk()
 	else
 	{
 		pc = m_Chunk.top();
-		int noff = pc->nsize - (lpos - pc->lpos);
+		long long noff = pc->nsize - (lpos - pc->lpos);
 		if (noff == 0) m_bend = true;
 	}
 }
@@ -242,7 +267,7 @@ IArchive::IOResult IArchive::read(std::vector<int>& v)
 
 	int nsize = pc->nsize / sizeof(int);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(int), nsize, m_fp);
+	int nread = (int)readData(&v[0], sizeof(int), nsize);
 	if (nread != nsize) return IO_ERROR;
 	return IO_OK;
 }
@@ -255,7 +280,7 @@ IArchive::IOResult IArchive::read(std::vector<double>& v)
 	if (nsize > 0)
 	{
 		v.resize(nsize);
-		int nread = (int)fread(&v[0], sizeof(double), nsize, m_fp);
+		int nread = (int)readData(&v[0], sizeof(double), nsize);
 		if (nread != nsize) return IO_ERROR;
 	}
 	else v.clear();
@@ -269,11 +294,85 @@ IArchive::IOResult IArchive::read(std::vector<vec2d>& v)
 
 	int nsize = pc->nsize / sizeof(vec2d);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(vec2d), nsize, m_fp);
+	int nread = (int)readData(&v[0], sizeof(vec2d), nsize);
 	if (nread != nsize) return IO_ERROR;
 	return IO_OK;
 }
 
+//-----------------------------------------------------------------------------
+long long IArchive::Tell() const
+{
+	if (m_pdata) return (long long)m_pos;
+	return ftell64(m_fp);
+}
+
+//-----------------------------------------------------------------------------
+void IArchive::Skip(long long noff)
+{
+	if (m_pdata) m_pos += noff;
+	else fseek64(m_fp, noff, SEEK_CUR);
+}
+
+//-----------------------------------------------------------------------------
+// Map the file (from the current file position) into memory
+bool IArchive::MapFile()
+{
+	assert(m_pdata == nullptr);
+	long long lpos = ftell64(m_fp);
+	if (lpos < 0) return false;
+
+#ifdef WIN32
+	HANDLE hfile = (HANDLE)_get_osfhandle(_fileno(m_fp));
+	if (hfile == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(hfile, &fileSize) == FALSE) || (fileSize.QuadPart <= lpos)) return false;
+
+	HANDLE hmap = CreateFileMapping(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hmap == NULL) return false;
+
+	void* pd = MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+	if (pd == NULL) { CloseHandle(hmap); return false; }
+
+	m_hmap = hmap;
+	m_ndata = (size_t)fileSize.QuadPart;
+#else
+	struct stat st;
+	if ((fstat(fileno(m_fp), &st) != 0) || (st.st_size <= lpos)) return false;
+
+	void* pd = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(m_fp), 0);
+	if (pd == MAP_FAILED) return false;
+	madvise(pd, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	m_ndata = (size_t)st.st_size;
+#endif
+
+	m_pdata = (const char*)pd;
+	m_pos = (size_t)lpos;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void IArchive::UnmapFile()
+{
+	if (m_pdata == nullptr) return;
+
+#ifdef WIN32
+	UnmapViewOfFile(m_pdata);
+	CloseHandle((HANDLE)m_hmap);
+	m_hmap = nullptr;
+#else
+	munmap((void*)m_pdata, m_ndata);
+#endif
+
+	// leave the file pointer at the position where we stopped reading
+	fseek64(m_fp, (long long)m_pos, SEEK_SET);
+
+	m_pdata = nullptr;
+	m_ndata = 0;
+	m_pos = 0;
+}
+
 void IArchive::log(const char* sz, ...)
 {
 	if (sz == 0) return;
@@ -319,8 +418,9 @@ std::string IArchive::GetLog() const
 
 OArchive::OArchive()
 {
-	m_pRoot = 0;
-	m_pChunk = 0;
+	m_fp = nullptr;
+	m_bufPos = 0;
+	m_bok = true;
 }
 
 OArchive::~OArchive()
@@ -328,47 +428,125 @@ OArchive::~OArchive()
 	Close();
 }
 
-void OArchive::Close()
+bool OArchive::Close()
 {
-	if (m_fp.IsValid())
+	if (m_fp)
 	{
-		m_pRoot->Write(&m_fp);
-		m_fp.Close();
+		// close all open chunks, including the root
+		while (m_Chunk.empty() == false) EndChunk();
+
+		FlushBuffer();
+		WaitForWriter();
+
+		// write the sizes of the chunks that were already flushed
+		for (PATCH& p : m_patch)
+		{
+			fseek64(m_fp, p.lpos, SEEK_SET);
+			if (fwrite(&p.nsize, sizeof(unsigned int), 1, m_fp) != 1) m_bok = false;
+		}
+
+		if (fclose(m_fp) != 0) m_bok = false;
+		m_fp = nullptr;
 	}
 
-	delete m_pRoot;
-	m_pRoot = 0;
-	m_pChunk = 0;
+	m_buf.clear(); m_buf.shrink_to_fit();
+	m_out.clear(); m_out.shrink_to_fit();
+	m_patch.clear();
+	m_bufPos = 0;
+
+	return m_bok;
 }
 
 bool OArchive::Create(const char* szfile, unsigned int signature)
 {
+	assert(m_fp == nullptr);
+
 	// attempt to create the file
-	if (m_fp.Create(szfile) == false) return false;
+	m_fp = fopen(szfile, "wb");
+	if (m_fp == nullptr) return false;
+
+	m_buf.reserve(OARCHIVE_BUFFER_SIZE);
+	m_bufPos = 0;
+	m_bok = true;
 
 	// write the master tag 
-	m_fp.Write(&signature, sizeof(int), 1);
+	write(&signature, sizeof(unsigned int));
 
-	assert(m_pRoot == 0);
-	m_pRoot = new OBranch(0);
-	m_pChunk = m_pRoot;
+	// open the root chunk
+	BeginChunk(0);
 
 	return true;
 }
 
 void OArchive::BeginChunk(unsigned int id)
 {
-	// create a new branch
-	OBranch* pbranch = new OBranch(id);
+	CHUNK c;
+	c.id = id;
+	c.lpos = m_bufPos + (long long)m_buf.size() + sizeof(unsigned int);
+	m_Chunk.push(c);
 
-	// attach it to the current branch
-	m_pChunk->AddChild(pbranch);
-
-	// move the current branch pointer
-	m_pChunk = pbranch;
+	// the size is written when the chunk is closed
+	WriteHeader(id, 0);
 }
 
 void OArchive::EndChunk()
 {
-	m_pChunk = m_pChunk->GetParent();
+	CHUNK c = m_Chunk.top(); m_Chunk.pop();
+
+	long long lend = m_bufPos + (long long)m_buf.size();
+	unsigned int nsize = (unsigned int)(lend - c.lpos - sizeof(unsigned int));
+
+	if (c.lpos >= m_bufPos)
+	{
+		// the size field is still in the buffer
+		memcpy(&m_buf[c.lpos - m_bufPos], &nsize, sizeof(unsigned int));
+	}
+	else
+	{
+		// the size field was already flushed
+		PATCH p = { c.lpos, nsize };
+		m_patch.push_back(p);
+	}
+}
+
+void OArchive::WriteHeader(unsigned int nid, unsigned int nsize)
+{
+	write(&nid, sizeof(unsigned int));
+	write(&nsize, sizeof(unsigned int));
+}
+
+void OArchive::write(const void* pd, size_t nsize)
+{
+	const char* pc = (const char*)pd;
+	while (nsize > 0)
+	{
+		size_t nfree = OARCHIVE_BUFFER_SIZE - m_buf.size();
+		size_t n = (nsize < nfree ? nsize : nfree);
+		m_buf.insert(m_buf.end(), pc, pc + n);
+		pc += n;
+		nsize -= n;
+
+		if (m_buf.size() == OARCHIVE_BUFFER_SIZE) FlushBuffer();
+	}
+}
+
+void OArchive::FlushBuffer()
+{
+	if (m_buf.empty()) return;
+
+	// wait until the previous buffer is written, and then write this one in the background
+	WaitForWriter();
+	m_out.swap(m_buf);
+	m_bufPos += (long long)m_out.size();
+	m_buf.clear();
+	m_buf.reserve(OARCHIVE_BUFFER_SIZE);
+
+	m_writer = std::thread([this]() {
+		if (fwrite(&m_out[0], 1, m_out.size(), m_fp) != m_out.size()) m_bok = false;
+	});
+}
+
+void OArchive::WaitForWriter()
+{
+	if (m_writer.joinable()) m_writer.join();
 }
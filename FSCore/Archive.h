@@ -34,6 +34,8 @@ SOFTWARE.*/
 #include <stack>
 #include <list>
 #include <string>
+#include <vector>
+#include <thread>
 #include "memtool.h"
 //using namespace std;
 
@@ -62,6 +64,35 @@ private:
 	int		m_nalloc;	// actual amount of allocated data
 };
 
+//-----------------------------------------------------------------------------
+// Read-only view of an array chunk (see IArchive::read(ArrayView<T>&)).
+// The view remains valid until the archive is closed. 
+template <class T> class ArrayView
+{
+public:
+	ArrayView() : m_pd(nullptr), m_n(0) {}
+
+	size_t size() const { return m_n; }
+	bool empty() const { return (m_n == 0); }
+
+	const T* data() const { return m_pd; }
+	const T& operator [] (size_t i) const { return m_pd[i]; }
+
+	const T* begin() const { return m_pd; }
+	const T* end() const { return m_pd + m_n; }
+
+private:
+	ArrayView(const ArrayView&) = delete;
+	void operator = (const ArrayView&) = delete;
+
+private:
+	const T*		m_pd;	// pointer to data
+	size_t			m_n;	// nr. of items
+	std::vector<T>	m_buf;	// data, when it had to be copied
+
+	friend class IArchive;
+};
+
 //----------------------
 // Input archive
 
@@ -70,7 +101,7 @@ class IArchive
 	struct CHUNK
 	{
 		unsigned int	id;		// chunk ID
-		long			lpos;	// file position of size field
+		long long		lpos;	// file position of chunk data
 		unsigned int	nsize;	// size of chunk
 	};
 
@@ -104,25 +135,25 @@ public:
 	virtual void CloseChunk();
 
 	// input functions
-	IOResult read(char&   c) { int nr = (int) fread(&c, sizeof(char  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(int&    n) { int nr = (int) fread(&n, sizeof(int   ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
-	IOResult read(bool&   b) { int nr = (int) fread(&b, sizeof(bool  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(float&  f) { int nr = (int) fread(&f, sizeof(float ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(f); return IO_OK; }
-	IOResult read(double& g) { int nr = (int) fread(&g, sizeof(double), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(g); return IO_OK; }
+	IOResult read(char&   c) { int nr = (int) readData(&c, sizeof(char  ), 1); if (nr != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(int&    n) { int nr = (int) readData(&n, sizeof(int   ), 1); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
+	IOResult read(bool&   b) { int nr = (int) readData(&b, sizeof(bool  ), 1); if (nr != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(float&  f) { int nr = (int) readData(&f, sizeof(float ), 1); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(f); return IO_OK; }
+	IOResult read(double& g) { int nr = (int) readData(&g, sizeof(double), 1); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(g); return IO_OK; }
 
-	IOResult read(unsigned int& n) { size_t nr = fread(&n, sizeof(unsigned int), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
+	IOResult read(unsigned int& n) { size_t nr = readData(&n, sizeof(unsigned int), 1); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
 
 
-	IOResult read(int*    pi, int n) { int nr = (int) fread(pi, sizeof(int   ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pi, n); return IO_OK; }
-	IOResult read(bool*   pb, int n) { int nr = (int) fread(pb, sizeof(bool  ), n, m_fp); if (nr != n) return IO_ERROR; return IO_OK; }
-	IOResult read(float*  pf, int n) { int nr = (int) fread(pf, sizeof(float ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pf, n); return IO_OK; }
-	IOResult read(double* pg, int n) { int nr = (int) fread(pg, sizeof(double), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pg, n); return IO_OK; }
+	IOResult read(int*    pi, int n) { int nr = (int) readData(pi, sizeof(int   ), n); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pi, n); return IO_OK; }
+	IOResult read(bool*   pb, int n) { int nr = (int) readData(pb, sizeof(bool  ), n); if (nr != n) return IO_ERROR; return IO_OK; }
+	IOResult read(float*  pf, int n) { int nr = (int) readData(pf, sizeof(float ), n); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pf, n); return IO_OK; }
+	IOResult read(double* pg, int n) { int nr = (int) readData(pg, sizeof(double), n); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pg, n); return IO_OK; }
 	IOResult read(vec3d*  pv, int n) { for (int i=0; i<n; ++i) read(pv[i]); return IO_OK; }
 
 	IOResult read(vec3d& r) { read(r.x); read(r.y); read(r.z); return IO_OK; }
 	IOResult read(vec2i& r) { read(r.x); read(r.y); return IO_OK; }
 	IOResult read(quatd& q) { read(q.x); read(q.y); read(q.z); read(q.w); return IO_OK; }
-	IOResult read(GLColor& c) { int nr = (int) fread(&c, sizeof(GLColor), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(GLColor& c) { int nr = (int) readData(&c, sizeof(GLColor), 1); if (nr != 1) return IO_ERROR; return IO_OK; }
 
 	IOResult read(mat3d& a) 
 	{ 
@@ -145,7 +176,7 @@ public:
 		IOResult ret;
 		int l, nr;
 		ret = read(l); if (ret != IO_OK) return ret;
-		nr = (int) fread(sz, 1, l, m_fp); if (nr != l) return IO_ERROR;
+		nr = (int) readData(sz, 1, l); if (nr != l) return IO_ERROR;
 		sz[l] = 0;
 		return IO_OK;
 	}
@@ -158,7 +189,7 @@ public:
 		if (l > 0)
 		{
 			char* tmp = new char[l+1];
-			int nr = (int) fread(tmp, 1, l, m_fp); if (nr != l) return IO_ERROR;
+			int nr = (int) readData(tmp, 1, l); if (nr != l) return IO_ERROR;
 			tmp[l] = 0;
 			s = tmp;
 			delete [] tmp;
@@ -176,11 +207,41 @@ public:
 		CHUNK* pc = m_Chunk.top();
 		int nsize = pc->nsize / sizeof(T);
 		v.resize(nsize);
-		int nread = (int)fread(&v[0], sizeof(T), nsize, m_fp);
+		int nread = (int)readData(&v[0], sizeof(T), nsize);
 		if (nread != nsize) return IO_ERROR;
 		return IO_OK;
 	}
 
+	// Read an array chunk as a view. When the file is memory-mapped and the data is aligned, 
+	// the view points directly into the file, otherwise the data is copied into the view.
+	// Note that (like read(std::vector<T>&)) the data is not byte-swapped.
+	template <class T> IOResult read(ArrayView<T>& v)
+	{
+		CHUNK* pc = m_Chunk.top();
+		size_t nsize = pc->nsize / sizeof(T);
+		v.m_pd = nullptr;
+		v.m_n = nsize;
+		v.m_buf.clear();
+		if (nsize == 0) return IO_OK;
+
+		size_t nbytes = nsize * sizeof(T);
+		if (m_pdata && (m_pos + nbytes <= m_ndata))
+		{
+			const char* pd = m_pdata + m_pos;
+			if (((size_t)pd % alignof(T)) == 0)
+			{
+				v.m_pd = (const T*)pd;
+				m_pos += nbytes;
+				return IO_OK;
+			}
+		}
+
+		v.m_buf.resize(nsize);
+		if (readData(&v.m_buf[0], sizeof(T), nsize) != nsize) return IO_ERROR;
+		v.m_pd = &v.m_buf[0];
+		return IO_OK;
+	}
+
 	// conversion to FILE* 
 	operator FILE* () { return m_fp; }
 
@@ -190,9 +251,40 @@ public:
 	void log(const char* sztxt, ...);
 	std::string GetLog() const;
 
+	// get the current position in the file
+	long long Tell() const;
+
+	// size of the file (only known when the file is memory-mapped)
+	long long FileSize() const { return (long long)m_ndata; }
+
+	// returns true if the file is memory-mapped
+	bool IsMapped() const { return (m_pdata != nullptr); }
+
 private:
 	bool Load(const char* szfile) { return false; }
 
+	// read data from the file or the file mapping
+	size_t readData(void* pd, size_t size, size_t count)
+	{
+		if (m_pdata == nullptr) return fread(pd, size, count, m_fp);
+
+		size_t nbytes = size * count;
+		if (m_pos + nbytes > m_ndata)
+		{
+			count = (m_ndata - m_pos) / size;
+			nbytes = size * count;
+		}
+		memcpy(pd, m_pdata + m_pos, nbytes);
+		m_pos += nbytes;
+		return count;
+	}
+
+	// move the file position
+	void Skip(long long noff);
+
+	bool MapFile();
+	void UnmapFile();
+
 protected:
 	bool	m_bswap;	// swap data when reading
 	bool	m_bend;		// chunk end flag
@@ -204,20 +296,42 @@ protected:
 
 	FILE*	m_fp;		// the file pointer
 
+	// memory-mapped file
+	const char*	m_pdata;	// start of file mapping (or null when reading with fread)
+	size_t		m_ndata;	// size of mapping
+	size_t		m_pos;		// current position in mapping
+	void*		m_hmap;		// mapping handle (Windows only)
+
 protected:
 	std::string		m_log;
 };
 
 //----------------------
 // Output archive
+// The archive is written while it is being serialized. Chunks are streamed into a buffer
+// that is written to file on a background thread when it is full, and the chunk sizes are 
+// back-patched when the chunks are closed. The file format is the same as the tree-based 
+// OBranch/OLeaf format, so files can be read with IArchive. 
 class OArchive  
 {
+	struct CHUNK
+	{
+		unsigned int	id;		// chunk ID
+		long long		lpos;	// file position of the size field
+	};
+
+	struct PATCH
+	{
+		long long		lpos;	// file position of the size field
+		unsigned int	nsize;	// chunk size
+	};
+
 public:
 	OArchive();
 	virtual ~OArchive();
 
-	// Close archive
-	void Close();
+	// Close archive. Returns false if writing the archive failed.
+	bool Close();
 
 	// Open for writing
 	bool Create(const char* szfile, unsigned int signature);
@@ -230,32 +344,62 @@ public:
 
 	void WriteChunk(unsigned int nid, char* sz)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
+		WriteChunk(nid, (const char*)sz);
 	}
 
 	void WriteChunk(unsigned int nid, const char* sz)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
+		unsigned int l = (unsigned int)strlen(sz);
+		WriteHeader(nid, l + sizeof(unsigned int));
+		write(&l, sizeof(unsigned int));
+		write(sz, l);
 	}
 
 	void WriteChunk(unsigned int nid, const string& s)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, s.c_str()));
+		WriteChunk(nid, s.c_str());
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, T* po, int n)
 	{
-		m_pChunk->AddChild(new OLeaf<T*>(nid, po, n));
+		WriteHeader(nid, sizeof(T)*n);
+		write(po, sizeof(T)*n);
+	}
+
+	template <typename T> void WriteChunk(unsigned int nid, const std::vector<T>& v)
+	{
+		WriteHeader(nid, (unsigned int)(sizeof(T)*v.size()));
+		if (v.empty() == false) write(&v[0], sizeof(T)*v.size());
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, const T& o)
 	{
-		m_pChunk->AddChild(new OLeaf<T>(nid, o));
+		WriteHeader(nid, sizeof(T));
+		write(&o, sizeof(T));
 	}
 
 protected:
-	FileStream	m_fp;		// the file pointer
+	// write a chunk header
+	void WriteHeader(unsigned int nid, unsigned int nsize);
+
+	// write data to the buffer
+	void write(const void* pd, size_t nsize);
+
+	// pass the buffer to the writer thread
+	void FlushBuffer();
+
+	// wait for the writer thread to finish
+	void WaitForWriter();
+
+protected:
+	FILE*	m_fp;		// the file pointer
+
+	std::vector<char>	m_buf;		// buffer that is being filled
+	std::vector<char>	m_out;		// buffer that is being written to file
+	long long			m_bufPos;	// file position of the start of m_buf
+	std::thread			m_writer;	// writer thread
+	bool				m_bok;		// false if writing failed
 
-	OBranch*	m_pRoot;	// chunk tree root
-	OBranch*	m_pChunk;	// current chunk
+	stack<CHUNK>		m_Chunk;	// open chunks
+	std::vector<PATCH>	m_patch;	// chunk sizes that must be written after the buffers are flushed
 };
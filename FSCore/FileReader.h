@@ -85,6 +85,9 @@ protected:
 	// get the file pointer
 	FILE* FilePtr();
 
+	// get the size of the file (in bytes)
+	off_type FileSize() const { return m_nfilesize; }
+
 protected:
 	FILE*			m_fp;
     ifstream*       m_stream;
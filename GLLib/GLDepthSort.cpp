@@ -0,0 +1,147 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "GLDepthSort.h"
+#include <string.h>
+
+// number of bits per radix pass
+const int RADIX_BITS = 8;
+const int RADIX_SIZE = (1 << RADIX_BITS);
+const unsigned int RADIX_MASK = RADIX_SIZE - 1;
+
+// minimum nr of items per block. The histograms and scatter are done in 
+// parallel over blocks, so small lists are processed in a single block.
+const int RADIX_BLOCK_SIZE = 16384;
+const int RADIX_MAX_BLOCKS = 64;
+
+//-----------------------------------------------------------------------------
+// Map a float to an unsigned int so that the integer order matches the float order.
+static inline unsigned int depthKey(float f)
+{
+	unsigned int u;
+	memcpy(&u, &f, sizeof(float));
+	return (u & 0x80000000u ? ~u : u | 0x80000000u);
+}
+
+//-----------------------------------------------------------------------------
+GLDepthSort::GLDepthSort()
+{
+}
+
+//-----------------------------------------------------------------------------
+void GLDepthSort::Clear()
+{
+	m_key.clear(); m_key.shrink_to_fit();
+	m_tmpKey.clear(); m_tmpKey.shrink_to_fit();
+	m_idx.clear(); m_idx.shrink_to_fit();
+	m_tmpIdx.clear(); m_tmpIdx.shrink_to_fit();
+	m_hist.clear(); m_hist.shrink_to_fit();
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<int>& GLDepthSort::Sort(const std::vector<float>& z)
+{
+	int n = (int)z.size();
+	m_key.resize(n);
+	m_tmpKey.resize(n);
+	m_idx.resize(n);
+	m_tmpIdx.resize(n);
+	if (n == 0) return m_idx;
+
+	// split the list in blocks
+	int blocks = n / RADIX_BLOCK_SIZE;
+	if (blocks < 1) blocks = 1;
+	if (blocks > RADIX_MAX_BLOCKS) blocks = RADIX_MAX_BLOCKS;
+	int blockSize = (n + blocks - 1) / blocks;
+	m_hist.resize(blocks * RADIX_SIZE);
+
+	// build the keys
+#pragma omp parallel for if (blocks > 1)
+	for (int i = 0; i < n; ++i)
+	{
+		m_key[i] = depthKey(z[i]);
+		m_idx[i] = i;
+	}
+
+	for (int shift = 0; shift < 32; shift += RADIX_BITS)
+	{
+		// histogram of each block
+#pragma omp parallel for if (blocks > 1)
+		for (int b = 0; b < blocks; ++b)
+		{
+			int* h = &m_hist[b * RADIX_SIZE];
+			for (int j = 0; j < RADIX_SIZE; ++j) h[j] = 0;
+
+			int n0 = b * blockSize;
+			int n1 = (n0 + blockSize < n ? n0 + blockSize : n);
+			for (int i = n0; i < n1; ++i) h[(m_key[i] >> shift) & RADIX_MASK]++;
+		}
+
+		// if all keys have the same digit, this pass doesn't change anything
+		bool skip = false;
+		for (int j = 0; j < RADIX_SIZE; ++j)
+		{
+			int m = 0;
+			for (int b = 0; b < blocks; ++b) m += m_hist[b * RADIX_SIZE + j];
+			if (m == n) { skip = true; break; }
+			if (m != 0) break;
+		}
+		if (skip) continue;
+
+		// convert to offsets. Blocks are ordered within each digit so the sort is stable.
+		int sum = 0;
+		for (int j = 0; j < RADIX_SIZE; ++j)
+			for (int b = 0; b < blocks; ++b)
+			{
+				int& h = m_hist[b * RADIX_SIZE + j];
+				int m = h;
+				h = sum;
+				sum += m;
+			}
+
+		// scatter
+#pragma omp parallel for if (blocks > 1)
+		for (int b = 0; b < blocks; ++b)
+		{
+			int* h = &m_hist[b * RADIX_SIZE];
+			int n0 = b * blockSize;
+			int n1 = (n0 + blockSize < n ? n0 + blockSize : n);
+			for (int i = n0; i < n1; ++i)
+			{
+				unsigned int k = m_key[i];
+				int m = h[(k >> shift) & RADIX_MASK]++;
+				m_tmpKey[m] = k;
+				m_tmpIdx[m] = m_idx[i];
+			}
+		}
+
+		m_key.swap(m_tmpKey);
+		m_idx.swap(m_tmpIdx);
+	}
+
+	return m_idx;
+}
@@ -0,0 +1,57 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Sorts items by their (view) depth. The depths are mapped to 32-bit integer
+// keys that preserve the floating point order and are then sorted with a 
+// stable LSD radix sort. Items with equal depth keep their input order. 
+// The buffers are kept between calls so that the sorter can be reused each 
+// frame without reallocating.
+class GLDepthSort
+{
+public:
+	GLDepthSort();
+
+	// sort the depth values in ascending order. The returned list contains
+	// the indices into the z array, sorted from smallest to largest depth.
+	const std::vector<int>& Sort(const std::vector<float>& z);
+
+	// the result of the last sort
+	const std::vector<int>& Order() const { return m_idx; }
+
+	// release all buffers
+	void Clear();
+
+private:
+	std::vector<unsigned int>	m_key;		// sort keys
+	std::vector<unsigned int>	m_tmpKey;	// scratch buffer for keys
+	std::vector<int>			m_idx;		// sorted indices
+	std::vector<int>			m_tmpIdx;	// scratch buffer for indices
+	std::vector<int>			m_hist;		// histograms (one per block)
+};
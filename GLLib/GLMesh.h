@@ -26,6 +26,7 @@ SOFTWARE.*/
 #pragma once
 #include <FSCore/math3d.h>
 #include <FSCore/color.h>
+#include <assert.h>
 
 class GMesh;
 class CGLCamera;
@@ -118,6 +119,13 @@ public:
 	// return vertex data
 	Vertex GetVertex(size_t i) const;
 
+	// Direct access to the vertex buffers, so they can be filled in one go (e.g. in parallel). 
+	// Call SetVertexCount with the number of vertices written before calling EndMesh.
+	float* VertexBuffer() { return m_vr; }
+	float* NormalBuffer() { return m_vn; }
+	ubyte* ColorBuffer() { return m_vc; }
+	void SetVertexCount(size_t n) { assert(n <= m_maxVertexCount); m_vertexCount = n; }
+
 protected:
 	GLMesh(unsigned int mode);
 	virtual ~GLMesh();
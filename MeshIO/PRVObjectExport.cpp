@@ -54,7 +54,7 @@ bool PRVObjectExport::Write(const char* szfile)
 		ret = false;
 	}
 
-	ar.Close();
+	if (ar.Close() == false) ret = false;
 
 	return ret;
 }
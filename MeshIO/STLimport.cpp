@@ -27,10 +27,112 @@ SOFTWARE.*/
 #include "STLimport.h"
 #include <GeomLib/GSurfaceMeshObject.h>
 #include <GeomLib/GModel.h>
+#include <stdint.h>
+
+// size of the read buffer for ascii files
+const size_t STL_BUFFER_SIZE = 1 << 20;
+
+// number of facets read at once from binary files
+const int STL_FACET_BLOCK = 4096;
+
+//-----------------------------------------------------------------------------
+// Parse a floating point number. Returns a pointer to the first character
+// after the number, or null if no number was found.
+static const char* parse_float(const char* sz, float& f)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	while ((*sz == ' ') || (*sz == '\t')) ++sz;
+	const char* s0 = sz;
+
+	bool neg = false;
+	if ((*sz == '-') || (*sz == '+')) { neg = (*sz == '-'); ++sz; }
+
+	// mantissa
+	uint64_t m = 0;
+	int exp10 = 0, ndigits = 0;
+	for (; (*sz >= '0') && (*sz <= '9'); ++sz, ++ndigits)
+	{
+		if (m < 100000000000000000ull) m = 10 * m + (*sz - '0'); else exp10++;
+	}
+	if (*sz == '.')
+	{
+		++sz;
+		for (; (*sz >= '0') && (*sz <= '9'); ++sz, ++ndigits)
+		{
+			if (m < 100000000000000000ull) { m = 10 * m + (*sz - '0'); exp10--; }
+		}
+	}
+	if (ndigits == 0)
+	{
+		// let the standard library deal with inf, nan, etc.
+		char* end = nullptr;
+		f = (float)strtod(s0, &end);
+		return (end == s0 ? nullptr : end);
+	}
+
+	// exponent
+	if ((*sz == 'e') || (*sz == 'E'))
+	{
+		const char* se = sz + 1;
+		bool eneg = false;
+		if ((*se == '-') || (*se == '+')) { eneg = (*se == '-'); ++se; }
+		if ((*se >= '0') && (*se <= '9'))
+		{
+			int e = 0;
+			for (; (*se >= '0') && (*se <= '9'); ++se) if (e < 10000) e = 10 * e + (*se - '0');
+			exp10 += (eneg ? -e : e);
+			sz = se;
+		}
+	}
+
+	double d = (double)m;
+	if (exp10 < 0)
+	{
+		if (exp10 < -22) d = d / 1e22 * pow(10.0, exp10 + 22);
+		else d /= pow10[-exp10];
+	}
+	else if (exp10 > 0)
+	{
+		if (exp10 > 22) d *= pow(10.0, exp10);
+		else d *= pow10[exp10];
+	}
+
+	f = (float)(neg ? -d : d);
+	return sz;
+}
+
+//-----------------------------------------------------------------------------
+// Parse three floating point numbers
+static bool parse_vec3(const char* sz, float* v)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		sz = parse_float(sz, v[i]);
+		if (sz == nullptr) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// check if a line starts with a keyword
+static const char* keyword(const char* szline, const char* sz)
+{
+	size_t l = strlen(sz);
+	if (strncmp(szline, sz, l) != 0) return nullptr;
+	return szline + l;
+}
 
 //-----------------------------------------------------------------------------
 STLimport::STLimport(FSProject& prj) : FSFileImport(prj)
 {
+	m_pfem = nullptr;
+	m_nline = 0;
+	m_bufPos = m_bufEnd = 0;
+	m_eof = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -39,27 +141,43 @@ STLimport::~STLimport(void)
 }
 
 //-----------------------------------------------------------------------------
-// read a line from the input file
-bool STLimport::read_line(char* szline, const char* sz)
+// Read the next line from the input buffer
+char* STLimport::next_line()
 {
-	m_nline++;
+	char* buf = &m_buf[0];
+	while (true)
+	{
+		char* sz = buf + m_bufPos;
+		char* end = buf + m_bufEnd;
+		char* eol = (char*)memchr(sz, '\n', end - sz);
 
-	int l = (int)strlen(sz);
-	if (fgets(szline, 255, m_fp) == 0) return false;
+		// if there is no line end in the buffer, we need to read more data
+		// unless we're at the end of the file, or the buffer is full.
+		if ((eol == nullptr) && !m_eof && (m_bufPos > 0 || m_bufEnd < STL_BUFFER_SIZE))
+		{
+			size_t rem = m_bufEnd - m_bufPos;
+			if (rem > 0) memmove(buf, sz, rem);
+			m_bufPos = 0;
+			m_bufEnd = rem;
+			size_t nread = fread(buf + rem, 1, STL_BUFFER_SIZE - rem, m_fp);
+			if (nread == 0) m_eof = true;
+			m_bufEnd += nread;
+			continue;
+		}
 
-	// remove leading white space
-	int n = 0;
-	while (isspace(szline[n])) ++n;
-	if (n != 0)
-	{
-		char* ch = szline + n;
-		n = 0;
-		while (*ch) szline[n++] = *ch++;
-	}
-	
-	if (strncmp(szline, sz, l) != 0) return false;
+		if (eol == nullptr)
+		{
+			if (sz == end) return nullptr;
+			eol = end;
+		}
+		*eol = 0;
+		m_bufPos = (eol < end ? eol - buf + 1 : m_bufEnd);
+		m_nline++;
 
-	return true;
+		// skip leading white space and empty lines
+		while (isspace(*sz)) ++sz;
+		if (*sz != 0) return sz;
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -75,6 +193,7 @@ bool STLimport::Load(const char* szfile)
 		// try to read binary STL
 		if (read_binary(szfile) == false)
 		{
+			m_Face.clear();
 			return false;
 		}
 	}
@@ -82,6 +201,10 @@ bool STLimport::Load(const char* szfile)
 	// build the nodes
 	GObject* po = build_mesh();
 
+	// we no longer need the facets
+	m_Face.clear(); m_Face.shrink_to_fit();
+	m_Node.clear(); m_Node.shrink_to_fit();
+
 //	static int nc = 1;
 //	char sz[256];
 //	sprintf(sz, "STL-Object%02d", nc++);
@@ -107,50 +230,55 @@ bool STLimport::read_ascii(const char* szfile)
 	m_nline = 0;
 
 	// try to open the file
-	if (Open(szfile, "rt") == false) return errf("Failed opening file %s.", szfile);
+	if (Open(szfile, "rb") == false) return errf("Failed opening file %s.", szfile);
+
+	// setup the read buffer (one extra byte for the terminating zero)
+	m_buf.resize(STL_BUFFER_SIZE + 1);
+	m_bufPos = m_bufEnd = 0;
+	m_eof = false;
 
 	// read the first line
-	char szline[256] = { 0 };
-	if (read_line(szline, "solid") == false) return errf("First line must be solid definition.");
+	char* szline = next_line();
+	if ((szline == nullptr) || (keyword(szline, "solid") == nullptr)) return errf("First line must be solid definition.");
 
 	// clear the list
 	m_Face.clear();
 
 	// read all the triangles
-	int nc = 0;
 	FACET face;
 	do
 	{
 		// read the facet line
-		if (read_line(szline, "facet normal") == false)
+		szline = next_line();
+		if (szline == nullptr) return errf("Unexpected end of file.");
+		const char* sz = keyword(szline, "facet normal");
+		if (sz == nullptr)
 		{
 			// check for the endsolid tag
-			if (strncmp(szline, "endsolid", 8) == 0) break;
+			if (keyword(szline, "endsolid")) break;
 			else return errf("Error encountered at line %d", m_nline);
 		}
+		if (parse_vec3(sz, face.norm) == false) return errf("Error encountered at line %d", m_nline);
 
 		// read the outer loop line
-		if (read_line(szline, "outer loop") == false) return errf("Error encountered at line %d", m_nline);
+		szline = next_line();
+		if ((szline == nullptr) || (keyword(szline, "outer loop") == nullptr)) return errf("Error encountered at line %d", m_nline);
 
 		// read the vertex data
-		float x, y, z;
-		if (read_line(szline, "vertex ") == false) return errf("Error encountered at line %d", m_nline);
-		sscanf(szline, "vertex %g%g%g", &x, &y, &z);
-		face.v1[0] = x;	face.v1[1] = y; face.v1[2] = z;
-
-		if (read_line(szline, "vertex ") == false) return errf("Error encountered at line %d", m_nline);
-		sscanf(szline, "vertex %g%g%g", &x, &y, &z);
-		face.v2[0] = x;	face.v2[1] = y; face.v2[2] = z;
-
-		if (read_line(szline, "vertex ") == false) return errf("Error encountered at line %d", m_nline);
-		sscanf(szline, "vertex %g%g%g", &x, &y, &z);
-		face.v3[0] = x;	face.v3[1] = y; face.v3[2] = z;
+		for (int i = 0; i < 3; ++i)
+		{
+			szline = next_line();
+			if ((szline == nullptr) || ((sz = keyword(szline, "vertex")) == nullptr)) return errf("Error encountered at line %d", m_nline);
+			if (parse_vec3(sz, face.v[i]) == false) return errf("Error encountered at line %d", m_nline);
+		}
 
 		// read the endloop tag
-		if (read_line(szline, "endloop") == false) return errf("Error encountered at line %d", m_nline);
+		szline = next_line();
+		if ((szline == nullptr) || (keyword(szline, "endloop") == nullptr)) return errf("Error encountered at line %d", m_nline);
 
 		// read the endfacet tag
-		if (read_line(szline, "endfacet") == false) return errf("Error encountered at line %d", m_nline);
+		szline = next_line();
+		if ((szline == nullptr) || (keyword(szline, "endfacet") == nullptr)) return errf("Error encountered at line %d", m_nline);
 
 		// add the facet to the list
 		m_Face.push_back(face);
@@ -159,19 +287,8 @@ bool STLimport::read_ascii(const char* szfile)
 	// close the file
 	Close();
 
-	return true;
-}
+	m_buf.clear(); m_buf.shrink_to_fit();
 
-//-----------------------------------------------------------------------------
-// read a line from the input file
-bool STLimport::read_facet(STLimport::FACET& f)
-{
-	unsigned short att;
-	if (fread(f.norm, sizeof(float), 3, m_fp) != 3) return false;
-	if (fread(f.v1, sizeof(float), 3, m_fp) != 3) return false;
-	if (fread(f.v2, sizeof(float), 3, m_fp) != 3) return false;
-	if (fread(f.v3, sizeof(float), 3, m_fp) != 3) return false;
-	if (fread(&att, sizeof(att), 1, m_fp) != 1) return false;
 	return true;
 }
 
@@ -194,18 +311,30 @@ bool STLimport::read_binary(const char* szfile)
 
 	// read the number of triangles
 	int numtri = 0;
-	fread(&numtri, sizeof(int), 1, m_fp);
+	if (fread(&numtri, sizeof(int), 1, m_fp) != 1) return errf("Failed reading number of triangles.");
 	if (numtri <= 0) return errf("Invalid number of triangles.");
 
-	// read all the triangles
-	FACET face;
-	for (int i = 0; i < numtri; ++i)
+	// Each facet is stored as 12 floats (normal and three vertices) followed by a 2-byte 
+	// attribute. Make sure the file is large enough before we allocate the facets.
+	const int FACET_SIZE = 12 * sizeof(float) + 2;
+	if (84 + (unsigned long long)FACET_SIZE * (unsigned long long)numtri > (unsigned long long)FileSize())
+		return errf("Invalid number of triangles.");
+
+	// read all the triangles.
+	m_Face.resize(numtri);
+	std::vector<char> buf(STL_FACET_BLOCK * FACET_SIZE);
+	for (int i = 0; i < numtri; i += STL_FACET_BLOCK)
 	{
-		// read the facet line
-		if (read_facet(face) == false) return errf("Error encountered reading triangle data.");
+		int nf = (numtri - i < STL_FACET_BLOCK ? numtri - i : STL_FACET_BLOCK);
+		if ((int)fread(&buf[0], FACET_SIZE, nf, m_fp) != nf) return errf("Error encountered reading triangle data.");
 
-		// add the facet to the list
-		m_Face.push_back(face);
+		for (int j = 0; j < nf; ++j)
+		{
+			FACET& face = m_Face[i + j];
+			const char* d = &buf[0] + j * FACET_SIZE;
+			memcpy(face.norm, d, 3 * sizeof(float));
+			memcpy(face.v, d + 3 * sizeof(float), 9 * sizeof(float));
+		}
 	}
 
 	// close the file
@@ -218,50 +347,11 @@ bool STLimport::read_binary(const char* szfile)
 // Build the FE model
 GObject* STLimport::build_mesh()
 {
-	int i;
-
 	// number of facets
 	int NF = (int)m_Face.size();
 
-	// find the bounding box of the model
-	BOX& b = m_box = BoundingBox();
-	double h = 0.01*b.GetMaxExtent();
-	b.Inflate(h,h,h);
-	vec3d r0(b.x0, b.y0, b.z0);
-	vec3d r1(b.x1, b.y1, b.z1);
-
-	// create the box partition
-	int NB = m_NB = (int) pow((double) (NF*3), 0.17) + 1;
-	m_BL.resize(NB*NB*NB);
-	int n = 0;
-	for (i=0; i<NB; ++i)
-		for (int j=0; j<NB; ++j)
-			for (int k=0; k<NB; ++k)
-			{
-				OBOX& bn = m_BL[n++];
-				bn.r0.x = r0.x + i*(r1.x - r0.x)/NB;
-				bn.r0.y = r0.x + j*(r1.x - r0.x)/NB;
-				bn.r0.z = r0.x + k*(r1.x - r0.x)/NB;
-
-				bn.r1.x = r0.x + (i+1)*(r1.x - r0.x)/NB;
-				bn.r1.y = r0.x + (j+1)*(r1.x - r0.x)/NB;
-				bn.r1.z = r0.x + (k+1)*(r1.x - r0.x)/NB;
-			}
-
-	// reserve space for nodes
-	m_Node.reserve(NF*3);
-	
-	// create the nodes
-	list<FACET>::iterator pf = m_Face.begin();
-	int nid = 0;
-	for (i=0; i<NF; ++i, ++pf)
-	{
-		FACET& f = *pf;
-        vec3d v1 = vec3d(f.v1[0], f.v1[1], f.v1[2]); f.n[0] = find_node(v1);
-        vec3d v2 = vec3d(f.v2[0], f.v2[1], f.v2[2]); f.n[1] = find_node(v2);
-        vec3d v3 = vec3d(f.v3[0], f.v3[1], f.v3[2]); f.n[2] = find_node(v3);
-		f.nid = nid++;
-	}
+	// find the nodes
+	weld_nodes();
 	int NN = (int)m_Node.size();
 
 	// create the mesh
@@ -269,28 +359,22 @@ GObject* STLimport::build_mesh()
 	pm->Create(NN, 0, NF);
 
 	// create nodes
-	for (i=0; i<NN; ++i)
+	for (int i=0; i<NN; ++i)
 	{
-		vec3d& ri = m_Node[i].r;
 		FSNode& node = pm->Node(i);
-		node.pos(ri);
+		node.pos(m_Node[i]);
 	}
 
 	// create elements
-	list<FACET>::iterator is = m_Face.begin();
-	for (i=0; i<NF; ++i, ++is)
+	for (int i=0; i<NF; ++i)
 	{
-		FACET& f = *is;
-		int n = f.nid;
-		if (n >= 0)
-		{
-			FSFace& face = pm->Face(n);
-			face.SetType(FE_FACE_TRI3);
-			face.m_gid = 0;
-			face.n[0] = f.n[0];
-			face.n[1] = f.n[1];
-			face.n[2] = f.n[2];
-		}
+		FACET& f = m_Face[i];
+		FSFace& face = pm->Face(i);
+		face.SetType(FE_FACE_TRI3);
+		face.m_gid = 0;
+		face.n[0] = f.n[0];
+		face.n[1] = f.n[1];
+		face.n[2] = f.n[2];
 	}
 
 	// update the mesh
@@ -301,52 +385,123 @@ GObject* STLimport::build_mesh()
 }
 
 //-----------------------------------------------------------------------------
-int STLimport::FindBox(const vec3d& r)
+// Vertices whose squared distance is less than eps are merged. The vertices 
+// are hashed on a grid, and the neighbouring cells are only checked for vertices 
+// that are within the tolerance of a cell boundary. Each vertex is mapped to the 
+// first vertex that it coincides with, and nodes are numbered in the order 
+// in which they first appear.
+void STLimport::weld_nodes(const double eps)
 {
-	BOX& b = m_box;
-	int i = (int)(m_NB*(r.x - b.x0)/(b.x1 - b.x0));
-	int j = (int)(m_NB*(r.y - b.y0)/(b.y1 - b.y0));
-	int k = (int)(m_NB*(r.z - b.z0)/(b.z1 - b.z0));
-	return k + j*(m_NB + i*m_NB);
-}
+	int NF = (int)m_Face.size();
+	int NV = 3 * NF;
+	m_Node.clear();
+	if (NF == 0) return;
+
+	// vertex positions
+	auto vertex = [=](int i) {
+		const float* v = m_Face[i / 3].v[i % 3];
+		return vec3d(v[0], v[1], v[2]);
+	};
+
+	// The cell size is chosen so that a cell contains a few distinct vertices 
+	// on average, but is never smaller than twice the tolerance.
+	double tol = sqrt(eps);
+	BOX box;
+	for (int i = 0; i < NV; ++i) box += vertex(i);
+	double h = box.GetMaxExtent() / sqrt((double)NV);
+	if (h < 2 * tol) h = 2 * tol;
+	if (h <= 0.0) h = 1.0;
+	double hi = 1.0 / h;
+
+	// size of hash table
+	int T = 1;
+	while (T < NV) T <<= 1;
+	const uint64_t mask = (uint64_t)T - 1;
+
+	// hash function for grid cells
+	auto cellHash = [=](int64_t i, int64_t j, int64_t k) {
+		uint64_t a = (uint64_t)i * 0x9E3779B97F4A7C15ull;
+		uint64_t b = (uint64_t)j * 0xC2B2AE3D27D4EB4Full;
+		uint64_t c = (uint64_t)k * 0x165667B19E3779F9ull;
+		uint64_t v = a ^ b ^ c;
+		return (int)((v ^ (v >> 29)) & mask);
+	};
+
+	// bucket of each vertex
+	std::vector<int> bucket(NV);
+#pragma omp parallel for
+	for (int i = 0; i < NV; ++i)
+	{
+		vec3d r = vertex(i);
+		bucket[i] = cellHash((int64_t)floor(r.x*hi), (int64_t)floor(r.y*hi), (int64_t)floor(r.z*hi));
+	}
 
-//-----------------------------------------------------------------------------
-int STLimport::find_node(const vec3d& r, const double eps)
-{
-	// get the box in which this node lies
-	int nb = FindBox(r);
-	assert((nb >= 0)&&(nb<(int)m_BL.size()));
-	OBOX& b = m_BL[nb];
-
-	// see if this node is already in this box
-	int N = (int)b.NL.size();
-	for (int i=0; i<N; ++i)
+	// sort the vertices into the buckets (vertices in a bucket are in ascending order)
+	std::vector<int> start(T + 1, 0);
+	for (int i = 0; i < NV; ++i) start[bucket[i] + 1]++;
+	for (int i = 0; i < T; ++i) start[i + 1] += start[i];
+	std::vector<int> item(NV);
 	{
-		NODE& ni = m_Node[b.NL[i]];
-		vec3d& ri = ni.r;
-		if ((ri - r)*(ri - r) < eps) return ni.n;
+		std::vector<int> pos(start.begin(), start.end() - 1);
+		for (int i = 0; i < NV; ++i) item[pos[bucket[i]]++] = i;
 	}
+	bucket.clear(); bucket.shrink_to_fit();
 
-	N = (int)m_Node.size();
-	NODE nd;
-	nd.r = r;
-	nd.n = N;
-	m_Node.push_back(nd);
-	b.NL.push_back(nd.n);
-	return nd.n;
-}
+	// for each vertex, find the first vertex that it coincides with
+	std::vector<int> rep(NV);
+#pragma omp parallel for schedule(dynamic, 4096)
+	for (int i = 0; i < NV; ++i)
+	{
+		vec3d r = vertex(i);
+		double x = r.x*hi, y = r.y*hi, z = r.z*hi;
+		int64_t c[3] = { (int64_t)floor(x), (int64_t)floor(y), (int64_t)floor(z) };
+
+		// range of neighbouring cells that need to be checked
+		double t = tol*hi;
+		int d0[3], d1[3];
+		double f[3] = { x - c[0], y - c[1], z - c[2] };
+		for (int l = 0; l < 3; ++l)
+		{
+			d0[l] = (f[l] < t ? -1 : 0);
+			d1[l] = (f[l] > 1.0 - t ? 1 : 0);
+		}
 
-//-----------------------------------------------------------------------------
-BOX STLimport::BoundingBox()
-{
-	list<FACET>::iterator pf = m_Face.begin();
-	vec3d r = vec3d(pf->v1[0], pf->v1[1], pf->v1[2]);
-	BOX b(r, r);
-	for (pf = m_Face.begin(); pf != m_Face.end(); ++pf)
+		int jmin = i;
+		for (int di = d0[0]; di <= d1[0]; ++di)
+			for (int dj = d0[1]; dj <= d1[1]; ++dj)
+				for (int dk = d0[2]; dk <= d1[2]; ++dk)
+				{
+					int b = cellHash(c[0] + di, c[1] + dj, c[2] + dk);
+					for (int n = start[b]; n < start[b + 1]; ++n)
+					{
+						int j = item[n];
+						if (j >= jmin) break;
+						vec3d rj = vertex(j);
+						if ((rj - r)*(rj - r) < eps) { jmin = j; break; }
+					}
+				}
+		rep[i] = jmin;
+	}
+
+	// number the nodes. Since rep[i] <= i, the representatives are resolved in order.
+	std::vector<int> nodeId(NV, -1);
+	m_Node.reserve(NV / 2);
+	for (int i = 0; i < NV; ++i)
+	{
+		int j = rep[i];
+		if (j == i)
+		{
+			nodeId[i] = (int)m_Node.size();
+			m_Node.push_back(vertex(i));
+		}
+		else nodeId[i] = nodeId[j];
+	}
+
+	for (int i = 0; i < NF; ++i)
 	{
-		b += vec3d(pf->v1[0], pf->v1[1], pf->v1[2]);
-		b += vec3d(pf->v2[0], pf->v2[1], pf->v2[2]);
-		b += vec3d(pf->v3[0], pf->v3[1], pf->v3[2]);
+		FACET& f = m_Face[i];
+		f.n[0] = nodeId[3 * i];
+		f.n[1] = nodeId[3 * i + 1];
+		f.n[2] = nodeId[3 * i + 2];
 	}
-	return b;
 }
@@ -30,39 +30,14 @@ SOFTWARE.*/
 #include <FEMLib/FSProject.h>
 
 #include <vector>
-#include <list>
 
 class STLimport : public FSFileImport
 {
 	struct FACET
 	{
 		float	norm[3];
-		float	v1[3];
-		float	v2[3];
-		float	v3[3];
+		float	v[3][3];
 		int		n[3];
-		int		nid;
-	};
-
-	struct NODE
-	{
-		vec3d	r;
-		int		n;
-	};
-
-	class OBOX
-	{
-	public:
-		vec3d		r0, r1;		// points defining box
-		std::vector<int>	NL;			// list of nodes inside this box
-
-	public:
-		OBOX(){}
-		OBOX(const OBOX& b) 
-		{
-			r0 = b.r0; r1 = b.r1;
-			NL = b.NL; 
-		}
 	};
 
 public:
@@ -72,29 +47,28 @@ public:
 	bool Load(const char* szfile);
 
 protected:
-	bool read_line(char* szline, const char* sz);
-
 	GObject* build_mesh();
-	int find_node(const vec3d& r, const double eps = 1e-14);
-	int FindBox(const vec3d& r);
 
-	::BOX BoundingBox();
+	// merge coincident vertices and set the facet node numbers
+	void weld_nodes(const double eps = 1e-14);
 
 private:
 	bool read_ascii(const char* szfile);
 	bool read_binary(const char* szfile);
 
 private:
-	bool read_facet(FACET& f);
+	// returns the next non-empty line (without leading white space) or null at end of file
+	char* next_line();
 
 protected:
 	FSModel*			m_pfem;
-	std::list<FACET>	m_Face;
-	std::vector<NODE>	m_Node;
+	std::vector<FACET>	m_Face;
+	std::vector<vec3d>	m_Node;
 	int					m_nline;	// line counter
 
-	int					m_NB;
-	std::vector<OBOX>	m_BL;		// box lists
-
-	BOX				m_box;		// bounding box
+	// buffer for reading ascii files
+	std::vector<char>	m_buf;
+	size_t				m_bufPos;
+	size_t				m_bufEnd;
+	bool				m_eof;
 };
@@ -28,6 +28,88 @@ SOFTWARE.*/
 #include <GeomLib/GMeshObject.h>
 #include <GeomLib/GModel.h>
 #include <XML/XMLReader.h>
+#include <stdint.h>
+#include <algorithm>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef WIN32
+#define ftell64(a)     _ftelli64(a)
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+#define ftell64(a)     ftello(a)
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+//-----------------------------------------------------------------------------
+// read a value from a byte buffer, swapping the bytes if needed
+template <class T> static inline T readValue(const unsigned char* p, bool swap)
+{
+	T v;
+	if (swap)
+	{
+		unsigned char b[sizeof(T)];
+		for (size_t i = 0; i < sizeof(T); ++i) b[i] = p[sizeof(T) - 1 - i];
+		memcpy(&v, b, sizeof(T));
+	}
+	else memcpy(&v, p, sizeof(T));
+	return v;
+}
+
+//-----------------------------------------------------------------------------
+// Decode base64 encoded text. VTK encodes the header and data of a compressed
+// block separately, so padding can appear in the middle of the text. Decoding
+// stops at the end of the text or at the start of the next xml tag.
+static bool decodeBase64(const char* sz, size_t len, std::vector<unsigned char>& out)
+{
+	// lookup table: -2 = invalid character, -1 = padding
+	static const std::vector<int> table = []() {
+		std::vector<int> t(256, -2);
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 64; ++i) t[(unsigned char)alphabet[i]] = i;
+		t[(unsigned char)'='] = -1;
+		return t;
+	}();
+
+	out.clear();
+	out.reserve(3 * (len / 4) + 3);
+
+	unsigned int q = 0;	// current quantum
+	int nq = 0;			// nr of characters in quantum
+	int npad = 0;		// nr of padding characters in quantum
+	for (size_t i = 0; i < len; ++i)
+	{
+		unsigned char c = (unsigned char)sz[i];
+		if ((c == 0) || (c == '<')) break;
+		int v = table[c];
+		if (v == -2)
+		{
+			if (isspace(c)) continue;
+			return false;
+		}
+		if (v == -1) { npad++; v = 0; }
+		else if (npad > 0) return false;
+
+		q = (q << 6) | v;
+		if (++nq == 4)
+		{
+			out.push_back((unsigned char)(q >> 16));
+			if (npad < 2) out.push_back((unsigned char)(q >> 8));
+			if (npad < 1) out.push_back((unsigned char)q);
+			q = 0; nq = 0; npad = 0;
+		}
+	}
+	return (nq == 0);
+}
 
 class VTKDataArray
 {
@@ -37,12 +119,15 @@ public:
 		UINT8,
 		INT32,
 		INT64,
-		FLOAT32
+		FLOAT32,
+		FLOAT64
 	};
 
 	enum Format
 	{
-		ASCII
+		ASCII,
+		BINARY,
+		APPENDED
 	};
 
 public:
@@ -51,6 +136,7 @@ public:
 		m_type = -1;
 		m_format = -1;
 		m_numComps = 1;
+		m_offset = -1;
 	}
 
 	VTKDataArray(const VTKDataArray& data)
@@ -58,6 +144,7 @@ public:
 		m_type = data.m_type;
 		m_format = data.m_format;
 		m_numComps = data.m_numComps;
+		m_offset = data.m_offset;
 
 		m_values_float = data.m_values_float;
 		m_values_int = data.m_values_int;
@@ -68,6 +155,7 @@ public:
 		m_type = data.m_type;
 		m_format = data.m_format;
 		m_numComps = data.m_numComps;
+		m_offset = data.m_offset;
 
 		m_values_float = data.m_values_float;
 		m_values_int = data.m_values_int;
@@ -76,12 +164,17 @@ public:
 	int	m_type;
 	int m_format;
 	int m_numComps;
+	off_type m_offset;	// offset into appended data
+
+	bool isFloat() const { return (m_type == FLOAT32) || (m_type == FLOAT64); }
 
 	size_t size() const
 	{
 		switch (m_type)
 		{
-		case FLOAT32: return (m_values_float.size() / m_numComps); break;
+		case FLOAT32: 
+		case FLOAT64:
+			return (m_values_float.size() / m_numComps); break;
 		case UINT8:
 		case INT32:
 		case INT64:
@@ -94,6 +187,61 @@ public:
 		return 0;
 	}
 
+	// size in bytes of a single value
+	size_t typeSize() const
+	{
+		switch (m_type)
+		{
+		case UINT8  : return 1;
+		case INT32  : return 4;
+		case INT64  : return 8;
+		case FLOAT32: return 4;
+		case FLOAT64: return 8;
+		default:
+			assert(false);
+		}
+		return 0;
+	}
+
+	// set the values from binary data
+	bool setData(const unsigned char* p, size_t nbytes, bool swap)
+	{
+		size_t ts = typeSize();
+		if ((ts == 0) || (nbytes % ts != 0)) return false;
+		int n = (int)(nbytes / ts);
+		switch (m_type)
+		{
+		case UINT8:
+			m_values_int.resize(n);
+#pragma omp parallel for
+			for (int i = 0; i < n; ++i) m_values_int[i] = p[i];
+			break;
+		case INT32:
+			m_values_int.resize(n);
+#pragma omp parallel for
+			for (int i = 0; i < n; ++i) m_values_int[i] = readValue<int32_t>(p + 4 * (size_t)i, swap);
+			break;
+		case INT64:
+			m_values_int.resize(n);
+#pragma omp parallel for
+			for (int i = 0; i < n; ++i) m_values_int[i] = (int)readValue<int64_t>(p + 8 * (size_t)i, swap);
+			break;
+		case FLOAT32:
+			m_values_float.resize(n);
+#pragma omp parallel for
+			for (int i = 0; i < n; ++i) m_values_float[i] = readValue<float>(p + 4 * (size_t)i, swap);
+			break;
+		case FLOAT64:
+			m_values_float.resize(n);
+#pragma omp parallel for
+			for (int i = 0; i < n; ++i) m_values_float[i] = readValue<double>(p + 8 * (size_t)i, swap);
+			break;
+		default:
+			return false;
+		}
+		return true;
+	}
+
 	void get(int n, double* v) const { *v = m_values_float[n]; }
 	void get(int n, int*    v) const { *v = m_values_int[n]; }
 
@@ -228,7 +376,11 @@ public:
 
 VTUimport::VTUimport(FSProject& prj) : FSFileImport(prj)
 {
-
+	m_headerSize = 4;
+	m_bigEndian = false;
+	m_compressed = false;
+	m_appendedBase64 = false;
+	m_appendedStart = -1;
 }
 
 VTUimport::~VTUimport(void)
@@ -238,9 +390,24 @@ VTUimport::~VTUimport(void)
 
 bool VTUimport::Load(const char* szfile)
 {
+	m_headerSize = 4;
+	m_bigEndian = false;
+	m_compressed = false;
+	m_appendedBase64 = false;
+	m_appendedStart = -1;
+
+	// The appended data section can contain raw binary data, which the xml reader
+	// cannot process. In that case, we only pass it the xml text that precedes it.
+	std::string xmlHeader;
+	if (FindAppendedData(szfile, xmlHeader) == false) return false;
+
 	// Open the file
 	XMLReader xml;
-	if (xml.Open(szfile, false) == false) return false;
+	if (xmlHeader.empty())
+	{
+		if (xml.Open(szfile, false) == false) return false;
+	}
+	else if (xml.OpenString(xmlHeader) == false) return false;
 
 	// get the VTKFile tag
 	XMLTag tag;
@@ -251,6 +418,20 @@ bool VTUimport::Load(const char* szfile)
 	if (sztype == nullptr) return false;
 	if (strcmp(sztype, "UnstructuredGrid") != 0) return false;
 
+	// settings for binary data
+	const char* szheader = tag.AttributeValue("header_type", true);
+	if (szheader && (strcmp(szheader, "UInt64") == 0)) m_headerSize = 8;
+
+	const char* szorder = tag.AttributeValue("byte_order", true);
+	if (szorder && (strcmp(szorder, "BigEndian") == 0)) m_bigEndian = true;
+
+	const char* szcompressor = tag.AttributeValue("compressor", true);
+	if (szcompressor && szcompressor[0])
+	{
+		if (strcmp(szcompressor, "vtkZLibDataCompressor") != 0) return errf("Unsupported compressor %s", szcompressor);
+		m_compressed = true;
+	}
+
 	VTKModel vtk;
 
 	// parse the file
@@ -273,6 +454,14 @@ bool VTUimport::Load(const char* szfile)
 
 	xml.Close();
 
+	// read the appended data
+	if (ReadAppendedData(szfile, vtk) == false) return false;
+
+	for (int i = 0; i < vtk.Pieces(); ++i)
+	{
+		if (CheckPiece(vtk.Piece(i)) == false) return false;
+	}
+
 	return BuildMesh(vtk);
 }
 
@@ -331,9 +520,8 @@ bool VTUimport::ParsePoints(XMLTag& tag, VTKPiece& piece)
 			VTKDataArray& points = piece.m_points;
 			if (ParseDataArray(tag, points) == false) return false;
 
-			if (points.m_type != VTKDataArray::FLOAT32) return false;
+			if (points.isFloat() == false) return false;
 			if (points.m_numComps != 3) return false;
-			if (points.m_values_float.size() != piece.m_numPoints * points.m_numComps) return false;
 		}
 		else tag.skip();
 	} while (!tag.isend());
@@ -362,8 +550,8 @@ bool VTUimport::ParseCells(XMLTag& tag, VTKPiece& piece)
 			else if (strcmp(szname, "types") == 0)
 			{
 				if (ParseDataArray(tag, piece.m_cell_types) == false) return false;
-				if (piece.m_cell_types.m_values_int.size() != piece.m_numCells) return errf("Error reading cell types");
 			}
+			else tag.skip();
 		}
 		else tag.skip();
 	} 
@@ -374,39 +562,71 @@ bool VTUimport::ParseCells(XMLTag& tag, VTKPiece& piece)
 	return true;
 }
 
+// check that all the data of a piece was read
+bool VTUimport::CheckPiece(VTKPiece& piece)
+{
+	VTKDataArray& points = piece.m_points;
+	if (points.m_values_float.size() != piece.m_numPoints * points.m_numComps) return errf("Error reading points");
+	if (piece.m_cell_types.m_values_int.size() != piece.m_numCells) return errf("Error reading cell types");
+	if (piece.m_cell_offsets.m_values_int.size() != piece.m_numCells) return errf("Error reading cell offsets");
+
+	// make sure the offsets are consistent with the connectivity
+	std::vector<int>& offsets = piece.m_cell_offsets.m_values_int;
+	int nconn = (int)piece.m_cell_connect.m_values_int.size();
+	int n0 = 0;
+	for (int i = 0; i < piece.m_numCells; ++i)
+	{
+		int n1 = offsets[i];
+		if ((n1 < n0) || (n1 > nconn) || (n1 - n0 > VTKCell::MAX_NODES)) return errf("Error reading cell offsets");
+		n0 = n1;
+	}
+
+	return true;
+}
+
 bool VTUimport::ParseDataArray(XMLTag& tag, VTKDataArray& vtkDataArray)
 {
-	// make sure this is an ascii format
+	// get the format
 	const char* szformat = tag.AttributeValue("Format", true);
 	if (szformat == nullptr) szformat = tag.AttributeValue("format");
-	if (strcmp(szformat, "ascii") != 0) return false;
-	vtkDataArray.m_format = VTKDataArray::ASCII;
+	if      (strcmp(szformat, "ascii"   ) == 0) vtkDataArray.m_format = VTKDataArray::ASCII;
+	else if (strcmp(szformat, "binary"  ) == 0) vtkDataArray.m_format = VTKDataArray::BINARY;
+	else if (strcmp(szformat, "appended") == 0) vtkDataArray.m_format = VTKDataArray::APPENDED;
+	else return errf("Unknown data array format %s", szformat);
 
 	// get the type
 	const char* sztype = tag.AttributeValue("type");
 	if      (strcmp(sztype, "Float32") == 0) vtkDataArray.m_type = VTKDataArray::FLOAT32;
+	else if (strcmp(sztype, "Float64") == 0) vtkDataArray.m_type = VTKDataArray::FLOAT64;
 	else if (strcmp(sztype, "UInt8"  ) == 0) vtkDataArray.m_type = VTKDataArray::UINT8;
 	else if (strcmp(sztype, "Int64"  ) == 0) vtkDataArray.m_type = VTKDataArray::INT64;
-	else if (strcmp(sztype, "Int32"  ) == 0) vtkDataArray.m_type = VTKDataArray::INT64;
+	else if (strcmp(sztype, "Int32"  ) == 0) vtkDataArray.m_type = VTKDataArray::INT32;
 	else return errf("Unknown data array type %s", sztype);
 
 	// get the number of components
 	vtkDataArray.m_numComps = tag.AttributeValue<int>("NumberOfComponents", 1);
 
 	// get the value
-	if (vtkDataArray.m_type == VTKDataArray::FLOAT32)
+	if (vtkDataArray.m_format == VTKDataArray::APPENDED)
 	{
-		tag.value(vtkDataArray.m_values_float);
+		// the data is read after the xml is processed
+		if (m_appendedStart < 0) return errf("Missing appended data");
+		const char* szoff = tag.AttributeValue("offset");
+		vtkDataArray.m_offset = (off_type)strtoll(szoff, nullptr, 10);
+		if (vtkDataArray.m_offset < 0) return errf("Invalid data array offset");
 	}
-	else if (vtkDataArray.m_type == VTKDataArray::UINT8)
+	else if (vtkDataArray.m_format == VTKDataArray::BINARY)
 	{
-		tag.value2(vtkDataArray.m_values_int);
+		const char* szval = tag.szvalue();
+		std::vector<unsigned char> buf;
+		if ((szval == nullptr) || (decodeBase64(szval, strlen(szval), buf) == false)) return errf("Error decoding binary data");
+		if (DecodeDataBlock(buf.data(), buf.size(), vtkDataArray) == false) return false;
 	}
-	else if (vtkDataArray.m_type == VTKDataArray::INT32)
+	else if (vtkDataArray.isFloat())
 	{
-		tag.value2(vtkDataArray.m_values_int);
+		tag.value(vtkDataArray.m_values_float);
 	}
-	else if (vtkDataArray.m_type == VTKDataArray::INT64)
+	else
 	{
 		tag.value2(vtkDataArray.m_values_int);
 	}
@@ -417,6 +637,221 @@ bool VTUimport::ParseDataArray(XMLTag& tag, VTKDataArray& vtkDataArray)
 	return true;
 }
 
+// Binary data blocks start with a header. For uncompressed data, this is just the
+// number of bytes. For compressed data, the header contains the number of blocks, 
+// the (uncompressed) block size, the size of the last block and the compressed 
+// size of each block. The blocks are decompressed in parallel.
+bool VTUimport::DecodeDataBlock(const unsigned char* buf, size_t size, VTKDataArray& data)
+{
+	const size_t H = m_headerSize;
+	auto header = [=](size_t i) {
+		return (H == 8 ? (uint64_t)readValue<uint64_t>(buf + 8 * i, m_bigEndian) : (uint64_t)readValue<uint32_t>(buf + 4 * i, m_bigEndian));
+	};
+
+	if (m_compressed == false)
+	{
+		if (size < H) return errf("Error decoding binary data");
+		uint64_t nbytes = header(0);
+		if (H + nbytes > size) return errf("Error decoding binary data");
+		if (data.setData(buf + H, (size_t)nbytes, m_bigEndian) == false) return errf("Error decoding binary data");
+		return true;
+	}
+
+#ifdef HAVE_ZLIB
+	if (size < 3 * H) return errf("Error decoding compressed data");
+	int nb = (int)header(0);
+	uint64_t bs = header(1);
+	uint64_t last = header(2);
+	if ((nb < 0) || (size < (3 + (size_t)nb) * H)) return errf("Error decoding compressed data");
+	if (nb == 0) return data.setData(buf, 0, m_bigEndian);
+
+	// offsets of the compressed blocks
+	std::vector<size_t> off(nb + 1);
+	off[0] = (3 + nb) * H;
+	for (int i = 0; i < nb; ++i) off[i + 1] = off[i] + (size_t)header(3 + i);
+	if (off[nb] > size) return errf("Error decoding compressed data");
+
+	size_t total = (size_t)((nb - 1) * bs + (last > 0 ? last : bs));
+	std::vector<unsigned char> out(total);
+
+	int errors = 0;
+#pragma omp parallel for reduction(+:errors)
+	for (int i = 0; i < nb; ++i)
+	{
+		uLongf n = (uLongf)(i == nb - 1 ? total - i * bs : bs);
+		uLongf nout = n;
+		int ret = uncompress(out.data() + i * bs, &nout, buf + off[i], (uLong)(off[i + 1] - off[i]));
+		if ((ret != Z_OK) || (nout != n)) errors++;
+	}
+	if (errors > 0) return errf("Error decompressing data");
+
+	if (data.setData(out.data(), total, m_bigEndian) == false) return errf("Error decoding compressed data");
+	return true;
+#else
+	return errf("Reading compressed data requires zlib.");
+#endif
+}
+
+// search for a string in a file, starting at the current file position.
+// Returns the file position of the string, or -1 if it's not found.
+static off_type findInFile(FILE* fp, const char* sz)
+{
+	const size_t BUFSIZE = 1 << 20;
+	size_t l = strlen(sz);
+	std::vector<char> buf(BUFSIZE + l);
+	off_type pos = ftell64(fp);
+	size_t nkeep = 0;
+	while (true)
+	{
+		size_t nread = fread(buf.data() + nkeep, 1, BUFSIZE, fp);
+		if (nread == 0) return -1;
+		size_t n = nkeep + nread;
+		const char* start = buf.data();
+		const char* end = start + n;
+		const char* p = std::search(start, end, sz, sz + l);
+		if (p != end) return pos + (p - start);
+
+		// keep the tail, in case the string straddles the buffers
+		nkeep = (n < l - 1 ? n : l - 1);
+		memmove(buf.data(), end - nkeep, nkeep);
+		pos += n - nkeep;
+	}
+}
+
+bool VTUimport::FindAppendedData(const char* szfile, std::string& xmlHeader)
+{
+	xmlHeader.clear();
+	if (Open(szfile, "rb") == false) return errf("Failed opening file %s", szfile);
+
+	// only look for appended data if the start of the file refers to it
+	const size_t HEAD_SIZE = 65536;
+	std::vector<char> head(HEAD_SIZE);
+	size_t nhead = fread(head.data(), 1, HEAD_SIZE, m_fp);
+	const char* szkey = "appended";
+	if (std::search(head.begin(), head.begin() + nhead, szkey, szkey + strlen(szkey)) == head.begin() + nhead)
+	{
+		Close();
+		return true;
+	}
+
+	// find the start of the appended data section
+	fseek64(m_fp, 0, SEEK_SET);
+	off_type pos = findInFile(m_fp, "<AppendedData");
+	if (pos < 0) { Close(); return true; }
+
+	// read the tag's attributes and find the start of the data, which is marked by an underscore.
+	fseek64(m_fp, pos, SEEK_SET);
+	std::string appendedTag;
+	int c;
+	while (((c = fgetc(m_fp)) != EOF) && (c != '>')) appendedTag.push_back((char)c);
+	while (((c = fgetc(m_fp)) != EOF) && (c != '_'));
+	if (c == EOF) { Close(); return errf("Invalid appended data section"); }
+	m_appendedStart = ftell64(m_fp);
+	m_appendedBase64 = (appendedTag.find("base64") != std::string::npos);
+
+	// read the xml that precedes the appended data
+	xmlHeader.resize((size_t)pos);
+	fseek64(m_fp, 0, SEEK_SET);
+	if (fread(&xmlHeader[0], 1, (size_t)pos, m_fp) != (size_t)pos) { Close(); return errf("Error reading file"); }
+	xmlHeader += "</VTKFile>\n";
+
+	Close();
+	return true;
+}
+
+bool VTUimport::ReadAppendedData(const char* szfile, VTKModel& vtk)
+{
+	if (m_appendedStart < 0) return true;
+
+	// collect all the arrays that are stored in the appended section
+	std::vector<VTKDataArray*> arrays;
+	for (int i = 0; i < vtk.Pieces(); ++i)
+	{
+		VTKPiece& piece = vtk.Piece(i);
+		VTKDataArray* pa[] = { &piece.m_points, &piece.m_cell_connect, &piece.m_cell_offsets, &piece.m_cell_types };
+		for (VTKDataArray* a : pa)
+		{
+			if (a->m_format == VTKDataArray::APPENDED) arrays.push_back(a);
+		}
+	}
+	if (arrays.empty()) return true;
+
+	// base64 encoded arrays don't store their size, so we read each one up to the next array
+	std::vector<off_type> offsets;
+	for (VTKDataArray* a : arrays) offsets.push_back(a->m_offset);
+	std::sort(offsets.begin(), offsets.end());
+
+	if (Open(szfile, "rb") == false) return errf("Failed opening file %s", szfile);
+	for (VTKDataArray* a : arrays)
+	{
+		auto it = std::upper_bound(offsets.begin(), offsets.end(), a->m_offset);
+		off_type end = (it != offsets.end() ? *it : -1);
+		if (ReadAppendedArray(*a, end) == false) { Close(); return false; }
+	}
+	Close();
+
+	return true;
+}
+
+bool VTUimport::ReadAppendedArray(VTKDataArray& data, off_type end)
+{
+	if (fseek64(m_fp, m_appendedStart + data.m_offset, SEEK_SET) != 0) return errf("Error reading appended data");
+
+	std::vector<unsigned char> buf;
+	if (m_appendedBase64)
+	{
+		// read the text up to the next array, or the end of the section
+		std::string text;
+		if (end > data.m_offset)
+		{
+			text.resize((size_t)(end - data.m_offset));
+			text.resize(fread(&text[0], 1, text.size(), m_fp));
+		}
+		else
+		{
+			const size_t CHUNK = 1 << 20;
+			while (true)
+			{
+				size_t n0 = text.size();
+				text.resize(n0 + CHUNK);
+				size_t nread = fread(&text[n0], 1, CHUNK, m_fp);
+				text.resize(n0 + nread);
+				if ((nread == 0) || (text.find('<', n0) != std::string::npos)) break;
+			}
+		}
+		if (decodeBase64(text.data(), text.size(), buf) == false) return errf("Error decoding appended data");
+	}
+	else
+	{
+		// read the header first, so we know how much data follows
+		const size_t H = m_headerSize;
+		auto header = [&](size_t i) {
+			return (H == 8 ? (uint64_t)readValue<uint64_t>(buf.data() + 8 * i, m_bigEndian) : (uint64_t)readValue<uint32_t>(buf.data() + 4 * i, m_bigEndian));
+		};
+
+		size_t nh = (m_compressed ? 3 : 1);
+		buf.resize(nh * H);
+		if (fread(buf.data(), H, nh, m_fp) != nh) return errf("Error reading appended data");
+
+		uint64_t nbytes = 0;
+		if (m_compressed)
+		{
+			size_t nb = (size_t)header(0);
+			if (nb > (1u << 30)) return errf("Error reading appended data");
+			buf.resize((3 + nb) * H);
+			if (fread(buf.data() + 3 * H, H, nb, m_fp) != nb) return errf("Error reading appended data");
+			for (size_t i = 0; i < nb; ++i) nbytes += header(3 + i);
+		}
+		else nbytes = header(0);
+
+		size_t n0 = buf.size();
+		buf.resize(n0 + (size_t)nbytes);
+		if (fread(buf.data() + n0, 1, (size_t)nbytes, m_fp) != (size_t)nbytes) return errf("Error reading appended data");
+	}
+
+	return DecodeDataBlock(buf.data(), buf.size(), data);
+}
+
 bool VTUimport::BuildMesh(VTKModel& vtk)
 {
 	FSModel& fem = m_prj.GetFSModel();
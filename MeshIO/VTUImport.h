@@ -48,6 +48,22 @@ private:
 	bool ParsePoints(XMLTag& tag, VTKPiece& piece);
 	bool ParseCells(XMLTag& tag, VTKPiece& piece);
 	bool ParseDataArray(XMLTag& tag, VTKDataArray& vtkDataArray);
+	bool CheckPiece(VTKPiece& piece);
+
+	// find the appended data section and extract the xml text that precedes it
+	bool FindAppendedData(const char* szfile, std::string& xmlHeader);
+	bool ReadAppendedData(const char* szfile, VTKModel& vtk);
+	bool ReadAppendedArray(VTKDataArray& data, off_type end);
+
+	// decode a binary data block (header followed by the, possibly compressed, data)
+	bool DecodeDataBlock(const unsigned char* buf, size_t size, VTKDataArray& data);
 
 	bool BuildMesh(VTKModel& vtk);
+
+private:
+	int			m_headerSize;		// size of the binary block header values (4 or 8 bytes)
+	bool		m_bigEndian;		// byte order of binary data
+	bool		m_compressed;		// binary data is zlib compressed
+	bool		m_appendedBase64;	// appended data is base64 encoded
+	off_type	m_appendedStart;	// file position of appended data (or -1 if there is none)
 };
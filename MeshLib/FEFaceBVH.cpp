@@ -0,0 +1,183 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEFaceBVH.h"
+#include "FEMeshBase.h"
+#include "FEFace.h"
+#include <algorithm>
+#include <assert.h>
+using namespace std;
+
+// max number of faces in a leaf
+const int BVH_LEAF_SIZE = 4;
+
+//-----------------------------------------------------------------------------
+// calculate the bounding boxes of all the faces of a mesh
+static void mesh_face_boxes(const FSMeshBase& mesh, vector<BOX>& boxes)
+{
+	int NF = mesh.Faces();
+	boxes.resize(NF);
+#pragma omp parallel for
+	for (int i = 0; i < NF; ++i)
+	{
+		const FSFace& f = mesh.Face(i);
+		vec3d r0 = mesh.Node(f.n[0]).pos();
+		BOX b(r0, r0);
+		for (int j = 1; j < f.Nodes(); ++j) b += mesh.Node(f.n[j]).pos();
+		boxes[i] = b;
+	}
+}
+
+//-----------------------------------------------------------------------------
+FSFaceBVH::FSFaceBVH()
+{
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::Clear()
+{
+	m_node.clear();
+	m_item.clear();
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::Build(const FSMeshBase& mesh)
+{
+	vector<BOX> boxes;
+	mesh_face_boxes(mesh, boxes);
+	Build(boxes);
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::Refit(const FSMeshBase& mesh)
+{
+	vector<BOX> boxes;
+	mesh_face_boxes(mesh, boxes);
+	Refit(boxes);
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::Build(const vector<BOX>& faceBoxes)
+{
+	Clear();
+	int N = (int)faceBoxes.size();
+	if (N == 0) return;
+
+	// the tree is split on the face centers
+	vector<vec3d> c(N);
+	m_item.resize(N);
+	for (int i = 0; i < N; ++i)
+	{
+		m_item[i] = i;
+		c[i] = faceBoxes[i].Center();
+	}
+
+	m_node.reserve(2 * (N / BVH_LEAF_SIZE + 1));
+	BuildNode(0, N, c);
+
+	// calculate the node boxes
+	Refit(faceBoxes);
+}
+
+//-----------------------------------------------------------------------------
+// Build the sub-tree for the items in [i0, i1). The items are split at the 
+// median along the largest extent of their centers, so the tree is balanced.
+int FSFaceBVH::BuildNode(int i0, int i1, const vector<vec3d>& c)
+{
+	int nid = (int)m_node.size();
+	m_node.push_back(NODE());
+	NODE& node = m_node[nid];
+	node.first = i0;
+	node.count = i1 - i0;
+	if (i1 - i0 <= BVH_LEAF_SIZE) return nid;
+
+	// find the extent of the centers
+	BOX box(c[m_item[i0]], c[m_item[i0]]);
+	for (int i = i0 + 1; i < i1; ++i) box += c[m_item[i]];
+
+	int axis = 0;
+	if (box.Height() > box.Width()) axis = 1;
+	if ((box.Depth() > box.Width()) && (box.Depth() > box.Height())) axis = 2;
+
+	int im = (i0 + i1) / 2;
+	nth_element(m_item.begin() + i0, m_item.begin() + im, m_item.begin() + i1, [&](int a, int b) {
+		const vec3d& ca = c[a];
+		const vec3d& cb = c[b];
+		return (axis == 0 ? ca.x < cb.x : (axis == 1 ? ca.y < cb.y : ca.z < cb.z));
+	});
+
+	// left child is the next node, so we only need to store the right child
+	BuildNode(i0, im, c);
+	int nr = BuildNode(im, i1, c);
+
+	// note that the node reference may have been invalidated
+	m_node[nid].first = nr;
+	m_node[nid].count = 0;
+
+	return nid;
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::UpdateLeaf(NODE& node, const vector<BOX>& faceBoxes)
+{
+	for (int k = 0; k < 3; ++k) { node.bmin[k] = DBL_MAX; node.bmax[k] = -DBL_MAX; }
+	for (int i = 0; i < node.count; ++i)
+	{
+		const BOX& b = faceBoxes[m_item[node.first + i]];
+
+		// The intersection routines accept points slightly outside the face, 
+		// so the boxes are inflated to make sure we don't miss those.
+		double tol = Tolerance() * b.GetMaxExtent();
+		node.bmin[0] = min(node.bmin[0], b.x0 - tol); node.bmax[0] = max(node.bmax[0], b.x1 + tol);
+		node.bmin[1] = min(node.bmin[1], b.y0 - tol); node.bmax[1] = max(node.bmax[1], b.y1 + tol);
+		node.bmin[2] = min(node.bmin[2], b.z0 - tol); node.bmax[2] = max(node.bmax[2], b.z1 + tol);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void FSFaceBVH::Refit(const vector<BOX>& faceBoxes)
+{
+	assert(faceBoxes.size() == m_item.size());
+	if (m_node.empty()) return;
+
+	// children are always stored after their parent, so a reverse sweep 
+	// visits the children before their parent.
+	for (int i = (int)m_node.size() - 1; i >= 0; --i)
+	{
+		NODE& node = m_node[i];
+		if (node.count > 0) UpdateLeaf(node, faceBoxes);
+		else
+		{
+			const NODE& l = m_node[i + 1];
+			const NODE& r = m_node[node.first];
+			for (int k = 0; k < 3; ++k)
+			{
+				node.bmin[k] = min(l.bmin[k], r.bmin[k]);
+				node.bmax[k] = max(l.bmax[k], r.bmax[k]);
+			}
+		}
+	}
+}
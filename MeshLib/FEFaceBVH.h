@@ -0,0 +1,186 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+#pragma once
+#include <FSCore/box.h>
+#include <vector>
+#include <float.h>
+#include <math.h>
+
+class FSMeshBase;
+
+//-----------------------------------------------------------------------------
+// Bounding volume hierarchy over a set of faces. The hierarchy is built from 
+// the bounding boxes of the faces and can be refitted when the nodes move 
+// (e.g. between states) without rebuilding the tree. The tree does not know
+// anything about the face geometry: the closest-hit query hands the candidate
+// faces to a callback that does the actual intersection test.
+class FSFaceBVH
+{
+	struct NODE
+	{
+		double	bmin[3], bmax[3];	// bounding box
+		int		first;	// leaf: index of first item; interior: index of right child (left child is next node)
+		int		count;	// number of items (0 for interior nodes)
+	};
+
+public:
+	FSFaceBVH();
+
+	// build the hierarchy from the face bounding boxes
+	void Build(const std::vector<BOX>& faceBoxes);
+
+	// build the hierarchy for all the faces of a mesh
+	void Build(const FSMeshBase& mesh);
+
+	// update the boxes after the face boxes changed, keeping the tree topology
+	void Refit(const std::vector<BOX>& faceBoxes);
+	void Refit(const FSMeshBase& mesh);
+
+	void Clear();
+
+	bool IsEmpty() const { return m_node.empty(); }
+
+	// number of faces in the hierarchy
+	int Faces() const { return (int)m_item.size(); }
+
+	// Find the closest face that is hit by the ray (origin, direction). The test function is called as
+	// test(faceIndex, dist) and must return true if the face is hit, with dist the
+	// distance from the ray origin to the intersection point. Faces are only 
+	// tested if their box can still contain a hit closer than the current closest.
+	// If bline is true, intersections behind the origin are also considered.
+	// Returns the index of the closest face or -1 if nothing was hit.
+	template <class TestFunc> int ClosestHit(const vec3d& origin, const vec3d& direction, bool bline, TestFunc test) const;
+
+	// return the relative tolerance by which the face boxes are inflated
+	static double Tolerance() { return 0.05; }
+
+private:
+	int BuildNode(int i0, int i1, const std::vector<vec3d>& c);
+	void UpdateLeaf(NODE& node, const std::vector<BOX>& faceBoxes);
+
+	// clip the line against the box of a node and return the smallest distance
+	// along the line to the box, or false if the line misses the box
+	static bool LineBoxDistance(const NODE& node, const double o[3], const double inv[3], double tmin, double& dmin);
+
+private:
+	std::vector<NODE>	m_node;	// tree nodes in depth-first order (root is first)
+	std::vector<int>	m_item;	// face indices, ordered by leaf
+};
+
+//-----------------------------------------------------------------------------
+inline bool FSFaceBVH::LineBoxDistance(const NODE& node, const double o[3], const double inv[3], double tmin, double& dmin)
+{
+	double t0 = tmin, t1 = DBL_MAX;
+	for (int k = 0; k < 3; ++k)
+	{
+		if (inv[k] == 0.0)
+		{
+			// the line is parallel to this slab
+			if ((o[k] < node.bmin[k]) || (o[k] > node.bmax[k])) return false;
+		}
+		else
+		{
+			double ta = (node.bmin[k] - o[k]) * inv[k];
+			double tb = (node.bmax[k] - o[k]) * inv[k];
+			if (ta > tb) { double tmp = ta; ta = tb; tb = tmp; }
+			if (ta > t0) t0 = ta;
+			if (tb < t1) t1 = tb;
+			if (t0 > t1) return false;
+		}
+	}
+
+	// distance (in units of the direction vector) to the closest point of the clipped segment
+	if ((t0 <= 0.0) && (t1 >= 0.0)) dmin = 0.0;
+	else dmin = (t0 > 0.0 ? t0 : -t1);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+template <class TestFunc> int FSFaceBVH::ClosestHit(const vec3d& origin, const vec3d& direction, bool bline, TestFunc test) const
+{
+	if (m_node.empty()) return -1;
+
+	const vec3d& d = direction;
+	double L = d.Length();
+	if (L == 0.0) return -1;
+
+	double o[3] = { origin.x, origin.y, origin.z };
+	double inv[3];
+	inv[0] = (d.x != 0.0 ? 1.0 / d.x : 0.0);
+	inv[1] = (d.y != 0.0 ? 1.0 / d.y : 0.0);
+	inv[2] = (d.z != 0.0 ? 1.0 / d.z : 0.0);
+	double tmin = (bline ? -DBL_MAX : 0.0);
+
+	int imin = -1;
+	double Dmin = DBL_MAX;
+
+	// the tree depth is bounded by the build, so a small fixed stack will do
+	struct ENTRY { int node; double dist; };
+	ENTRY stack[128];
+	int ns = 0;
+
+	double d0;
+	if (LineBoxDistance(m_node[0], o, inv, tmin, d0) == false) return -1;
+	stack[ns++] = { 0, d0 * L };
+	while (ns > 0)
+	{
+		ENTRY e = stack[--ns];
+		if (e.dist > Dmin) continue;
+
+		const NODE& node = m_node[e.node];
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; ++i)
+			{
+				int nface = m_item[node.first + i];
+				double D;
+				if (test(nface, D) && ((imin == -1) || (D < Dmin)))
+				{
+					imin = nface;
+					Dmin = D;
+				}
+			}
+		}
+		else
+		{
+			// push the farthest child first, so the closest one is processed next
+			int nl = e.node + 1, nr = node.first;
+			double dl = 0.0, dr = 0.0;
+			bool bl = LineBoxDistance(m_node[nl], o, inv, tmin, dl);
+			bool br = LineBoxDistance(m_node[nr], o, inv, tmin, dr);
+			dl *= L; dr *= L;
+			if (bl && br)
+			{
+				if (dl < dr) { stack[ns++] = { nr, dr }; stack[ns++] = { nl, dl }; }
+				else { stack[ns++] = { nl, dl }; stack[ns++] = { nr, dr }; }
+			}
+			else if (bl) stack[ns++] = { nl, dl };
+			else if (br) stack[ns++] = { nr, dr };
+		}
+	}
+
+	return imin;
+}
@@ -27,143 +27,39 @@ SOFTWARE.*/
 #include "FEFindElement.h"
 #include "FECoreMesh.h"
 #include "MeshTools.h"
+#include <algorithm>
+using namespace std;
 
-FEFindElement::OCTREE_BOX::OCTREE_BOX()
-{
-	m_elem = -1;
-	m_level = -1;
-}
-
-FEFindElement::OCTREE_BOX::~OCTREE_BOX()
-{
-	for (size_t i = 0; i<m_child.size(); ++i) delete m_child[i];
-	m_child.clear();
-}
-
-void FEFindElement::OCTREE_BOX::split(int levels)
-{
-	m_level = levels;
-	if (m_level == 0) return;
-
-	double x0 = m_box.x0, x1 = m_box.x1;
-	double y0 = m_box.y0, y1 = m_box.y1;
-	double z0 = m_box.z0, z1 = m_box.z1;
-
-	double dx = x1 - x0;
-	double dy = y1 - y0;
-	double dz = z1 - z0;
-
-	m_child.clear();
-	for (int i = 0; i<2; i++)
-		for (int j = 0; j<2; j++)
-			for (int k = 0; k <2; k++)
-			{
-				double xa = x0 + i*dx*0.5, xb = x0 + (i + 1)*dx*0.5;
-				double ya = y0 + j*dy*0.5, yb = y0 + (j + 1)*dy*0.5;
-				double za = z0 + k*dz*0.5, zb = z0 + (k + 1)*dz*0.5;
-
-				BOX b(xa, ya, za, xb, yb, zb);
-				double R = b.GetMaxExtent();
-				b.Inflate(R*0.0001);
-
-				OCTREE_BOX* box = new OCTREE_BOX;
-				box->m_box = b;
-
-				m_child.push_back(box);
-			}
-
-	for (int i = 0; i<(int)m_child.size(); ++i)
-	{
-		m_child[i]->split(levels - 1);
-	}
-}
-
-void FEFindElement::OCTREE_BOX::Add(BOX& b, int nelem)
-{
-	if (m_level == 0)
-	{
-		if (m_box.Intersects(b))
-		{
-			OCTREE_BOX* box = new OCTREE_BOX;
-			box->m_box = b;
-			box->m_elem = nelem;
-			box->m_level = -1;
-			m_child.push_back(box);
-			return;
-		}
-	}
-	else
-	{
-		for (size_t i = 0; i<m_child.size(); ++i)
-		{
-			m_child[i]->Add(b, nelem);
-		}
-	}
-}
+// max number of elements in a leaf
+const int FIND_LEAF_SIZE = 4;
 
+// depth at which the tree is split into sub-trees that are built in parallel
+const int FIND_TASK_DEPTH = 4;
 
-FEFindElement::OCTREE_BOX* FEFindElement::OCTREE_BOX::Find(const vec3f& r)
+FEFindElement::FEFindElement(FSCoreMesh& mesh) : m_mesh(mesh)
 {
-	if (m_level == 0)
-	{
-		bool inside = m_box.IsInside(to_vec3d(r));
-		return (inside ? this : 0);
-	}
-
-	// try to find the child
-	for (size_t i = 0; i<m_child.size(); ++i)
-	{
-		OCTREE_BOX* c = m_child[i];
-		OCTREE_BOX* ret = c->Find(r);
-		if (ret) return ret;
-	}
-
-	return 0;
+	m_nframe = -1;
 }
 
-
-FEFindElement::OCTREE_BOX* FEFindElement::FindBox(const vec3f& r)
+void FEFindElement::Init(int nframe)
 {
-	// make sure it's in the master box
-	if (m_bound.IsInside(r) == false) return 0;
-
-	// try to find the child
-	OCTREE_BOX* b = &m_bound;
-	do
-	{
-		if (b->m_level == 0)
-		{
-			bool inside = b->IsInside(r);
-			return (inside ? b : 0);
-		}
-
-		bool bfound = false;
-		for (size_t i = 0; i<b->m_child.size(); ++i)
-		{
-			OCTREE_BOX* c = b->m_child[i];
-			if (c->IsInside(r))
-			{
-				b = c;
-				bfound = true;
-				break;
-			}
-		}
-
-		assert(bfound);
-		if (bfound == false) break;
-	} while (1);
-
-	return 0;
+	std::vector<bool> dummy;
+	m_nframe = nframe;
+	InitTree(dummy);
 }
 
-FEFindElement::FEFindElement(FSCoreMesh& mesh) : m_mesh(mesh)
+void FEFindElement::Init(std::vector<bool>& flags, int nframe)
 {
-	m_nframe = -1;
+	m_nframe = nframe;
+	InitTree(flags);
 }
 
-void FEFindElement::InitReferenceFrame(std::vector<bool>& flags)
+void FEFindElement::InitTree(std::vector<bool>& flags)
 {
-	assert(m_nframe == 0);
+	m_node.clear();
+	m_item.clear();
+	m_elemBox.clear();
+	m_box = BOX();
 
 	// calculate bounding box for the entire mesh
 	int NN = m_mesh.Nodes();
@@ -179,17 +75,11 @@ void FEFindElement::InitReferenceFrame(std::vector<bool>& flags)
 	}
 	double R = box.GetMaxExtent();
 	box.Inflate(R*0.001);
+	m_box = box;
 
-	// split this box recursively
-	m_bound.m_box = box;
-
-	int l = (int)(log(NE) / log(8.0));
-	if (l < 0) l = 0;
-	if (l > 3) l = 3;
-	m_bound.split(l);
-
-	// calculate bounding boxes for all elements
+	// collect the elements we need to add
 	int cflags = (int)flags.size();
+	vector<int> elemList; elemList.reserve(NE);
 	for (int i = 0; i<NE; ++i)
 	{
 		FEElement_& e = m_mesh.ElementRef(i);
@@ -201,167 +91,237 @@ void FEFindElement::InitReferenceFrame(std::vector<bool>& flags)
 			if ((mid >= 0) && (mid < cflags)) badd = flags[mid];
 		}
 
-		if (badd)
-		{
-			int ne = e.Nodes();
+		if (badd) elemList.push_back(i);
+	}
+	int N = (int)elemList.size();
+	if (N == 0) return;
 
-			// do a quick bounding box test
-			vec3d r0 = m_mesh.Node(e.m_node[0]).r;
-			vec3d r1 = r0;
-			BOX box(r0, r1);
-			for (int j = 1; j<ne; ++j)
-			{
-				vec3d rj = m_mesh.Node(e.m_node[j]).r;
-				box += rj;
-			}
-			double R = box.GetMaxExtent();
-			box.Inflate(R*0.001);
+	// calculate bounding boxes for all elements
+	vector<BOX> elemBox(N);
+	vector<vec3f> c(N);
+#pragma omp parallel for
+	for (int i = 0; i<N; ++i)
+	{
+		FEElement_& e = m_mesh.ElementRef(elemList[i]);
+		int ne = e.Nodes();
 
-			// add it to the octree
-			m_bound.Add(box, i);
+		vec3d r0 = m_mesh.Node(e.m_node[0]).r;
+		BOX box(r0, r0);
+		for (int j = 1; j<ne; ++j)
+		{
+			vec3d rj = m_mesh.Node(e.m_node[j]).r;
+			box += rj;
 		}
-	}
-}
-
-void FEFindElement::InitCurrentFrame(std::vector<bool>& flags)
-{
-	assert(m_nframe == 1);
+		double R = box.GetMaxExtent();
+		box.Inflate(R*0.001);
 
-	// calculate bounding box for the entire mesh
-	int NN = m_mesh.Nodes();
-	int NE = m_mesh.Elements();
-	if ((NN == 0) || (NE == 0)) return;
+		elemBox[i] = box;
+		c[i] = to_vec3f(box.Center());
+	}
 
-	vec3d r = m_mesh.Node(0).r;
-	BOX box(r, r);
-	for (int i = 1; i<m_mesh.Nodes(); ++i)
+	// build the top of the tree. This returns the ranges of the sub-trees
+	m_item.resize(N);
+	for (int i = 0; i < N; ++i) m_item[i] = i;
+	vector<pair<int, int> > tasks;
+	m_node.reserve(2 * (N / FIND_LEAF_SIZE + 1));
+	BuildNode(m_node, 0, N, c, 0, &tasks);
+
+	// build the sub-trees in parallel
+	int NT = (int)tasks.size();
+	vector< vector<NODE> > subTree(NT);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < NT; ++i)
 	{
-		r = m_mesh.Node(i).r;
-		box += r;
+		BuildNode(subTree[i], tasks[i].first, tasks[i].second, c, 0, nullptr);
 	}
-	double R = box.GetMaxExtent();
-	box.Inflate(R*0.001);
 
-	// split this box recursively
-	m_bound.m_box = box;
-
-	int l = (int)(log(NE) / log(8.0));
-	if (l < 0) l = 0;
-	if (l > 3) l = 3;
-	m_bound.split(l);
+	// Now attach the sub-trees. The placeholder leaves have their task index 
+	// stored in left. The root of a sub-tree replaces the placeholder, the 
+	// other nodes are appended at the end.
+	int ntop = (int)m_node.size();
+	for (int i = 0; i < ntop; ++i)
+	{
+		NODE& node = m_node[i];
+		if (node.leaf && (node.right < 0))
+		{
+			vector<NODE>& sub = subTree[node.left];
+			int offset = (int)m_node.size() - 1;
+			for (int k = 0; k < (int)sub.size(); ++k)
+			{
+				NODE& sk = sub[k];
+				if (sk.leaf == false) { sk.left += offset; sk.right += offset; }
+			}
+			m_node[i] = sub[0];
+			m_node.insert(m_node.end(), sub.begin() + 1, sub.end());
+		}
+	}
 
-	// calculate bounding boxes for all elements
-	int cflags = (int)flags.size();
-	for (int i = 0; i<NE; ++i)
+	// store the element indices and boxes in leaf order
+	m_elemBox.resize(N);
+	for (int i = 0; i < N; ++i)
 	{
-		FEElement_& e = m_mesh.ElementRef(i);
+		m_elemBox[i] = elemBox[m_item[i]];
+		m_item[i] = elemList[m_item[i]];
+	}
 
-		bool badd = true;
-		if (flags.empty() == false)
+	// calculate the node boxes. Children are always stored after their parent,
+	// so we can do this in a single reverse sweep
+	for (int i = (int)m_node.size() - 1; i >= 0; --i)
+	{
+		NODE& node = m_node[i];
+		if (node.leaf)
 		{
-			int mid = e.m_MatID;
-			if ((mid >= 0) && (mid < cflags)) badd = flags[mid];
+			for (int k = 0; k < 3; ++k) { node.bmin[k] = 1e99; node.bmax[k] = -1e99; }
+			for (int j = node.left; j < node.right; ++j)
+			{
+				const BOX& b = m_elemBox[j];
+				node.bmin[0] = min(node.bmin[0], b.x0); node.bmax[0] = max(node.bmax[0], b.x1);
+				node.bmin[1] = min(node.bmin[1], b.y0); node.bmax[1] = max(node.bmax[1], b.y1);
+				node.bmin[2] = min(node.bmin[2], b.z0); node.bmax[2] = max(node.bmax[2], b.z1);
+			}
 		}
-
-		if (badd)
+		else
 		{
-			int ne = e.Nodes();
-
-			// do a quick bounding box test
-			vec3d r0 = m_mesh.Node(e.m_node[0]).r;
-			vec3d r1 = r0;
-			BOX box(r0, r1);
-			for (int j = 1; j<ne; ++j)
+			const NODE& l = m_node[node.left];
+			const NODE& r = m_node[node.right];
+			for (int k = 0; k < 3; ++k)
 			{
-				vec3d rj = m_mesh.Node(e.m_node[j]).r;
-				box += rj;
+				node.bmin[k] = min(l.bmin[k], r.bmin[k]);
+				node.bmax[k] = max(l.bmax[k], r.bmax[k]);
 			}
-			double R = box.GetMaxExtent();
-			box.Inflate(R*0.001);
-
-			// add it to the octree
-			m_bound.Add(box, i);
 		}
 	}
 }
 
-void FEFindElement::Init(int nframe)
+// Build the tree for the items in [i0, i1), splitting at the median of the largest 
+// extent of the element centers. If tasks is not null, the recursion stops at 
+// FIND_TASK_DEPTH and a placeholder leaf (with right = -1) is added instead.
+int FEFindElement::BuildNode(vector<NODE>& nodes, int i0, int i1, const vector<vec3f>& c, int depth, vector<pair<int, int> >* tasks)
 {
-	std::vector<bool> dummy;
-	m_nframe = nframe;
-	if (m_nframe == 0) InitReferenceFrame(dummy);
-	else InitCurrentFrame(dummy);
-}
+	int nid = (int)nodes.size();
+	nodes.push_back(NODE());
+	NODE& node = nodes[nid];
+	node.leaf = true;
+	node.left = i0;
+	node.right = i1;
+	if (i1 - i0 <= FIND_LEAF_SIZE) return nid;
+
+	if (tasks && (depth == FIND_TASK_DEPTH))
+	{
+		node.left = (int)tasks->size();
+		node.right = -1;
+		tasks->push_back(pair<int, int>(i0, i1));
+		return nid;
+	}
 
-void FEFindElement::Init(std::vector<bool>& flags, int nframe)
-{
-	m_nframe = nframe;
-	if (m_nframe == 0) InitReferenceFrame(flags);
-	else InitCurrentFrame(flags);
+	// find the extent of the centers
+	vec3f rmin = c[m_item[i0]], rmax = rmin;
+	for (int i = i0 + 1; i < i1; ++i)
+	{
+		const vec3f& r = c[m_item[i]];
+		if (r.x < rmin.x) rmin.x = r.x; if (r.x > rmax.x) rmax.x = r.x;
+		if (r.y < rmin.y) rmin.y = r.y; if (r.y > rmax.y) rmax.y = r.y;
+		if (r.z < rmin.z) rmin.z = r.z; if (r.z > rmax.z) rmax.z = r.z;
+	}
+	vec3f d = rmax - rmin;
+	int axis = 0;
+	if (d.y > d.x) axis = 1;
+	if ((d.z > d.x) && (d.z > d.y)) axis = 2;
+
+	int im = (i0 + i1) / 2;
+	nth_element(m_item.begin() + i0, m_item.begin() + im, m_item.begin() + i1, [&](int a, int b) {
+		const vec3f& ca = c[a];
+		const vec3f& cb = c[b];
+		return (axis == 0 ? ca.x < cb.x : (axis == 1 ? ca.y < cb.y : ca.z < cb.z));
+	});
+
+	int nl = BuildNode(nodes, i0, im, c, depth + 1, tasks);
+	int nr = BuildNode(nodes, im, i1, c, depth + 1, tasks);
+
+	// note that the node reference may have been invalidated
+	nodes[nid].leaf = false;
+	nodes[nid].left = nl;
+	nodes[nid].right = nr;
+
+	return nid;
 }
 
-bool FEFindElement::FindInReferenceFrame(const vec3f& x, int& nelem, double r[3])
+template <class Func> bool FEFindElement::FindInTree(const vec3f& x, Func projectElement) const
 {
-	assert(m_nframe == 0);
+	if (m_node.empty()) return false;
 
-	vec3f y[FSElement::MAX_NODES];
-	OCTREE_BOX* b = FindBox(x);
-	if (b == 0) return false;
-	assert(b->m_level == 0);
+	// make sure it's in the master box
+	vec3d p = to_vec3d(x);
+	if (m_box.IsInside(p) == false) return false;
 
-	int NE = (int)b->m_child.size();
-	for (int i = 0; i<NE; ++i)
+	int stack[128];
+	int ns = 0;
+	stack[ns++] = 0;
+	while (ns > 0)
 	{
-		OCTREE_BOX* c = b->m_child[i];
-		assert(c->m_level == -1);
-
-		int nid = c->m_elem; assert(nid >= 0);
-
-		FEElement_& e = m_mesh.ElementRef(nid);
-		nelem = nid;
+		const NODE& node = m_node[stack[--ns]];
+		if ((p.x < node.bmin[0]) || (p.x > node.bmax[0]) ||
+			(p.y < node.bmin[1]) || (p.y > node.bmax[1]) ||
+			(p.z < node.bmin[2]) || (p.z > node.bmax[2])) continue;
 
-		// do a quick bounding box test
-		if (c->m_box.IsInside(to_vec3d(x)))
+		if (node.leaf)
 		{
-			// do a more complete search
-			if (ProjectInsideReferenceElement(m_mesh, e, x, r)) return true;
+			for (int i = node.left; i < node.right; ++i)
+			{
+				// do a quick bounding box test
+				if (m_elemBox[i].IsInside(p))
+				{
+					// do a more complete search
+					if (projectElement(m_item[i])) return true;
+				}
+			}
+		}
+		else
+		{
+			stack[ns++] = node.right;
+			stack[ns++] = node.left;
 		}
 	}
 
-	nelem = -1;
 	return false;
 }
 
-bool FEFindElement::FindInCurrentFrame(const vec3f& x, int& nelem, double r[3])
+bool FEFindElement::FindInReferenceFrame(const vec3f& x, int& nelem, double r[3]) const
 {
-	assert(m_nframe == 1);
-
-	vec3f y[FSElement::MAX_NODES];
-	OCTREE_BOX* b = FindBox(x);
-	if (b == 0) return false;
-	assert(b->m_level == 0);
-
-	int NE = (int)b->m_child.size();
-	for (int i = 0; i<NE; ++i)
-	{
-		OCTREE_BOX* c = b->m_child[i];
-		assert(c->m_level == -1);
-
-		int nid = c->m_elem; assert(nid >= 0);
+	assert(m_nframe == 0);
+	nelem = -1;
+	return FindInTree(x, [&](int nid) {
+		FEElement_& e = m_mesh.ElementRef(nid);
+		if (ProjectInsideReferenceElement(m_mesh, e, x, r) == false) return false;
+		nelem = nid;
+		return true;
+	});
+}
 
+bool FEFindElement::FindInCurrentFrame(const vec3f& x, int& nelem, double r[3]) const
+{
+	assert(m_nframe == 1);
+	nelem = -1;
+	return FindInTree(x, [&](int nid) {
 		FEElement_& e = m_mesh.ElementRef(nid);
+		if (ProjectInsideElement(m_mesh, e, x, r) == false) return false;
 		nelem = nid;
+		return true;
+	});
+}
 
-		// do a quick bounding box test
-		if (c->m_box.IsInside(to_vec3d(x)))
-		{
-			// do a more complete search
-			if (ProjectInsideElement(m_mesh, e, x, r)) return true;
-		}
+void FEFindElement::FindElements(const vector<vec3f>& x, vector<int>& elem, vector<vec3d>& r) const
+{
+	int N = (int)x.size();
+	elem.resize(N);
+	r.resize(N);
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < N; ++i)
+	{
+		double q[3] = { 0, 0, 0 };
+		if (FindElement(x[i], elem[i], q) == false) elem[i] = -1;
+		r[i] = vec3d(q[0], q[1], q[2]);
 	}
-
-	nelem = -1;
-	return false;
 }
 
 //================================================================================================
@@ -30,28 +30,18 @@ SOFTWARE.*/
 
 class FSCoreMesh;
 
+//-----------------------------------------------------------------------------
+// Class for locating the element that contains a point. The elements are 
+// stored in a bounding volume hierarchy that is kept in flat arrays, so 
+// lookups don't chase pointers. Lookups don't modify the object, so they 
+// can be done concurrently.
 class FEFindElement
 {
-public:
-	class OCTREE_BOX
+	struct NODE
 	{
-	public:
-		BOX					m_box;
-		std::vector<OCTREE_BOX*>	m_child;
-		int					m_elem;
-		int					m_level;
-
-	public:
-		OCTREE_BOX();
-		~OCTREE_BOX();
-
-		void split(int levels);
-
-		OCTREE_BOX* Find(const vec3f& r);
-
-		bool IsInside(const vec3f& r) const { return m_box.IsInside(to_vec3d(r)); }
-
-		void Add(BOX& b, int nelem);
+		double	bmin[3], bmax[3];	// bounding box
+		int		left, right;	// interior: child nodes; leaf: range of items
+		bool	leaf;
 	};
 
 public:
@@ -60,27 +50,35 @@ public:
 	void Init(int nframe = 0);
 	void Init(std::vector<bool>& flags, int nframe = 0);
 
-	bool FindElement(const vec3f& x, int& nelem, double r[3]);
+	bool FindElement(const vec3f& x, int& nelem, double r[3]) const;
+
+	// locate a batch of points (in parallel). elem[i] is set to -1 if the point
+	// is not inside any element. 
+	void FindElements(const std::vector<vec3f>& x, std::vector<int>& elem, std::vector<vec3d>& r) const;
 
-	BOX BoundingBox() const { return m_bound.m_box; }
+	BOX BoundingBox() const { return m_box; }
 
 private:
-	void InitReferenceFrame(std::vector<bool>& flags);
-	void InitCurrentFrame(std::vector<bool>& flags);
+	void InitTree(std::vector<bool>& flags);
 
-	bool FindInReferenceFrame(const vec3f& x, int& nelem, double r[3]);
-	bool FindInCurrentFrame(const vec3f& x, int& nelem, double r[3]);
+	int BuildNode(std::vector<NODE>& nodes, int i0, int i1, const std::vector<vec3f>& c, int depth, std::vector<std::pair<int, int> >* tasks);
 
-private:
-	OCTREE_BOX* FindBox(const vec3f& r);
+	bool FindInReferenceFrame(const vec3f& x, int& nelem, double r[3]) const;
+	bool FindInCurrentFrame(const vec3f& x, int& nelem, double r[3]) const;
+
+	template <class Func> bool FindInTree(const vec3f& x, Func projectElement) const;
 
 private:
-	OCTREE_BOX	m_bound;
 	FSCoreMesh&	m_mesh;
 	int			m_nframe;	// = 0 reference, 1 = current
+	BOX			m_box;		// bounding box of mesh
+
+	std::vector<NODE>	m_node;		// hierarchy nodes (root is first)
+	std::vector<int>	m_item;		// element indices, ordered by leaf
+	std::vector<BOX>	m_elemBox;	// element boxes, in the same order as m_item
 };
 
-inline bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3])
+inline bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3]) const
 {
 	return (m_nframe == 0 ? FindInReferenceFrame(x, nelem, r) : FindInCurrentFrame(x, nelem, r));
 }
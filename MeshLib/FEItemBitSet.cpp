@@ -0,0 +1,160 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEItemBitSet.h"
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+// number of bits that are set
+static inline int popCount(uint64_t w)
+{
+	w = w - ((w >> 1) & 0x5555555555555555ull);
+	w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)((w * 0x0101010101010101ull) >> 56);
+}
+
+//-----------------------------------------------------------------------------
+// index of the lowest bit that is set (w must be non-zero)
+static inline int lowestBit(uint64_t w)
+{
+	static const int table[64] = {
+		 0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+	};
+	return table[((w & (0 - w)) * 0x03F79D71B4CB0A89ull) >> 58];
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Reserve(int n)
+{
+	size_t words = (size_t)((n + 63) >> 6);
+	if (words > m_bits.size()) m_bits.resize(words, 0);
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Set(int n)
+{
+	assert(n >= 0);
+	if (n < 0) return;
+	Reserve(n + 1);
+	m_bits[n >> 6] |= (1ull << (n & 63));
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Reset(int n)
+{
+	if ((n < 0) || ((size_t)(n >> 6) >= m_bits.size())) return;
+	m_bits[n >> 6] &= ~(1ull << (n & 63));
+}
+
+//-----------------------------------------------------------------------------
+bool FSItemBitSet::Test(int n) const
+{
+	if ((n < 0) || ((size_t)(n >> 6) >= m_bits.size())) return false;
+	return ((m_bits[n >> 6] >> (n & 63)) & 1ull) != 0;
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Set(const std::vector<int>& items)
+{
+	// find the largest index first so we only allocate once
+	int nmax = -1;
+	for (int n : items) if (n > nmax) nmax = n;
+	if (nmax < 0) return;
+	Reserve(nmax + 1);
+
+	for (int n : items)
+	{
+		assert(n >= 0);
+		if (n >= 0) m_bits[n >> 6] |= (1ull << (n & 63));
+	}
+}
+
+//-----------------------------------------------------------------------------
+int FSItemBitSet::Count() const
+{
+	int n = 0;
+	for (uint64_t w : m_bits) n += popCount(w);
+	return n;
+}
+
+//-----------------------------------------------------------------------------
+bool FSItemBitSet::IsEmpty() const
+{
+	for (uint64_t w : m_bits) if (w) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Union(const FSItemBitSet& s)
+{
+	if (s.m_bits.size() > m_bits.size()) m_bits.resize(s.m_bits.size(), 0);
+	size_t N = s.m_bits.size();
+	for (size_t i = 0; i < N; ++i) m_bits[i] |= s.m_bits[i];
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Difference(const FSItemBitSet& s)
+{
+	size_t N = (s.m_bits.size() < m_bits.size() ? s.m_bits.size() : m_bits.size());
+	for (size_t i = 0; i < N; ++i) m_bits[i] &= ~s.m_bits[i];
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::Intersection(const FSItemBitSet& s)
+{
+	if (m_bits.size() > s.m_bits.size()) m_bits.resize(s.m_bits.size());
+	size_t N = m_bits.size();
+	for (size_t i = 0; i < N; ++i) m_bits[i] &= s.m_bits[i];
+}
+
+//-----------------------------------------------------------------------------
+void FSItemBitSet::GetItems(std::vector<int>& items) const
+{
+	items.clear();
+	items.reserve(Count());
+	size_t N = m_bits.size();
+	for (size_t i = 0; i < N; ++i)
+	{
+		uint64_t w = m_bits[i];
+		while (w)
+		{
+			items.push_back((int)(i << 6) + lowestBit(w));
+			w &= w - 1;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+std::vector<int> FSItemBitSet::GetItems() const
+{
+	std::vector<int> items;
+	GetItems(items);
+	return items;
+}
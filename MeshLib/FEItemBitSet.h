@@ -0,0 +1,74 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// A dense bitset of (non-negative) item indices, used for set operations on
+// node, face and element selections. Union, difference and intersection
+// work on 64 items at a time.
+class FSItemBitSet
+{
+public:
+	FSItemBitSet() {}
+	FSItemBitSet(const std::vector<int>& items) { Set(items); }
+
+	// remove all items
+	void Clear() { m_bits.clear(); }
+
+	// make sure the set can hold indices up to (but not including) n
+	void Reserve(int n);
+
+	// add or remove a single item
+	void Set(int n);
+	void Reset(int n);
+
+	// check if an item is in the set
+	bool Test(int n) const;
+
+	// add a list of items
+	void Set(const std::vector<int>& items);
+
+	// number of items in the set
+	int Count() const;
+
+	bool IsEmpty() const;
+
+	// set operations
+	void Union(const FSItemBitSet& s);
+	void Difference(const FSItemBitSet& s);
+	void Intersection(const FSItemBitSet& s);
+
+	// get the items in ascending order
+	void GetItems(std::vector<int>& items) const;
+	std::vector<int> GetItems() const;
+
+private:
+	std::vector<uint64_t>	m_bits;
+};
@@ -25,7 +25,6 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
 #include "FEItemListBuilder.h"
-#include <algorithm>
 
 int FEItemListBuilder::m_ncount = 1;
 
@@ -103,49 +102,44 @@ void FEItemListBuilder::add(const std::vector<int>& nodeList)
 
 void FEItemListBuilder::remove(int n)
 {
-	if (m_Item.empty()) return;
-	Iterator pi = m_Item.begin();
-	for (int i=0; i<n; ++i) pi++;
-	m_Item.erase(pi);
+	if ((n < 0) || (n >= (int)m_Item.size())) return;
+	m_Item.erase(m_Item.begin() + n);
 }
 
 void FEItemListBuilder::Merge(std::vector<int>& o)
 {
-	m_Item.insert(m_Item.end(), o.begin(), o.end());
+	Merge(FSItemBitSet(o));
+}
 
-	if (m_Item.empty() == false)
-	{
-		// sort the items
-		std::sort(m_Item.begin(), m_Item.end());
+void FEItemListBuilder::Subtract(std::vector<int>& o)
+{
+	Subtract(FSItemBitSet(o));
+}
 
-		// remove duplicates
-		Iterator it1 = m_Item.begin(); 
-		Iterator it2 = it1; it2++;
+void FEItemListBuilder::Intersect(std::vector<int>& o)
+{
+	Intersect(FSItemBitSet(o));
+}
 
-		while (it2 != m_Item.end())
-		{
-			if (*it1 == *it2) it2 = m_Item.erase(it2);
-			else { it1 = it2; it2++; }
-		}
-	}
+void FEItemListBuilder::Merge(const FSItemBitSet& o)
+{
+	FSItemBitSet s(m_Item);
+	s.Union(o);
+	s.GetItems(m_Item);
 }
 
-void FEItemListBuilder::Subtract(std::vector<int>& o)
+void FEItemListBuilder::Subtract(const FSItemBitSet& o)
 {
-	std::sort(m_Item.begin(), m_Item.end());
+	FSItemBitSet s(m_Item);
+	s.Difference(o);
+	s.GetItems(m_Item);
+}
 
-	// NOTE: This algorithm assumes that both lists are sorted
-	Iterator it  = m_Item.begin();
-	Iterator it2 = o.begin();
-	while ((it != m_Item.end()) && (it2 != o.end()))
-	{
-		if (*it == *it2)
-		{
-			it = m_Item.erase(it);
-			++it2;
-		}
-		else ++it;
-	}
+void FEItemListBuilder::Intersect(const FSItemBitSet& o)
+{
+	FSItemBitSet s(m_Item);
+	s.Intersection(o);
+	s.GetItems(m_Item);
 }
 
 int FEItemListBuilder::GetReferenceCount() const { return m_refs; }
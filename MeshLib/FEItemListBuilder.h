@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include <FSCore/FSObject.h>
 #include "FEItemList.h"
+#include "FEItemBitSet.h"
 #include <vector>
 
 //-----------------------------------------------------------------------------
@@ -111,8 +112,18 @@ public:
 
 	int Type() { return m_ntype; }
 
+	// set operations. These leave the item list sorted and without duplicates.
 	void Merge(std::vector<int>& o);
 	void Subtract(std::vector<int>& o);
+	void Intersect(std::vector<int>& o);
+
+	void Merge(const FSItemBitSet& s);
+	void Subtract(const FSItemBitSet& s);
+	void Intersect(const FSItemBitSet& s);
+
+	// convert between the item list and a bitset
+	FSItemBitSet GetItemSet() const { return FSItemBitSet(m_Item); }
+	void SetItems(const FSItemBitSet& s) { s.GetItems(m_Item); }
 
 	std::vector<int> CopyItems() { return m_Item; }
 
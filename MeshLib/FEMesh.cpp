@@ -674,6 +674,111 @@ bool FSMesh::ValidateEdges() const
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Hash table of the faces of all elements. For solids all element faces are
+// stored, and for shells the shell face. This is used to find the elements that
+// share a face, without comparing all faces of all elements connected to a node.
+class FSElementFaceTable
+{
+public:
+	struct FACEREF
+	{
+		int				eid;	// element index
+		int				lid;	// local face index (-1 for shells)
+		unsigned int	hash;	// face hash
+	};
+
+public:
+	void Build(FSMesh& mesh);
+
+	// hash value of a face. This only depends on the face type and the corner nodes.
+	static unsigned int FaceHash(const FSFace& f);
+
+	// returns the face references with the same hash (modulo table size) as h.
+	int Find(unsigned int h, const FACEREF*& ref) const
+	{
+		int n = (int)(h & m_mask);
+		ref = m_ref.data() + m_bucket[n];
+		return m_bucket[n + 1] - m_bucket[n];
+	}
+
+private:
+	unsigned int			m_mask;
+	std::vector<int>		m_bucket;	// offsets into m_ref for each bucket
+	std::vector<FACEREF>	m_ref;
+};
+
+unsigned int FSElementFaceTable::FaceHash(const FSFace& f)
+{
+	int m[4] = { f.n[0], f.n[1], f.n[2], (f.Edges() == 4 ? f.n[3] : -1) };
+
+	// sort the corner nodes, so the hash doesn't depend on the face's orientation
+	if (m[0] > m[1]) std::swap(m[0], m[1]);
+	if (m[2] > m[3]) std::swap(m[2], m[3]);
+	if (m[0] > m[2]) std::swap(m[0], m[2]);
+	if (m[1] > m[3]) std::swap(m[1], m[3]);
+	if (m[1] > m[2]) std::swap(m[1], m[2]);
+
+	unsigned int h = (unsigned int)f.Type();
+	for (int i = 0; i < 4; ++i) h = (h ^ (unsigned int)m[i]) * 0x9E3779B1u;
+	return h ^ (h >> 16);
+}
+
+void FSElementFaceTable::Build(FSMesh& mesh)
+{
+	// count the faces of all elements
+	int NE = mesh.Elements();
+	std::vector<int> off(NE + 1);
+	off[0] = 0;
+	for (int i = 0; i < NE; ++i)
+	{
+		const FEElement_& el = mesh.ElementRef(i);
+		off[i + 1] = off[i] + (el.IsShell() ? 1 : el.Faces());
+	}
+	int NR = off[NE];
+
+	// calculate the hash of all faces
+	std::vector<FACEREF> ref(NR);
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
+	{
+		const FEElement_& el = mesh.ElementRef(i);
+		FSFace f;
+		FACEREF* r = ref.data() + off[i];
+		if (el.IsShell())
+		{
+			el.GetShellFace(f);
+			r->eid = i;
+			r->lid = -1;
+			r->hash = FaceHash(f);
+		}
+		else
+		{
+			int nf = el.Faces();
+			for (int j = 0; j < nf; ++j)
+			{
+				el.GetFace(j, f);
+				r[j].eid = i;
+				r[j].lid = j;
+				r[j].hash = FaceHash(f);
+			}
+		}
+	}
+
+	// sort the faces into buckets
+	// (this keeps the faces in each bucket in element order)
+	int T = 1;
+	while (T < NR) T <<= 1;
+	m_mask = (unsigned int)(T - 1);
+	m_bucket.assign(T + 1, 0);
+	for (int i = 0; i < NR; ++i) m_bucket[(ref[i].hash & m_mask) + 1]++;
+	for (int i = 0; i < T; ++i) m_bucket[i + 1] += m_bucket[i];
+
+	m_ref.resize(NR);
+	std::vector<int> pos(m_bucket.begin(), m_bucket.end() - 1);
+	for (int i = 0; i < NR; ++i) m_ref[pos[ref[i].hash & m_mask]++] = ref[i];
+}
+
 //-----------------------------------------------------------------------------
 // This function finds the element neighbours.
 //
@@ -699,8 +804,14 @@ void FSMesh::UpdateElementNeighbors()
 	FSNodeElementList NET;
 	NET.Build(this);
 
+	// build the element face table
+	FSElementFaceTable FT;
+	FT.Build(*this);
+
 	// loop over all elements
-#pragma omp parallel for shared(NET)
+	// Note that each element only sets its own neighbors, so the elements can be 
+	// processed independently.
+#pragma omp parallel for shared(NET, FT)
 	for (int i = 0; i < elems; i++)
 	{
 		FEElement_* pe = ElementPtr(i);
@@ -709,54 +820,45 @@ void FSMesh::UpdateElementNeighbors()
 		FSFace f1, f2;
 		for (int j = 0; j < n; j++)
 		{
-			// check if we already have a neighbor assigned
-			if (pe->m_nbr[j] == -1)
+			// get the corresponding element face
+			pe->GetFace(j, f1);
+			unsigned int h = FSElementFaceTable::FaceHash(f1);
+
+			// get the faces with the same hash
+			const FSElementFaceTable::FACEREF* ref = nullptr;
+			int nref = FT.Find(h, ref);
+			bool bfound = false;
+
+			// search for shell neighbors first
+			// This is necessary since a shell can share a face with a solid. 
+			// This requires a bit of special handling, so we need to check for that first
+			for (int k = 0; k < nref; k++)
 			{
-				// get the corresponding element face
-				pe->GetFace(j, f1);
-
-				// pick a node on the face
-				int inode = f1.n[0];
-				int nval = NET.Valence(inode);
-				bool bfound = false;
-
-				// search for shell neighbors first
-				// This is necessary since a shell can share a face with a solid. 
-				// This requires a bit of special handling, so we need to check for that first
-				for (int k = 0; k < nval; k++)
+				if ((ref[k].hash == h) && (ref[k].lid == -1) && (ref[k].eid != i))
 				{
-					int nbe = NET.ElementIndex(inode, k);
-					FEElement_* pne = NET.Element(inode, k);
-					if ((pne != pe) && pne->IsShell())
+					// get the shell surface facet
+					ElementPtr(ref[k].eid)->GetShellFace(f2);
+					if (f1 == f2)
 					{
-						// get the shell surface facet
-						pne->GetShellFace(f2);
-						if (f1 == f2)
-						{
-							bfound = true;
-							pe->m_nbr[j] = nbe;
-							break;
-						}
+						bfound = true;
+						pe->m_nbr[j] = ref[k].eid;
+						break;
 					}
 				}
+			}
 
-				if (bfound == false)
+			if (bfound == false)
+			{
+				// search for solid neighbors next
+				for (int k = 0; k < nref; k++)
 				{
-					// search for solid neighbors next
-					for (int k = 0; k < nval; k++)
+					if ((ref[k].hash == h) && (ref[k].lid >= 0) && (ref[k].eid != i))
 					{
-						int nbe = NET.ElementIndex(inode, k);
-						FEElement_* pne = ElementPtr(nbe);
-						if ((pne != pe) && pne->IsSolid())
+						ElementPtr(ref[k].eid)->GetFace(ref[k].lid, f2);
+						if (f1 == f2)
 						{
-							int l = pne->FindFace(f1);
-							if (l != -1)
-							{
-								bfound = true;
-								pe->m_nbr[j] = nbe;
-								pne->m_nbr[l] = i;
-								break;
-							}
+							pe->m_nbr[j] = ref[k].eid;
+							break;
 						}
 					}
 				}
@@ -767,27 +869,21 @@ void FSMesh::UpdateElementNeighbors()
 		n = pe->Edges();
 		for (int j = 0; j < n; j++)
 		{
-			if (pe->m_nbr[j] == -1)
-			{
-				FSEdge edge = pe->GetEdge(j);
+			FSEdge edge = pe->GetEdge(j);
 
-				// find the neighbour element
-				int inode = edge.n[0];
-				int nval = NET.Valence(inode);
-				bool bfound = false;
-				for (int k = 0; k < nval; k++)
+			// find the neighbour element
+			int inode = edge.n[0];
+			int nval = NET.Valence(inode);
+			for (int k = 0; k < nval; k++)
+			{
+				FEElement_* pne = NET.Element(inode, k);
+				if ((pne != pe) && (pe->is_equal(*pne) == false) && pne->IsShell())
 				{
-					FEElement_* pne = NET.Element(inode, k);
-					if ((pne != pe) && (pe->is_equal(*pne) == false) && pne->IsShell())
+					int l = pne->FindEdge(edge);
+					if (l != -1)
 					{
-						int l = pne->FindEdge(edge);
-						if (l != -1)
-						{
-							bfound = true;
-							pe->m_nbr[j] = NET.ElementIndex(inode, k);
-							pne->m_nbr[l] = i;
-							break;
-						}
+						pe->m_nbr[j] = NET.ElementIndex(inode, k);
+						break;
 					}
 				}
 			}
@@ -925,9 +1021,9 @@ void FSMesh::UpdateFaceElementTable()
 		}
 	}
 
-	// first build the node element table
-	FSNodeElementList NET;
-	NET.Build(this);
+	// first build the element face table
+	FSElementFaceTable FT;
+	FT.Build(*this);
 
 	// loop over all faces
 	FSFace f2;
@@ -935,14 +1031,16 @@ void FSMesh::UpdateFaceElementTable()
 	{
 		FSFace& face = Face(i);
 
-		int n0 = face.n[0];
-		int nval = NET.Valence(n0);
+		unsigned int h = FSElementFaceTable::FaceHash(face);
+		const FSElementFaceTable::FACEREF* ref = nullptr;
+		int nref = FT.Find(h, ref);
 		int m = 0;
 
 		// check shell elements first
-		for (int j = 0; j < nval; ++j)
+		for (int j = 0; j < nref; ++j)
 		{
-			int eid = NET.ElementIndex(n0, j);
+			if (ref[j].hash != h) continue;
+			int eid = ref[j].eid;
 			FEElement_* pej = ElementPtr(eid);
 
 			if (pej->IsShell())
@@ -963,69 +1061,67 @@ void FSMesh::UpdateFaceElementTable()
 		}
 
 		// now, process solids
-		for (int j=0; j<nval; ++j)
+		for (int j=0; j<nref; ++j)
 		{
-			int eid = NET.ElementIndex(n0, j);
+			if ((ref[j].hash != h) || (ref[j].lid < 0)) continue;
+			int eid = ref[j].eid;
 			FEElement_* pej = ElementPtr(eid);
 
-			// solid elements
-			int n = pej->Faces();
-			for (int k = 0; k<n; ++k)
+			// solid element face
+			int k = ref[j].lid;
+			if (pej->m_face[k] == -1)
 			{
-				if (pej->m_face[k] == -1)
+				pej->GetFace(k, f2);
+				if (f2 == face)
 				{
-					pej->GetFace(k, f2);
-					if (f2 == face)
+					assert(m<3);
+					if (m == 0)
 					{
-						assert(m<3);
-						if (m == 0)
+						face.m_elem[m  ].eid = eid;
+						face.m_elem[m++].lid = k;
+					}
+					else if (m < 2)
+					{
+						// set the element with the lowest GID first (except if it is a shell)
+						FEElement_* p0 = ElementPtr(face.m_elem[0].eid);
+						if ((p0->m_gid < pej->m_gid) || (p0->IsShell()))
 						{
 							face.m_elem[m  ].eid = eid;
 							face.m_elem[m++].lid = k;
 						}
-						else if (m < 2)
+						else
 						{
-							// set the element with the lowest GID first (except if it is a shell)
-							FEElement_* p0 = ElementPtr(face.m_elem[0].eid);
-							if ((p0->m_gid < pej->m_gid) || (p0->IsShell()))
-							{
-								face.m_elem[m  ].eid = eid;
-								face.m_elem[m++].lid = k;
-							}
-							else
-							{
-								face.m_elem[m  ].eid = face.m_elem[0].eid;
-								face.m_elem[m++].lid = face.m_elem[0].lid;
+							face.m_elem[m  ].eid = face.m_elem[0].eid;
+							face.m_elem[m++].lid = face.m_elem[0].lid;
 
-								face.m_elem[0].eid = eid;
-								face.m_elem[0].lid = k;
-							}
+							face.m_elem[0].eid = eid;
+							face.m_elem[0].lid = k;
 						}
-						else if (m < 3)
+					}
+					else if (m < 3)
+					{
+						// The only way to get here is if a shell is sandwhiched between
+						// two solids. The shell should have already been found.
+						FEElement_* p0 = ElementPtr(face.m_elem[0].eid);
+						assert(p0 && p0->IsShell());
+
+						// for consistency, we set the solid with the lowest GID first.
+						FEElement_* p1 = ElementPtr(face.m_elem[1].eid); assert(p1 && p1->IsSolid());
+						if (p1->m_gid < pej->m_gid)
 						{
-							// The only way to get here is if a shell is sandwhiched between
-							// two solids. The shell should have already been found.
-							FEElement_* p0 = ElementPtr(face.m_elem[0].eid);
-							assert(p0 && p0->IsShell());
-
-							// for consistency, we set the solid with the lowest GID first.
-							FEElement_* p1 = ElementPtr(face.m_elem[1].eid); assert(p1 && p1->IsSolid());
-							if (p1->m_gid < pej->m_gid)
-							{
-								face.m_elem[m  ].eid = eid;
-								face.m_elem[m++].lid = k;
-							}
-							else
-							{
-								face.m_elem[m  ].eid = face.m_elem[1].eid;
-								face.m_elem[m++].lid = face.m_elem[1].lid;
+							face.m_elem[m  ].eid = eid;
+							face.m_elem[m++].lid = k;
+						}
+						else
+						{
+							face.m_elem[m  ].eid = face.m_elem[1].eid;
+							face.m_elem[m++].lid = face.m_elem[1].lid;
 
-								face.m_elem[1].eid = eid;
-								face.m_elem[1].lid = k;
-							}
+							face.m_elem[1].eid = eid;
+							face.m_elem[1].lid = k;
 						}
-						pej->m_face[k] = i;
 					}
+					pej->m_face[k] = i;
 				}
 			}
 		}
@@ -2057,7 +2153,6 @@ void FSMesh::Load(IArchive& ar)
 				// read arrays
 				vector<int> gid(nodes, -1);
 				vector<int> nnd(nodes, -1);
-				vector<vec3d> pos(nodes);
 				while (IArchive::IO_OK == ar.OpenChunk())
 				{
 					int nid = ar.GetChunkID();
@@ -2065,7 +2160,16 @@ void FSMesh::Load(IArchive& ar)
 					{
 					case CID_MESH_NODE_GID: ar.read(gid); break;
 					case CID_MESH_NODE_NID: ar.read(nnd); break;
-					case CID_MESH_NODE_POSITION: ar.read(pos); break;
+					case CID_MESH_NODE_POSITION:
+					{
+						// copy the positions straight from the archive
+						ArrayView<vec3d> pos;
+						ar.read(pos);
+						if (pos.size() < (size_t)nodes) throw ReadError("error parsing CID_MESH_NODE_SECTION (FSMesh::Load)");
+						FSNode* pn = NodePtr();
+						for (int i = 0; i < nodes; ++i, ++pn) pn->r = pos[i];
+					}
+					break;
 					}
 					ar.CloseChunk();
 				}
@@ -2076,7 +2180,6 @@ void FSMesh::Load(IArchive& ar)
 				{
 					pn->m_gid = gid[i];
 					pn->m_nid = nnd[i];
-					pn->r = pos[i];
 				}
 			}
 			break;
@@ -2155,8 +2258,9 @@ void FSMesh::Load(IArchive& ar)
 					case CID_MESH_ELEMENT_NODES:
 					{
 						assert(elnodes > 0);
-						vector<int> eln(elnodes);
+						ArrayView<int> eln;
 						ar.read(eln);
+						if (eln.size() < (size_t)elnodes) throw ReadError("error parsing CID_MESH_ELEMENT_SECTION (FSMesh::Load)");
 
 						for (int i = 0, n = 0, m = 0; i < elems; ++i)
 						{
@@ -32,6 +32,7 @@ using namespace std;
 //-----------------------------------------------------------------------------
 FSMeshBase::FSMeshBase()
 {
+	m_bvhValid = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -48,6 +49,24 @@ void FSMeshBase::FaceNodeLocalPositions(const FSFace& f, vec3d* r) const
 	for (int i = 0; i<nf; ++i) r[i] = m_Node[f.n[i]].r;
 }
 
+//-----------------------------------------------------------------------------
+const FSFaceBVH& FSMeshBase::GetFaceBVH() const
+{
+	// node positions can be changed without telling us, but those changes 
+	// should show up in the bounding box.
+	const BOX& b = m_bvhBox;
+	bool bsameBox = (b.x0 == m_box.x0) && (b.y0 == m_box.y0) && (b.z0 == m_box.z0) &&
+					(b.x1 == m_box.x1) && (b.y1 == m_box.y1) && (b.z1 == m_box.z1);
+
+	if ((m_bvhValid == false) || (bsameBox == false) || (m_bvh.Faces() != Faces()))
+	{
+		m_bvh.Build(*this);
+		m_bvhBox = m_box;
+		m_bvhValid = true;
+	}
+	return m_bvh;
+}
+
 //-----------------------------------------------------------------------------
 // Tag all faces
 void FSMeshBase::TagAllFaces(int ntag)
@@ -118,6 +137,7 @@ void FSMeshBase::RemoveFaces(int ntag)
 		}
 	}
 	m_Face.resize(n);
+	m_bvhValid = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -233,6 +253,9 @@ void FSMeshBase::AutoSmooth(double angleDegrees, bool creaseInternal)
 //
 void FSMeshBase::UpdateNormals()
 {
+	// normals are updated when the nodes have moved, so we need a new hierarchy
+	m_bvhValid = false;
+
 	int NN = Nodes();
 	int NF = Faces();
 
@@ -33,6 +33,7 @@ SOFTWARE.*/
 #include "FEFace.h"
 #include "FELineMesh.h"
 #include "FENodeFaceList.h"
+#include "FEFaceBVH.h"
 
 //-------------------------------------------------------------------
 // Base class for mesh classes.
@@ -52,6 +53,11 @@ public:
 	// get the local positions of a face
 	void FaceNodeLocalPositions(const FSFace& f, vec3d* r) const;
 
+	// Get the face hierarchy (in local coordinates) for ray casting. It is built 
+	// on first use and rebuilt when the mesh was updated after the faces or nodes changed.
+	const FSFaceBVH& GetFaceBVH() const;
+	void InvalidateFaceBVH() { m_bvhValid = false; }
+
 public:
 	// calculate smoothing IDs based on face normals.
 	void AutoSmooth(double angleDegrees, bool creaseInternal = true);
@@ -89,9 +95,9 @@ public: // interface for accessing mesh items
 	FSFace* FacePtr(int n = 0) { return ((n >= 0) && (n<(int)m_Face.size()) ? &m_Face[n] : 0); }
 	const FSFace* FacePtr(int n = 0) const { return ((n >= 0) && (n<(int)m_Face.size()) ? &m_Face[n] : 0); }
 
-	void DeleteFaces() { if (!m_Face.empty()) m_Face.clear(); }
+	void DeleteFaces() { if (!m_Face.empty()) m_Face.clear(); m_bvhValid = false; }
 	void DeleteEdges() { if (!m_Edge.empty()) m_Edge.clear(); }
-	void DeleteNodes() { if (!m_Node.empty()) m_Node.clear(); }
+	void DeleteNodes() { if (!m_Node.empty()) m_Node.clear(); m_bvhValid = false; }
 
 public:
 	void TagAllFaces(int ntag);
@@ -118,6 +124,10 @@ protected:
 	std::vector<FSFace>		m_Face;	//!< FE faces
 
 	FSNodeFaceList		m_NFL;
+
+	mutable FSFaceBVH	m_bvh;		// cached face hierarchy
+	mutable BOX			m_bvhBox;	// bounding box of the mesh when the hierarchy was built
+	mutable bool		m_bvhValid;
 };
 
 //-------------------------------------------------------------------
@@ -0,0 +1,214 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FEMeshDelta.h"
+#include "FEMesh.h"
+
+//-----------------------------------------------------------------------------
+// Check if two meshes have the same topology, i.e. they are equal except for 
+// the node positions.
+static bool sameTopology(const FSMesh& a, const FSMesh& b)
+{
+	if ((a.Nodes() != b.Nodes()) || (a.Elements() != b.Elements()) ||
+		(a.Faces() != b.Faces()) || (a.Edges() != b.Edges())) return false;
+
+	// we don't try to compare mesh data
+	if ((a.MeshDataFields() != 0) || (b.MeshDataFields() != 0)) return false;
+
+	for (int i = 0; i < a.Nodes(); ++i)
+	{
+		if (a.Node(i).m_gid != b.Node(i).m_gid) return false;
+	}
+
+	bool same = true;
+#pragma omp parallel for reduction(&&:same)
+	for (int i = 0; i < a.Elements(); ++i)
+	{
+		const FSElement& ea = a.Element(i);
+		const FSElement& eb = b.Element(i);
+		if ((ea.Type() != eb.Type()) || (ea.m_gid != eb.m_gid) || (ea.m_MatID != eb.m_MatID) ||
+			(ea.m_Qactive != eb.m_Qactive) || (ea.m_a0 != eb.m_a0) ||
+			(ea.m_fiber.x != eb.m_fiber.x) || (ea.m_fiber.y != eb.m_fiber.y) || (ea.m_fiber.z != eb.m_fiber.z)) same = false;
+		else
+		{
+			for (int j = 0; j < ea.Nodes(); ++j)
+			{
+				if (ea.m_node[j] != eb.m_node[j]) same = false;
+				if (ea.IsShell() && (ea.m_h[j] != eb.m_h[j])) same = false;
+			}
+			for (int j = 0; j < 3; ++j)
+				for (int k = 0; k < 3; ++k)
+					if (ea.m_Q(j, k) != eb.m_Q(j, k)) same = false;
+		}
+	}
+	if (same == false) return false;
+
+	for (int i = 0; i < a.Faces(); ++i)
+	{
+		const FSFace& fa = a.Face(i);
+		const FSFace& fb = b.Face(i);
+		if ((fa.Type() != fb.Type()) || (fa.m_gid != fb.m_gid) || (fa.m_sid != fb.m_sid)) return false;
+		for (int j = 0; j < fa.Nodes(); ++j) if (fa.n[j] != fb.n[j]) return false;
+	}
+
+	for (int i = 0; i < a.Edges(); ++i)
+	{
+		const FSEdge& ea = a.Edge(i);
+		const FSEdge& eb = b.Edge(i);
+		if ((ea.Type() != eb.Type()) || (ea.m_gid != eb.m_gid)) return false;
+		for (int j = 0; j < ea.Nodes(); ++j) if (ea.n[j] != eb.n[j]) return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// store the items of the two lists whose state flags differ
+template <class A, class B> static void diffStates(A a, B b, int n, std::vector<int>& item, std::vector<unsigned int>& sold, std::vector<unsigned int>& snew)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		unsigned int s0 = a(i).GetFEState();
+		unsigned int s1 = b(i).GetFEState();
+		if (s0 != s1)
+		{
+			item.push_back(i);
+			sold.push_back(s0);
+			snew.push_back(s1);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+FSMeshDelta::FSMeshDelta()
+{
+	m_nodes = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshDelta::Clear()
+{
+	m_nodes = 0;
+	m_range.clear();
+	m_rold.clear();
+	m_rnew.clear();
+
+	STATES* st[] = { &m_node, &m_edge, &m_face, &m_elem };
+	for (STATES* si : st)
+	{
+		si->item.clear();
+		si->sold.clear();
+		si->snew.clear();
+	}
+}
+
+//-----------------------------------------------------------------------------
+bool FSMeshDelta::Create(const FSMesh& oldMesh, const FSMesh& newMesh)
+{
+	Clear();
+	if (sameTopology(oldMesh, newMesh) == false) return false;
+
+	m_nodes = oldMesh.Nodes();
+	for (int i = 0; i < m_nodes; )
+	{
+		// find the next node that moved
+		const vec3d& r0 = oldMesh.Node(i).r;
+		const vec3d& r1 = newMesh.Node(i).r;
+		if ((r0.x == r1.x) && (r0.y == r1.y) && (r0.z == r1.z)) { ++i; continue; }
+
+		// store the range of moved nodes
+		RANGE rng;
+		rng.n0 = i;
+		rng.offset = (int)m_rold.size();
+		for (; i < m_nodes; ++i)
+		{
+			const vec3d& ra = oldMesh.Node(i).r;
+			const vec3d& rb = newMesh.Node(i).r;
+			if ((ra.x == rb.x) && (ra.y == rb.y) && (ra.z == rb.z)) break;
+			m_rold.push_back(ra);
+			m_rnew.push_back(rb);
+		}
+		rng.n1 = i;
+		m_range.push_back(rng);
+	}
+
+	m_rold.shrink_to_fit();
+	m_rnew.shrink_to_fit();
+
+	// store the state changes
+	diffStates([&](int i) -> const FSNode& { return oldMesh.Node(i); }, [&](int i) -> const FSNode& { return newMesh.Node(i); }, m_nodes, m_node.item, m_node.sold, m_node.snew);
+	diffStates([&](int i) -> const FSEdge& { return oldMesh.Edge(i); }, [&](int i) -> const FSEdge& { return newMesh.Edge(i); }, oldMesh.Edges(), m_edge.item, m_edge.sold, m_edge.snew);
+	diffStates([&](int i) -> const FSFace& { return oldMesh.Face(i); }, [&](int i) -> const FSFace& { return newMesh.Face(i); }, oldMesh.Faces(), m_face.item, m_face.sold, m_face.snew);
+	diffStates([&](int i) -> const FSElement& { return oldMesh.Element(i); }, [&](int i) -> const FSElement& { return newMesh.Element(i); }, oldMesh.Elements(), m_elem.item, m_elem.sold, m_elem.snew);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void FSMeshDelta::Apply(FSMesh& mesh, bool bnew) const
+{
+	assert(mesh.Nodes() == m_nodes);
+	if (mesh.Nodes() != m_nodes) return;
+
+	const std::vector<vec3d>& r = (bnew ? m_rnew : m_rold);
+	int NR = (int)m_range.size();
+#pragma omp parallel for
+	for (int i = 0; i < NR; ++i)
+	{
+		const RANGE& rng = m_range[i];
+		for (int n = rng.n0; n < rng.n1; ++n)
+		{
+			mesh.Node(n).r = r[rng.offset + n - rng.n0];
+		}
+	}
+
+	// restore the item states
+	for (size_t i = 0; i < m_node.item.size(); ++i) mesh.Node(m_node.item[i]).SetFEState(bnew ? m_node.snew[i] : m_node.sold[i]);
+	for (size_t i = 0; i < m_edge.item.size(); ++i) mesh.Edge(m_edge.item[i]).SetFEState(bnew ? m_edge.snew[i] : m_edge.sold[i]);
+	for (size_t i = 0; i < m_face.item.size(); ++i) mesh.Face(m_face.item[i]).SetFEState(bnew ? m_face.snew[i] : m_face.sold[i]);
+	for (size_t i = 0; i < m_elem.item.size(); ++i) mesh.Element(m_elem.item[i]).SetFEState(bnew ? m_elem.snew[i] : m_elem.sold[i]);
+}
+
+//-----------------------------------------------------------------------------
+size_t FSMeshDelta::MemoryUsage() const
+{
+	size_t mem = sizeof(FSMeshDelta) + m_range.capacity() * sizeof(RANGE) + (m_rold.capacity() + m_rnew.capacity()) * sizeof(vec3d);
+	const STATES* st[] = { &m_node, &m_edge, &m_face, &m_elem };
+	for (const STATES* si : st) mem += si->item.capacity() * (sizeof(int) + 2 * sizeof(unsigned int));
+	return mem;
+}
+
+//-----------------------------------------------------------------------------
+size_t MeshMemoryUsage(const FSMeshBase& mesh)
+{
+	return (size_t)mesh.Nodes() * sizeof(FSNode) + (size_t)mesh.Faces() * sizeof(FSFace) + (size_t)mesh.Edges() * sizeof(FSEdge);
+}
+
+//-----------------------------------------------------------------------------
+size_t MeshMemoryUsage(const FSMesh& mesh)
+{
+	return MeshMemoryUsage((const FSMeshBase&)mesh) + (size_t)mesh.Elements() * sizeof(FSElement);
+}
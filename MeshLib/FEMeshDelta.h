@@ -0,0 +1,84 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/math3d.h>
+#include <vector>
+
+class FSMeshBase;
+class FSMesh;
+
+//-----------------------------------------------------------------------------
+// Stores the difference between two revisions of a mesh that differ only in 
+// their node positions and item states (e.g. selection). Only the ranges of nodes
+// that moved and the items whose state changed are stored, so that commands that 
+// move nodes don't need to keep a full copy of the mesh around.
+class FSMeshDelta
+{
+	struct RANGE
+	{
+		int	n0, n1;		// first and one-past-last node of range
+		int	offset;		// offset into position arrays
+	};
+
+	struct STATES
+	{
+		std::vector<int>			item;	// items whose state changed
+		std::vector<unsigned int>	sold;	// old state
+		std::vector<unsigned int>	snew;	// new state
+	};
+
+public:
+	FSMeshDelta();
+
+	// Build the delta between two meshes. Returns false if the meshes differ in 
+	// anything other than the node positions, in which case no delta is stored.
+	bool Create(const FSMesh& oldMesh, const FSMesh& newMesh);
+
+	// Set the node positions of the new (bnew = true) or old revision.
+	// The mesh must be one of the two meshes that were used to create the delta.
+	void Apply(FSMesh& mesh, bool bnew) const;
+
+	void Clear();
+
+	bool IsEmpty() const { return m_range.empty(); }
+
+	// memory used by the delta (in bytes)
+	size_t MemoryUsage() const;
+
+private:
+	int					m_nodes;	// number of nodes in mesh
+	std::vector<RANGE>	m_range;	// ranges of moved nodes
+	std::vector<vec3d>	m_rold;		// old node positions
+	std::vector<vec3d>	m_rnew;		// new node positions
+
+	STATES	m_node, m_edge, m_face, m_elem;	// item state changes
+};
+
+//-----------------------------------------------------------------------------
+// estimate the memory used by a mesh (in bytes)
+size_t MeshMemoryUsage(const FSMeshBase& mesh);
+size_t MeshMemoryUsage(const FSMesh& mesh);
@@ -39,41 +39,62 @@ void FSNodeElementList::Build(FSCoreMesh* pm)
 {
 	m_pm = pm;
 	assert(m_pm);
-	m_elem.clear();
+	m_off.clear();
+	m_ref.clear();
 
 	int NN = m_pm->Nodes();
 	int NE = m_pm->Elements();
 	if ((NE == 0) || (NN == 0)) return;
 
-	m_elem.resize(NN);
-	for (int i=0; i<NE; ++i)
+	// count the valence of each node
+	std::vector<int> val(NN, 0);
+#pragma omp parallel for
+	for (int i = 0; i < NE; ++i)
 	{
 		FEElement_& el = m_pm->ElementRef(i);
 		int ne = el.Nodes();
-		for (int j=0; j<ne; ++j) 
+		for (int j = 0; j < ne; ++j)
 		{
 			int n = el.m_node[j];
+#pragma omp atomic
+			val[n]++;
+		}
+	}
 
-			std::vector<NodeElemRef>& lj = m_elem[n];
-
-			NodeElemRef ref;
+	// build the offsets
+	m_off.resize(NN + 1);
+	m_off[0] = 0;
+	for (int i = 0; i < NN; ++i) m_off[i + 1] = m_off[i] + val[i];
+	m_ref.resize(m_off[NN]);
+
+	// fill the table
+	// (This is done serially, since a parallel fill needs OpenMP 3.1's atomic capture, and 
+	// it is cheap compared to the count. Visiting the elements in order also keeps the 
+	// rows sorted, which makes the table deterministic.)
+	for (int i = 0; i < NN; ++i) val[i] = 0;
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = m_pm->ElementRef(i);
+		int ne = el.Nodes();
+		for (int j = 0; j < ne; ++j)
+		{
+			int n = el.m_node[j];
+			NodeElemRef& ref = m_ref[m_off[n] + val[n]++];
 			ref.eid = i;
 			ref.nid = j;
-			ref.pe = &el;
-
-			lj.push_back(ref);
 		}
 	}
 }
 
 void FSNodeElementList::Clear()
 {
-	m_elem.clear();
+	m_off.clear();
+	m_ref.clear();
 }
 
 bool FSNodeElementList::IsEmpty() const
 {
-	return m_elem.empty();
+	return m_off.empty();
 }
 
 bool FSNodeElementList::HasElement(int node, int iel) const
@@ -33,9 +33,32 @@ SOFTWARE.*/
 struct NodeElemRef {
 	int		eid;	// element index in mesh
 	int		nid;	// local node index of the element
-	FEElement_*	pe;	// pointer to element
 };
 
+//-----------------------------------------------------------------------------
+// The list of elements that share a node. This is a view into the 
+// node-element list, so it is only valid as long as the list is not rebuilt.
+class NodeElemRange
+{
+public:
+	NodeElemRange(const NodeElemRef* p, int n) : m_p(p), m_n(n) {}
+
+	int size() const { return m_n; }
+	bool empty() const { return (m_n == 0); }
+
+	const NodeElemRef& operator [] (int i) const { return m_p[i]; }
+
+	const NodeElemRef* begin() const { return m_p; }
+	const NodeElemRef* end() const { return m_p + m_n; }
+
+private:
+	const NodeElemRef*	m_p;
+	int					m_n;
+};
+
+//-----------------------------------------------------------------------------
+// Node-element table, stored in compressed row format. The elements of each 
+// node are sorted by element index.
 class FSNodeElementList
 {
 public:
@@ -48,16 +71,17 @@ public:
 
 	bool IsEmpty() const;
 
-	int Valence(int n) const { return (int)m_elem[n].size(); }
-	FEElement_* Element(int n, int j) { return m_elem[n][j].pe; }
-	int ElementIndex(int n, int j) const { return m_elem[n][j].eid; }
+	int Valence(int n) const { return m_off[n + 1] - m_off[n]; }
+	FEElement_* Element(int n, int j) { return &m_pm->ElementRef(m_ref[m_off[n] + j].eid); }
+	int ElementIndex(int n, int j) const { return m_ref[m_off[n] + j].eid; }
 
 	bool HasElement(int node, int iel) const;
 
 	std::vector<int> ElementIndexList(int n) const;
-	const std::vector<NodeElemRef>& ElementList(int n) const { return m_elem[n]; }
+	NodeElemRange ElementList(int n) const { return NodeElemRange(m_ref.data() + m_off[n], Valence(n)); }
 
 protected:
 	FSCoreMesh*	m_pm;
-	std::vector< std::vector<NodeElemRef> >	m_elem;
+	std::vector<int>			m_off;	// offset into m_ref for each node (size = nodes + 1)
+	std::vector<NodeElemRef>	m_ref;	// node-element references
 };
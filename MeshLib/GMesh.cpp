@@ -35,6 +35,7 @@ using std::stack;
 //-----------------------------------------------------------------------------
 GMesh::GMesh(void)
 {
+	m_bvhValid = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -48,6 +49,7 @@ void GMesh::Create(int nodes, int faces, int edges)
 	m_Node.resize(nodes);
 	m_Face.resize(faces);
 	m_Edge.resize(edges);
+	m_bvhValid = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -56,6 +58,7 @@ void GMesh::Clear()
 	m_Node.clear();
 	m_Edge.clear();
 	m_Face.clear();
+	m_bvhValid = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -317,6 +320,8 @@ void GMesh::UpdateNormals(int* pid, int nsize)
 // Update normals for all faces using smoothing groups
 void GMesh::UpdateNormals()
 {
+	m_bvhValid = false;
+
 	int NN = Nodes();
 	int NF = Faces();
 
@@ -470,6 +475,9 @@ bool CmpEdge(GMesh::EDGE e1, GMesh::EDGE e2)
 //-----------------------------------------------------------------------------
 void GMesh::Update()
 {
+	// faces are reordered and nodes may have moved
+	m_bvhValid = false;
+
 	int NF = (int) m_Face.size();
 	if (NF)
 	{
@@ -635,6 +643,8 @@ void GMesh::Extrude(double d, vec3d t)
 //-----------------------------------------------------------------------------
 void GMesh::UpdateBoundingBox()
 {
+	m_bvhValid = false;
+
 	m_box.x0 = m_box.y0 = m_box.z0 = 0.0;
 	m_box.x1 = m_box.y1 = m_box.z1 = 0.0;
 
@@ -649,6 +659,27 @@ void GMesh::UpdateBoundingBox()
 	}
 }
 
+//-----------------------------------------------------------------------------
+const FSFaceBVH& GMesh::GetFaceBVH() const
+{
+	if ((m_bvhValid == false) || (m_bvh.Faces() != Faces()))
+	{
+		int NF = Faces();
+		vector<BOX> box(NF);
+		for (int i = 0; i < NF; ++i)
+		{
+			const FACE& f = m_Face[i];
+			BOX& b = box[i];
+			b = BOX(m_Node[f.n[0]].r, m_Node[f.n[0]].r);
+			b += m_Node[f.n[1]].r;
+			b += m_Node[f.n[2]].r;
+		}
+		m_bvh.Build(box);
+		m_bvhValid = true;
+	}
+	return m_bvh;
+}
+
 //-----------------------------------------------------------------------------
 void GMesh::FindNeighbors()
 {
@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include <FSCore/box.h>
 #include <FSCore/color.h>
+#include "FEFaceBVH.h"
 #include <vector>
 //using namespace std;
 
@@ -101,6 +102,10 @@ public:
 
 	void Attach(GMesh& m, bool bupdate = true);
 
+	// Get the face hierarchy for ray casting. It is built on first use
+	// and rebuilt after the mesh was updated.
+	const FSFaceBVH& GetFaceBVH() const;
+
 public:
 	int	AddNode(const vec3d& r, int groupID = 0);
 	int	AddNode(const vec3d& r, int nodeID, int groupID);
@@ -119,6 +124,9 @@ protected:
 	vector<EDGE>	m_Edge;
 	vector<FACE>	m_Face;
 
+	mutable FSFaceBVH	m_bvh;	// cached face hierarchy
+	mutable bool		m_bvhValid;
+
 public:
 	vector<pair<int, int> >	m_FIL;
 	vector<pair<int, int> >	m_EIL;
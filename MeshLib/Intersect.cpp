@@ -195,39 +195,37 @@ bool FindFaceIntersection(const Ray& ray, const FSMeshBase& mesh, Intersection&
 {
 	vec3d rn[10];
 
-	int faces = mesh.Faces();
-	vec3d r, rmin;
 	double gmin = 1e99;
 	bool b = false;
 
 	q.m_index = -1;
 	Intersection tmp;
-	for (int i=0; i<faces; ++i)
-	{
+
+	// only faces whose box is hit by the ray are tested
+	const FSFaceBVH& bvh = mesh.GetFaceBVH();
+	bvh.ClosestHit(ray.origin, ray.direction, false, [&](int i, double& D) {
 		const FSFace& face = mesh.Face(i);
-		if (face.IsVisible())
-		{
-			mesh.FaceNodeLocalPositions(face, rn);
-			bool bfound = RayIntersectFace(ray, face.Type(), rn, tmp);
+		if (face.IsVisible() == false) return false;
 
-			if (bfound)
-			{
-				// signed distance
-				float distance = ray.direction*(tmp.point - ray.origin);
+		mesh.FaceNodeLocalPositions(face, rn);
+		if (RayIntersectFace(ray, face.Type(), rn, tmp) == false) return false;
 
-				if ((distance > 0.f) && (distance < gmin))
-				{
-					gmin = distance;
-					rmin = q.point;
-					b = true;
-					q.m_index = i;
-					q.point = tmp.point;
-					q.r[0] = tmp.r[0];
-					q.r[1] = tmp.r[1];
-				}
-			}
+		// signed distance
+		float distance = ray.direction*(tmp.point - ray.origin);
+		if (distance <= 0.f) return false;
+
+		D = (tmp.point - ray.origin).Length();
+		if (distance < gmin)
+		{
+			gmin = distance;
+			b = true;
+			q.m_index = i;
+			q.point = tmp.point;
+			q.r[0] = tmp.r[0];
+			q.r[1] = tmp.r[1];
 		}
-	}
+		return true;
+	});
 
 	return b;
 }
@@ -235,43 +233,36 @@ bool FindFaceIntersection(const Ray& ray, const FSMeshBase& mesh, Intersection&
 //-----------------------------------------------------------------------------
 bool FindFaceIntersection(const Ray& ray, const GMesh& mesh, Intersection& q)
 {
-	vec3d rn[3];
-	int faces = mesh.Faces();
-	vec3d r, rmin;
 	double gmin = 1e99;
 	bool b = false;
 
 	q.m_index = -1;
 	Intersection tmp;
-	for (int i = 0; i<faces; ++i)
-	{
+
+	// only faces whose box is hit by the ray are tested
+	const FSFaceBVH& bvh = mesh.GetFaceBVH();
+	bvh.ClosestHit(ray.origin, ray.direction, false, [&](int i, double& D) {
 		const GMesh::FACE& face = mesh.Face(i);
 
-		rn[0] = mesh.Node(face.n[0]).r;
-		rn[1] = mesh.Node(face.n[1]).r;
-		rn[2] = mesh.Node(face.n[2]).r;
+		Triangle tri = { mesh.Node(face.n[0]).r, mesh.Node(face.n[1]).r, mesh.Node(face.n[2]).r };
+		if (IntersectTriangle(ray, tri, tmp) == false) return false;
 
-		bool bfound = false;
-		Triangle tri = { rn[0], rn[1], rn[2] };
-		bfound = IntersectTriangle(ray, tri, tmp);
+		// signed distance
+		float distance = ray.direction*(tmp.point - ray.origin);
+		if (distance <= 0.f) return false;
 
-		if (bfound)
+		D = (tmp.point - ray.origin).Length();
+		if (distance < gmin)
 		{
-			// signed distance
-			float distance = ray.direction*(tmp.point - ray.origin);
-
-			if ((distance > 0.f) && (distance < gmin))
-			{
-				gmin = distance;
-				rmin = q.point;
-				b = true;
-				q.m_index = i;
-				q.point = tmp.point;
-				q.r[0] = tmp.r[0];
-				q.r[1] = tmp.r[1];
-			}
+			gmin = distance;
+			b = true;
+			q.m_index = i;
+			q.point = tmp.point;
+			q.r[0] = tmp.r[0];
+			q.r[1] = tmp.r[1];
 		}
-	}
+		return true;
+	});
 
 	return b;
 }
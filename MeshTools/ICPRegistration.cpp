@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #include "stdafx.h"
 #include "ICPRegistration.h"
+#include "KDTree.h"
 #include <GeomLib/GObject.h>
 #include <MeshLib/FEMesh.h>
 #include <FECore/matrix.h>
@@ -96,6 +97,7 @@ GICPRegistration::GICPRegistration()
 {
 	m_maxiter = 100;
 	m_tol = 0.001;
+	m_method = POINT_TO_POINT;
 
 	m_iters = 0;
 	m_err = 0.0;
@@ -115,7 +117,28 @@ Transform GICPRegistration::Register(GObject* ptrg, GObject* psrc)
 	for (int i = 0; i < NX; ++i) X[i] = ptrg->GetTransform().LocalToGlobal(trgMesh.Node(i).r);
 	for (int i = 0; i < NP; ++i) P[i] = psrc->GetTransform().LocalToGlobal(srcMesh.Node(i).r);
 
-	Transform Q = Register(X, P);
+	// for point-to-plane registration we need the target normals,
+	// which we get by averaging the face node normals
+	vector<vec3d> XN;
+	if (m_method == POINT_TO_PLANE)
+	{
+		XN.assign(NX, vec3d(0, 0, 0));
+		for (int i = 0; i < trgMesh.Faces(); ++i)
+		{
+			FSFace& face = trgMesh.Face(i);
+			int nf = face.Nodes();
+			for (int j = 0; j < nf; ++j) XN[face.n[j]] += to_vec3d(face.m_nn[j]);
+		}
+
+		quatd q = ptrg->GetTransform().GetRotation();
+		for (int i = 0; i < NX; ++i)
+		{
+			XN[i] = q * XN[i];
+			XN[i].Normalize();
+		}
+	}
+
+	Transform Q = Register(X, XN, P);
 
 	vec3d r_old = psrc->GetTransform().GetPosition();
 	vec3d r_new = Q.GetRotation() * (r_old)+Q.GetPosition();
@@ -127,6 +150,17 @@ Transform GICPRegistration::Register(GObject* ptrg, GObject* psrc)
 
 Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>& S)
 {
+	return Register(X, vector<vec3d>(), S);
+}
+
+Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>& XN, const vector<vec3d>& S)
+{
+	m_iters = 0;
+	m_err = 0.0;
+
+	// we need points to register
+	if (X.empty() || S.empty()) return Transform();
+
 	vector<vec3d> P = S;
 
 	int NX = (int)X.size();
@@ -163,23 +197,46 @@ Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>
 	for (int i=1; i<NP; ++i) box += P[i];
 	double R = box.Radius();
 
+	// point-to-plane needs a normal for each target point
+	bool bplane = (m_method == POINT_TO_PLANE) && (XN.size() == X.size());
+
+	// the target points don't move, so we only need to build the search tree once
+	KDTree tree;
+	tree.Build(X);
+
 	// reserve space for the Y-vector
 	// (stores the closest points in X to P)
 	vector<vec3d> Y(NP);
+	vector<int> YI(NP);
+	vector<vec3d> N;
 
 	m_iters = 0;
 	m_err = 0.0;
 
 	// loop over max iteration
 	Transform Q;
+	if (bplane) Q.SetPosition(t0);
 	double prev_err = 0.0;
 	for (m_iters = 1; m_iters < m_maxiter; m_iters++)
 	{
 		// Compute the closest point set Y
-		ClosestPointSet(X, P, Y);
+		if (ClosestPointSet(tree, X, P, Y, YI) == false) break;
 
 		// compute the registration
-		Q = Register(P0, Y, &m_err);
+		if (bplane)
+		{
+			// the point-to-plane step is incremental, so we add it to the current transform
+			N.resize(NP);
+			for (int i = 0; i < NP; ++i) N[i] = XN[YI[i]];
+			Transform dQ = PointToPlaneStep(P, Y, N, &m_err);
+
+			const quatd& dq = dQ.GetRotation();
+			quatd q = dq * Q.GetRotation();
+			vec3d t = dq * Q.GetPosition() + dQ.GetPosition();
+			Q.SetRotation(q);
+			Q.SetPosition(t);
+		}
+		else Q = Register(P0, Y, &m_err);
 
 		// apply the registration
 		ApplyTransform(P0, Q, P);
@@ -194,33 +251,30 @@ Transform GICPRegistration::Register(const vector<vec3d>& X, const vector<vec3d>
 	return Q;
 }
 
-void GICPRegistration::ClosestPointSet(const vector<vec3d>& X, const vector<vec3d>& P, vector<vec3d>& Y)
+bool GICPRegistration::ClosestPointSet(const KDTree& tree, const vector<vec3d>& X, const vector<vec3d>& P, vector<vec3d>& Y, vector<int>& YI)
 {
 	// get the vector sizes
-	int NX = (int) X.size();
 	int NP = (int) P.size();
 
 	// make sure Y is the right size
 	// (must be same size as P)
 	Y.resize(NP);
+	YI.resize(NP);
+	if (X.empty()) return false;
 
 	// Find the closest node int X for each point in P
 	// and store in Y
+	bool bok = true;
+#pragma omp parallel for
 	for (int i = 0; i<NP; i++)
 	{
-		double min_dist = 1e99;
-		const vec3d& Pi = P[i];
-		for(int j = 0; j<NX; j++)
-		{
-			const vec3d& Xj = X[j];
-			double dist = (Pi - Xj).Length();
-			if (dist < min_dist)
-			{
-				min_dist = dist;
-				Y[i] = Xj;
-			}
-		}
+		int j = tree.FindNearest(P[i]);
+		if (j < 0) { bok = false; j = 0; }
+		YI[i] = j;
+		Y[i] = X[j];
 	}
+
+	return bok;
 }
 
 Transform GICPRegistration::Register(const vector<vec3d>& P, const vector<vec3d>& Y, double* perr)
@@ -324,6 +378,63 @@ Transform GICPRegistration::Register(const vector<vec3d>& P, const vector<vec3d>
 	return T;
 }
 
+// Calculates the incremental transform that minimizes the distances of the points P
+// to the tangent planes at Y. The rotation is linearized, so this assumes that
+// the points are already close, which is the case after the initial alignment.
+Transform GICPRegistration::PointToPlaneStep(const vector<vec3d>& P, const vector<vec3d>& Y, const vector<vec3d>& N, double* perr)
+{
+	// setup the normal equations for the rotation vector w and translation t
+	// that minimize sum ((p + w x p + t - y).n)^2
+	matrix A(6, 6); A.zero();
+	vector<double> b(6, 0.0);
+	int NP = (int)P.size();
+	for (int i = 0; i < NP; ++i)
+	{
+		const vec3d& n = N[i];
+		vec3d c = P[i] ^ n;
+		double a[6] = { c.x, c.y, c.z, n.x, n.y, n.z };
+		double r = (Y[i] - P[i]) * n;
+		for (int k = 0; k < 6; ++k)
+		{
+			for (int l = 0; l < 6; ++l) A[k][l] += a[k] * a[l];
+			b[k] += a[k] * r;
+		}
+	}
+
+	// symmetric targets (e.g. planes or spheres) leave some motions undetermined,
+	// so we add a small amount of regularization
+	double tr = 0.0;
+	for (int k = 0; k < 6; ++k) tr += A[k][k];
+	for (int k = 0; k < 6; ++k) A[k][k] += 1e-9*tr/6.0;
+
+	vector<double> x(6, 0.0);
+	A.solve(x, b);
+
+	vec3d w(x[0], x[1], x[2]);
+	vec3d t(x[3], x[4], x[5]);
+	double angle = w.Length();
+	quatd q = (angle > 0 ? quatd(angle, w / angle) : quatd(0.0, vec3d(1, 0, 0)));
+
+	Transform T;
+	T.SetPosition(t);
+	T.SetRotation(q);
+
+	if (perr)
+	{
+		// rms of the point-to-plane distances after the update
+		double err = 0.0;
+		for (int i = 0; i < NP; ++i)
+		{
+			vec3d p1 = q*P[i] + t;
+			double d = (p1 - Y[i])*N[i];
+			err += d*d;
+		}
+		*perr = (NP > 0 ? sqrt(err / NP) : 0.0);
+	}
+
+	return T;
+}
+
 void GICPRegistration::ApplyTransform(const vector<vec3d>& P0, const Transform& Q, vector<vec3d>& P)
 {
 	const vec3d& t = Q.GetPosition();
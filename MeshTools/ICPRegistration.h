@@ -29,31 +29,43 @@ SOFTWARE.*/
 #include <vector>
 
 class GObject;
-
+class KDTree;
 
 class GICPRegistration
 {
+public:
+	enum Method {
+		POINT_TO_POINT,
+		POINT_TO_PLANE	// minimizes the distance to the tangent planes of the target (requires target normals)
+	};
+
 public:
 	GICPRegistration();
 
 	// returns the transform from registring source to target
 	Transform Register(GObject* ptrg, GObject* psrc);
 	Transform Register(const std::vector<vec3d>& trg, const std::vector<vec3d>& src);
+	Transform Register(const std::vector<vec3d>& trg, const std::vector<vec3d>& trgNormals, const std::vector<vec3d>& src);
 
 	void SetMaxIterations(int n) { m_maxiter = n; }
 	void SetTolerance(double tol) { m_tol = tol; }
 
+	void SetMethod(int m) { m_method = m; }
+	int GetMethod() const { return m_method; }
+
 	int Iterations() const { return m_iters; }
 	double RelativeError() const { return m_err; }
 
 private:
-	void ClosestPointSet(const std::vector<vec3d>& X, const std::vector<vec3d>& P, std::vector<vec3d>& Y);
+	bool ClosestPointSet(const KDTree& tree, const std::vector<vec3d>& X, const std::vector<vec3d>& P, std::vector<vec3d>& Y, std::vector<int>& YI);
 	Transform Register(const std::vector<vec3d>& P0, const std::vector<vec3d>& Y, double* err);
+	Transform PointToPlaneStep(const std::vector<vec3d>& P, const std::vector<vec3d>& Y, const std::vector<vec3d>& N, double* err);
 	void ApplyTransform(const std::vector<vec3d>& P0, const Transform& Q, std::vector<vec3d>& P);
 
 private:
 	double	m_tol;
 	int		m_maxiter;
+	int		m_method;
 
 	int		m_iters;
 	double	m_err;
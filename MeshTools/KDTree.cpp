@@ -0,0 +1,145 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "KDTree.h"
+#include <algorithm>
+using namespace std;
+
+// ranges that are this small are searched directly
+const int KDTREE_LEAF_SIZE = 8;
+
+//-----------------------------------------------------------------------------
+static inline double kd_coord(const vec3d& r, int axis)
+{
+	return (axis == 0 ? r.x : (axis == 1 ? r.y : r.z));
+}
+
+//-----------------------------------------------------------------------------
+KDTree::KDTree()
+{
+}
+
+//-----------------------------------------------------------------------------
+void KDTree::Clear()
+{
+	m_pt.clear();
+	m_axis.clear();
+}
+
+//-----------------------------------------------------------------------------
+void KDTree::Build(const vector<vec3d>& points)
+{
+	int N = (int)points.size();
+	m_pt.resize(N);
+	for (int i = 0; i < N; ++i)
+	{
+		m_pt[i].r = points[i];
+		m_pt[i].index = i;
+	}
+	m_axis.assign(N, 0);
+
+	BuildRange(0, N);
+}
+
+//-----------------------------------------------------------------------------
+void KDTree::BuildRange(int i0, int i1)
+{
+	if (i1 - i0 <= KDTREE_LEAF_SIZE) return;
+
+	// find the extent of this range
+	vec3d rmin = m_pt[i0].r, rmax = m_pt[i0].r;
+	for (int i = i0 + 1; i < i1; ++i)
+	{
+		const vec3d& r = m_pt[i].r;
+		if (r.x < rmin.x) rmin.x = r.x; if (r.x > rmax.x) rmax.x = r.x;
+		if (r.y < rmin.y) rmin.y = r.y; if (r.y > rmax.y) rmax.y = r.y;
+		if (r.z < rmin.z) rmin.z = r.z; if (r.z > rmax.z) rmax.z = r.z;
+	}
+
+	// split along the largest extent
+	vec3d d = rmax - rmin;
+	int axis = 0;
+	if (d.y > d.x) axis = 1;
+	if ((d.z > d.x) && (d.z > d.y)) axis = 2;
+
+	int m = (i0 + i1) / 2;
+	nth_element(m_pt.begin() + i0, m_pt.begin() + m, m_pt.begin() + i1, [=](const POINT& a, const POINT& b) {
+		return kd_coord(a.r, axis) < kd_coord(b.r, axis);
+	});
+	m_axis[m] = (char)axis;
+
+	BuildRange(i0, m);
+	BuildRange(m + 1, i1);
+}
+
+//-----------------------------------------------------------------------------
+int KDTree::FindNearest(const vec3d& x, double* pd2) const
+{
+	int imin = -1;
+	double d2min = 1e99;
+	if (m_pt.empty() == false)
+	{
+		SearchRange(0, (int)m_pt.size(), x, imin, d2min);
+	}
+	if (pd2) *pd2 = d2min;
+	return (imin >= 0 ? m_pt[imin].index : -1);
+}
+
+//-----------------------------------------------------------------------------
+void KDTree::SearchRange(int i0, int i1, const vec3d& x, int& imin, double& d2min) const
+{
+	if (i1 - i0 <= KDTREE_LEAF_SIZE)
+	{
+		for (int i = i0; i < i1; ++i)
+		{
+			vec3d e = m_pt[i].r - x;
+			double d2 = e*e;
+			if (d2 < d2min) { d2min = d2; imin = i; }
+		}
+		return;
+	}
+
+	// check the median
+	int m = (i0 + i1) / 2;
+	vec3d e = m_pt[m].r - x;
+	double d2 = e*e;
+	if (d2 < d2min) { d2min = d2; imin = m; }
+
+	// search the side that contains the point first
+	int axis = m_axis[m];
+	double dx = kd_coord(x, axis) - kd_coord(m_pt[m].r, axis);
+	if (dx < 0)
+	{
+		SearchRange(i0, m, x, imin, d2min);
+		if (dx*dx < d2min) SearchRange(m + 1, i1, x, imin, d2min);
+	}
+	else
+	{
+		SearchRange(m + 1, i1, x, imin, d2min);
+		if (dx*dx < d2min) SearchRange(i0, m, x, imin, d2min);
+	}
+}
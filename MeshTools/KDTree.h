@@ -0,0 +1,65 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/math3d.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Balanced k-d tree for nearest neighbor queries on a static point set. 
+// The tree is stored implicitly: each range of points is split at its median 
+// along its largest extent. Queries don't modify the tree, so they can be
+// run concurrently.
+class KDTree
+{
+	struct POINT
+	{
+		vec3d	r;		// position
+		int		index;	// index in the original point set
+	};
+
+public:
+	KDTree();
+
+	// build the tree for a point set
+	void Build(const std::vector<vec3d>& points);
+
+	void Clear();
+
+	int Points() const { return (int)m_pt.size(); }
+
+	// find the index of the point closest to x (or -1 if the tree is empty).
+	// If pd2 is not null, it returns the squared distance to that point.
+	int FindNearest(const vec3d& x, double* pd2 = nullptr) const;
+
+private:
+	void BuildRange(int i0, int i1);
+	void SearchRange(int i0, int i1, const vec3d& x, int& imin, double& d2min) const;
+
+private:
+	std::vector<POINT>	m_pt;	// points, ordered by the tree
+	std::vector<char>	m_axis;	// split axis of the range whose median is at this point
+};
@@ -36,8 +36,10 @@ LaplaceSolver::LaplaceSolver()
 	m_maxIters = 1000;
 	m_tol = 1e-4;
 	m_w = 1.0;
+	m_method = RELAXATION;
 
 	m_niters = 0;
+	m_relNorm = 0.0;
 }
 
 void LaplaceSolver::SetMaxIterations(int n)
@@ -55,6 +57,11 @@ void LaplaceSolver::SetRelaxation(double w)
 	m_w = w;
 }
 
+void LaplaceSolver::SetSolverMethod(int n)
+{
+	m_method = n;
+}
+
 int LaplaceSolver::GetIterationCount() const
 {
 	return m_niters;
@@ -169,6 +176,7 @@ bool LaplaceSolver::Solve(FSMesh* pm, vector<double>& val, vector<int>& bn, int
 	vector<double> D(NN, 0.0);
 
 	// build the diagonal terms
+#pragma omp parallel for schedule(dynamic, 1024)
 	for (int i=0; i<NN; ++i)
 	{
 		if (bn[i] == 0)
@@ -202,6 +210,7 @@ bool LaplaceSolver::Solve(FSMesh* pm, vector<double>& val, vector<int>& bn, int
 	}
 
 	// build the edge weights
+#pragma omp parallel for schedule(dynamic, 1024)
 	for (int i=0; i<NN; ++i)
 	{
 		int nval = NNL.Valence(i);
@@ -248,6 +257,18 @@ bool LaplaceSolver::Solve(FSMesh* pm, vector<double>& val, vector<int>& bn, int
 		}
 	}
 
+	if (m_method == RELAXATION)
+		return SolveRelaxation(NNL, D, val, bn);
+	else
+		return SolveCG(NNL, D, val, bn);
+}
+
+//-----------------------------------------------------------------------------
+// Solve the equations with successive over-relaxation
+bool LaplaceSolver::SolveRelaxation(FSNodeNodeList& NNL, const vector<double>& D, vector<double>& val, const vector<int>& bn)
+{
+	int NN = (int)val.size();
+
 	// inverted diagonal values
 	vector<double> Dinv(NN);
 	for (int i=0; i<NN; ++i) Dinv[i] = 1.0 / D[i];
@@ -287,3 +308,256 @@ bool LaplaceSolver::Solve(FSMesh* pm, vector<double>& val, vector<int>& bn, int
 
 	return (m_relNorm < m_tol);
 }
+
+//-----------------------------------------------------------------------------
+// Sparse symmetric matrix in compressed row format. Each row stores all its 
+// nonzeros (not just one triangle), sorted by column.
+class LaplaceMatrix
+{
+public:
+	int Rows() const { return (int)m_off.size() - 1; }
+
+	// y = A*x
+	void Mult(const vector<double>& x, vector<double>& y) const
+	{
+		int N = Rows();
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < N; ++i)
+		{
+			double yi = 0.0;
+			for (int k = m_off[i]; k < m_off[i + 1]; ++k) yi += m_val[k] * x[m_col[k]];
+			y[i] = yi;
+		}
+	}
+
+public:
+	vector<int>		m_off;	// row offsets
+	vector<int>		m_col;	// column indices
+	vector<double>	m_val;	// matrix values
+	vector<double>	m_diag;	// diagonal values
+};
+
+//-----------------------------------------------------------------------------
+// Incomplete Cholesky factorization with zero fill-in, i.e. A ~ L*L^T where L
+// has the same sparsity as the lower triangle of A.
+class IC0Preconditioner
+{
+public:
+	// returns false if the factorization breaks down
+	bool Create(const LaplaceMatrix& A)
+	{
+		int N = A.Rows();
+		m_off.assign(N + 1, 0);
+		m_col.clear();
+		for (int i = 0; i < N; ++i)
+		{
+			for (int k = A.m_off[i]; k < A.m_off[i + 1]; ++k)
+			{
+				if (A.m_col[k] <= i) m_col.push_back(A.m_col[k]);
+			}
+			m_off[i + 1] = (int)m_col.size();
+		}
+		m_val.assign(m_col.size(), 0.0);
+
+		for (int i = 0; i < N; ++i)
+		{
+			int k0 = m_off[i], k1 = m_off[i + 1];
+			for (int k = k0, l = A.m_off[i]; k < k1; ++k, ++l)
+			{
+				// (the row of L is the lower part of the row of A, so it is at the start of A's row)
+				int j = m_col[k];
+				double s = A.m_val[l];
+
+				// subtract the dot product of rows i and j of L (excluding column j)
+				int a = k0, b = m_off[j];
+				int b1 = m_off[j + 1] - 1;
+				while ((a < k) && (b < b1))
+				{
+					if      (m_col[a] < m_col[b]) a++;
+					else if (m_col[a] > m_col[b]) b++;
+					else s -= m_val[a++] * m_val[b++];
+				}
+
+				if (j < i) m_val[k] = s / m_val[b1];
+				else
+				{
+					if (s <= 0.0) return false;
+					m_val[k] = sqrt(s);
+				}
+			}
+		}
+		return true;
+	}
+
+	// z = (L*L^T)^-1 r
+	void Apply(const vector<double>& r, vector<double>& z) const
+	{
+		int N = (int)m_off.size() - 1;
+
+		// forward substitution
+		for (int i = 0; i < N; ++i)
+		{
+			double s = r[i];
+			int k1 = m_off[i + 1] - 1;
+			for (int k = m_off[i]; k < k1; ++k) s -= m_val[k] * z[m_col[k]];
+			z[i] = s / m_val[k1];
+		}
+
+		// backward substitution
+		for (int i = N - 1; i >= 0; --i)
+		{
+			int k1 = m_off[i + 1] - 1;
+			z[i] /= m_val[k1];
+			double zi = z[i];
+			for (int k = m_off[i]; k < k1; ++k) z[m_col[k]] -= m_val[k] * zi;
+		}
+	}
+
+private:
+	vector<int>		m_off;
+	vector<int>		m_col;
+	vector<double>	m_val;
+};
+
+//-----------------------------------------------------------------------------
+static double dot(const vector<double>& a, const vector<double>& b)
+{
+	int N = (int)a.size();
+	double s = 0.0;
+#pragma omp parallel for reduction(+:s)
+	for (int i = 0; i < N; ++i) s += a[i] * b[i];
+	return s;
+}
+
+//-----------------------------------------------------------------------------
+// Solve the equations with a preconditioned conjugate gradient method. The 
+// equations of the free nodes are assembled into a sparse matrix first.
+bool LaplaceSolver::SolveCG(FSNodeNodeList& NNL, const vector<double>& D, vector<double>& val, const vector<int>& bn)
+{
+	int NN = (int)val.size();
+
+	// number the equations
+	vector<int> eq(NN, -1);
+	int neq = 0;
+	for (int i = 0; i < NN; ++i)
+		if (bn[i] == 0) eq[i] = neq++;
+
+	m_relNorm = 0.0;
+	if (neq == 0) return true;
+
+	// assemble the matrix and right-hand side
+	LaplaceMatrix A;
+	A.m_off.assign(neq + 1, 0);
+	for (int i = 0; i < NN; ++i)
+	{
+		if (eq[i] >= 0)
+		{
+			int nval = NNL.Valence(i);
+			int n = 1;
+			for (int j = 0; j < nval; ++j) if (eq[NNL.Node(i, j)] >= 0) n++;
+			A.m_off[eq[i] + 1] = n;
+		}
+	}
+	for (int i = 0; i < neq; ++i) A.m_off[i + 1] += A.m_off[i];
+	A.m_col.resize(A.m_off[neq]);
+	A.m_val.resize(A.m_off[neq]);
+	A.m_diag.resize(neq);
+
+	vector<double> x(neq), b(neq);
+#pragma omp parallel for schedule(dynamic, 1024)
+	for (int i = 0; i < NN; ++i)
+	{
+		int r = eq[i];
+		if (r < 0) continue;
+
+		int* col = &A.m_col[A.m_off[r]];
+		double* v = &A.m_val[A.m_off[r]];
+		int n = 0;
+		col[n] = r; v[n++] = D[i];
+
+		double br = 0.0;
+		int nval = NNL.Valence(i);
+		for (int j = 0; j < nval; ++j)
+		{
+			int nj = NNL.Node(i, j);
+			if (eq[nj] >= 0) { col[n] = eq[nj]; v[n++] = NNL.Value(i, j); }
+			else if (bn[nj] == 1) br -= NNL.Value(i, j) * val[nj];
+		}
+
+		// sort the row by column
+		for (int j = 1; j < n; ++j)
+		{
+			int cj = col[j]; double vj = v[j];
+			int k = j - 1;
+			for (; (k >= 0) && (col[k] > cj); --k) { col[k + 1] = col[k]; v[k + 1] = v[k]; }
+			col[k + 1] = cj; v[k + 1] = vj;
+		}
+
+		A.m_diag[r] = D[i];
+		b[r] = br;
+		x[r] = val[i];
+	}
+
+	// set up the preconditioner
+	IC0Preconditioner IC;
+	bool bic = false;
+	if (m_method == IC0_PCG)
+	{
+		bic = IC.Create(A);
+		if (bic == false) printf("Incomplete Cholesky factorization failed. Using Jacobi preconditioner instead.\n");
+	}
+
+	vector<double> r(neq), z(neq), p(neq), q(neq);
+	auto precondition = [&]() {
+		if (bic) IC.Apply(r, z);
+		else
+		{
+#pragma omp parallel for schedule(static)
+			for (int i = 0; i < neq; ++i) z[i] = r[i] / A.m_diag[i];
+		}
+	};
+
+	// initial residual
+	A.Mult(x, q);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < neq; ++i) r[i] = b[i] - q[i];
+
+	double norm0 = sqrt(dot(r, r));
+	if (norm0 == 0.0) return true;
+
+	precondition();
+	p = z;
+	double rz = dot(r, z);
+
+	m_relNorm = 1.0;
+	while ((m_niters < m_maxIters) && (m_relNorm > m_tol))
+	{
+		A.Mult(p, q);
+		double alpha = rz / dot(p, q);
+
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < neq; ++i)
+		{
+			x[i] += alpha * p[i];
+			r[i] -= alpha * q[i];
+		}
+
+		m_relNorm = sqrt(dot(r, r)) / norm0;
+		m_niters++;
+		if (m_relNorm <= m_tol) break;
+
+		precondition();
+		double rz_new = dot(r, z);
+		double beta = rz_new / rz;
+		rz = rz_new;
+
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < neq; ++i) p[i] = z[i] + beta * p[i];
+	}
+
+	// copy the solution
+	for (int i = 0; i < NN; ++i)
+		if (eq[i] >= 0) val[i] = x[eq[i]];
+
+	return (m_relNorm < m_tol);
+}
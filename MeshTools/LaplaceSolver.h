@@ -31,17 +31,27 @@ SOFTWARE.*/
 using std::vector;
 
 class FSMesh;
+class FSNodeNodeList;
 
 //-----------------------------------------------------------------------------
 //! This class solves the Laplace equation using an iterative method
 class LaplaceSolver
 {
+public:
+	// methods for solving the discretized equations
+	enum SolverMethod {
+		RELAXATION,		// successive over-relaxation
+		JACOBI_PCG,		// conjugate gradient with Jacobi preconditioner
+		IC0_PCG			// conjugate gradient with incomplete Cholesky preconditioner
+	};
+
 public:
 	LaplaceSolver();
 
 	void SetMaxIterations(int n);
 	void SetTolerance(double a);
 	void SetRelaxation(double w);
+	void SetSolverMethod(int n);
 
 	// Solves the Laplace equation on the mesh.
 	// Input: val = initial values for all nodes
@@ -53,11 +63,16 @@ public: // output
 	int GetIterationCount() const;
 	double GetRelativeNorm() const;
 
+private:
+	bool SolveRelaxation(FSNodeNodeList& NNL, const vector<double>& D, vector<double>& val, const vector<int>& bn);
+	bool SolveCG(FSNodeNodeList& NNL, const vector<double>& D, vector<double>& val, const vector<int>& bn);
+
 private:
 	// input parameters
 	int		m_maxIters;	//!< max nr of iterations
 	double	m_tol;	//!< convergence tolerance
 	double	m_w;	//!< relaxation parameter
+	int		m_method;	//!< solver method (see SolverMethod)
 
 	// output variables
 	int		m_niters;		//!< nr of iterations
@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "TetOverlap.h"
 #include <MeshLib/FEMesh.h>
+#include <algorithm>
 using namespace std;
 
 struct TET
@@ -75,33 +76,64 @@ bool TetOverlap::Apply(FSMesh* mesh, std::vector<pair<int, int> >& tetList)
 		tet[i] = t;
 	}
 
+	// calculate the tet boxes
+	vector<BOX> box(NE);
+	for (int i = 0; i < NE; ++i)
+	{
+		TET& a = tet[i];
+
+		BOX& b = box[i];
+		for (int k = 0; k < 4; ++k) b += a.r[k];
+		double R = b.GetMaxExtent();
+		b.Inflate(R*0.001);
+	}
+
+	// Broad phase: sort the boxes along x and sweep, so that we only 
+	// consider pairs whose boxes overlap along x.
+	vector<int> order(NE);
+	for (int i = 0; i < NE; ++i) order[i] = i;
+	sort(order.begin(), order.end(), [&](int a, int b) { return box[a].x0 < box[b].x0; });
+
 	// the list that will store the overlapping pairs
 	tetList.clear();
 	tetList.reserve(NE / 2);
 
-	for (int i = 0; i < NE; ++i)
+#pragma omp parallel
 	{
-		TET& a = tet[i];
+		vector<pair<int, int> > localList;
 
-		BOX box;
-		for (int k = 0; k < 4; ++k) box += a.r[k];
-		double R = box.GetMaxExtent();
-		box.Inflate(R*0.001);
-
-		for (int j = i+1; j < NE; ++j)
+#pragma omp for schedule(dynamic, 1024)
+		for (int k = 0; k < NE; ++k)
 		{
-			TET& b = tet[j];
-			if (box_test(box, b) == false)
+			int n0 = order[k];
+			const BOX& b0 = box[n0];
+			for (int l = k + 1; (l < NE) && (box[order[l]].x0 <= b0.x1); ++l)
 			{
-				if (tet_overlap(a, b))
+				int n1 = order[l];
+				const BOX& b1 = box[n1];
+				if ((b1.y0 > b0.y1) || (b1.y1 < b0.y0)) continue;
+				if ((b1.z0 > b0.z1) || (b1.z1 < b0.z0)) continue;
+
+				// do the exact test in the original order
+				int i = (n0 < n1 ? n0 : n1);
+				int j = (n0 < n1 ? n1 : n0);
+				if (box_test(box[i], tet[j]) == false)
 				{
-					pair<int, int> tetPair(i, j);
-					tetList.push_back(tetPair);
+					if (tet_overlap(tet[i], tet[j]))
+					{
+						localList.push_back(pair<int, int>(i, j));
+					}
 				}
 			}
 		}
+
+#pragma omp critical (tet_overlap)
+		tetList.insert(tetList.end(), localList.begin(), localList.end());
 	}
 
+	// make sure the list does not depend on the thread scheduling
+	sort(tetList.begin(), tetList.end());
+
 	return true;
 }
 
@@ -187,8 +187,9 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	if (n0 != n1) UpdateState(n1, breset);
 
 	// get the state
-	FEState& s0 = *pfem->GetState(n0);
-	FEState& s1 = *pfem->GetState(n1);
+	FEStateLock lock0(*pfem, n0), lock1(*pfem, n1);
+	FEState& s0 = *lock0;
+	FEState& s1 = *lock1;
 
 	float df = s1.m_time - s0.m_time;
 	if (df == 0) df = 1.f;
@@ -210,8 +211,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 			for (int i = 0; i < NE; ++i)
 			{
 				FEElement_& el = pm->ElementRef(i);
-				ELEMDATA& d0 = s0.m_ELEM[i];
-				ELEMDATA& d1 = s1.m_ELEM[i];
+				ElemDataRef d0 = s0.m_ELEM[i];
+				ElemDataRef d1 = s1.m_ELEM[i];
 				if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
 				{
 					vec3d r = pm->ElementCenter(el);
@@ -231,8 +232,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 			for (int i = 0; i < NE; ++i)
 			{
 				FEElement_& el = pm->ElementRef(i);
-				ELEMDATA& d0 = s0.m_ELEM[i];
-				ELEMDATA& d1 = s1.m_ELEM[i];
+				ElemDataRef d0 = s0.m_ELEM[i];
+				ElemDataRef d1 = s1.m_ELEM[i];
 				if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
 				{
 					for (int j = 0; j < el.Nodes(); ++j)
@@ -253,8 +254,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		for (int i = 0; i<pm->Nodes(); ++i)
 		{
 			FSNode& node = pm->Node(i);
-			NODEDATA& d0 = s0.m_NODE[i];
-			NODEDATA& d1 = s1.m_NODE[i];
+			NodeDataRef d0 = s0.m_NODE[i];
+			NodeDataRef d1 = s1.m_NODE[i];
 			if ((node.IsEnabled()) && (d0.m_ntag > 0) && (d1.m_ntag > 0))
 			{
 				float f0 = d0.m_val;
@@ -277,8 +278,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 				{
 					int nj = face.n[j];
 					FSNode& node = pm->Node(nj);
-					NODEDATA& d0 = s0.m_NODE[nj];
-					NODEDATA& d1 = s1.m_NODE[nj];
+					NodeDataRef d0 = s0.m_NODE[nj];
+					NodeDataRef d1 = s1.m_NODE[nj];
 					if ((node.IsEnabled()) && (d0.m_ntag > 0) && (d1.m_ntag > 0))
 					{
 						float f0 = d0.m_val;
@@ -298,8 +299,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 			{
 				int nj = (j == 0 ? de.n0 : de.n1);
 				FSNode& node = pm->Node(nj);
-				NODEDATA& d0 = s0.m_NODE[nj];
-				NODEDATA& d1 = s1.m_NODE[nj];
+				NodeDataRef d0 = s0.m_NODE[nj];
+				NodeDataRef d1 = s1.m_NODE[nj];
 				if ((node.IsEnabled()) && (d0.m_ntag > 0) && (d1.m_ntag > 0))
 				{
 					float f0 = d0.m_val;
@@ -345,8 +346,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 			int ni = de.elem;
 			if (ni >= 0)
 			{
-				ELEMDATA& d0 = s0.m_ELEM[ni];
-				ELEMDATA& d1 = s1.m_ELEM[ni];
+				ElemDataRef d0 = s0.m_ELEM[ni];
+				ElemDataRef d1 = s1.m_ELEM[ni];
 				if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
 				{
 					float f0 = d0.m_val;
@@ -443,8 +444,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	for (int i = 0; i<pm->Elements(); ++i)
 	{
 		FEElement_& el = pm->ElementRef(i);
-		ELEMDATA& d0 = s0.m_ELEM[i];
-		ELEMDATA& d1 = s1.m_ELEM[i];
+		ElemDataRef d0 = s0.m_ELEM[i];
+		ElemDataRef d1 = s1.m_ELEM[i];
 		if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
 		{
 			float f0 = d0.m_val;
@@ -487,8 +488,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 					face.Activate();
 					int iel = face.m_elem[0].eid;
 
-					ELEMDATA& d0 = s0.m_ELEM[iel];
-					ELEMDATA& d1 = s1.m_ELEM[iel];
+					ElemDataRef d0 = s0.m_ELEM[iel];
+					ElemDataRef d1 = s1.m_ELEM[iel];
 
 					if (((d0.m_state & StatusFlags::ACTIVE) == 0) || ((d1.m_state & StatusFlags::ACTIVE) == 0)) face.Deactivate();
 					else
@@ -504,8 +505,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 						int nf = face.Nodes();
 						for (int k = 0; k < nf; ++k)
 						{
-							NODEDATA& d0 = s0.m_NODE[face.n[k]];
-							NODEDATA& d1 = s1.m_NODE[face.n[k]];
+							NodeDataRef d0 = s0.m_NODE[face.n[k]];
+							NodeDataRef d1 = s1.m_NODE[face.n[k]];
 
 							float v0 = d0.m_val;
 							float v1 = d1.m_val;
@@ -134,8 +134,9 @@ void CGLDisplacementMap::Update(int ntime, float dt, bool breset)
 	}
 	else
 	{
-		FEState& s1 = *pfem->GetState(n0);
-		FEState& s2 = *pfem->GetState(n1);
+		FEStateLock lock1(*pfem, n0), lock2(*pfem, n1);
+		FEState& s1 = *lock1;
+		FEState& s2 = *lock2;
 
 		// get the reference state
 		Post::FERefState& ref = *s2.m_ref;
@@ -0,0 +1,277 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "GLGlyphBuilder.h"
+#include <GLLib/GLMesh.h>
+#include <math.h>
+using namespace Post;
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Vertex positions and normals of a unit primitive, as a triangle (or line) list
+struct GlyphTemplate
+{
+	std::vector<vec3f>	r;
+	std::vector<vec3f>	n;
+
+	void add(const vec3f& ri, const vec3f& ni) { r.push_back(ri); n.push_back(ni); }
+};
+
+//-----------------------------------------------------------------------------
+// side of a cylinder (top = 1) or cone (top = 0), as gluCylinder with one stack
+void buildCylinder(GlyphTemplate& t, int slices, float top)
+{
+	const float pi = 3.14159265358979f;
+	float nz = 1.f - top;
+	float nl = sqrtf(1.f + nz*nz);
+	for (int i = 0; i < slices; ++i)
+	{
+		float w0 = 2.f*pi*i / slices;
+		float w1 = 2.f*pi*(i + 1) / slices;
+		vec3f d0(cosf(w0), sinf(w0), 0.f);
+		vec3f d1(cosf(w1), sinf(w1), 0.f);
+		vec3f n0(d0.x / nl, d0.y / nl, nz / nl);
+		vec3f n1(d1.x / nl, d1.y / nl, nz / nl);
+
+		vec3f a0 = d0, a1 = d1;
+		vec3f b0(d0.x*top, d0.y*top, 1.f);
+		vec3f b1(d1.x*top, d1.y*top, 1.f);
+
+		t.add(a0, n0); t.add(a1, n1); t.add(b1, n1);
+		if (top != 0.f)
+		{
+			t.add(a0, n0); t.add(b1, n1); t.add(b0, n0);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void buildSphere(GlyphTemplate& t, int slices, int stacks)
+{
+	const float pi = 3.14159265358979f;
+	for (int j = 0; j < stacks; ++j)
+	{
+		float p0 = pi*j / stacks;
+		float p1 = pi*(j + 1) / stacks;
+		for (int i = 0; i < slices; ++i)
+		{
+			float w0 = 2.f*pi*i / slices;
+			float w1 = 2.f*pi*(i + 1) / slices;
+			vec3f a0(sinf(p0)*cosf(w0), sinf(p0)*sinf(w0), cosf(p0));
+			vec3f a1(sinf(p0)*cosf(w1), sinf(p0)*sinf(w1), cosf(p0));
+			vec3f b0(sinf(p1)*cosf(w0), sinf(p1)*sinf(w0), cosf(p1));
+			vec3f b1(sinf(p1)*cosf(w1), sinf(p1)*sinf(w1), cosf(p1));
+
+			// the triangles at the poles collapse, so leave them out
+			if (j != 0) { t.add(a0, a0); t.add(b0, b0); t.add(a1, a1); }
+			if (j != stacks - 1) { t.add(a1, a1); t.add(b0, b0); t.add(b1, b1); }
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void buildBox(GlyphTemplate& t)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		for (int s = -1; s <= 1; s += 2)
+		{
+			// face normal along axis k with sign s, spanned by the other two axes
+			float n[3] = { 0.f, 0.f, 0.f }; n[k] = (float)s;
+			float u[3] = { 0.f, 0.f, 0.f }; u[(k + 1) % 3] = 1.f;
+			float v[3] = { 0.f, 0.f, 0.f }; v[(k + 2) % 3] = (float)s;
+			vec3f N(n[0], n[1], n[2]), U(u[0], u[1], u[2]), V(v[0], v[1], v[2]);
+
+			vec3f c[4] = { N - U - V, N + U - V, N + U + V, N - U + V };
+			t.add(c[0], N); t.add(c[1], N); t.add(c[2], N);
+			t.add(c[0], N); t.add(c[2], N); t.add(c[3], N);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+const GlyphTemplate& glyphTemplate(int prim)
+{
+	static const std::vector<GlyphTemplate> tmp = []() {
+		std::vector<GlyphTemplate> t(GLGlyphBuilder::MAX_PRIMITIVES);
+		buildCylinder(t[GLGlyphBuilder::SHAFT], 5, 1.f);
+		buildCylinder(t[GLGlyphBuilder::CYLINDER], 10, 1.f);
+		buildCylinder(t[GLGlyphBuilder::CONE], 10, 0.f);
+		buildSphere(t[GLGlyphBuilder::SPHERE], 10, 5);
+		buildSphere(t[GLGlyphBuilder::ELLIPSOID], 16, 16);
+		buildBox(t[GLGlyphBuilder::BOX]);
+		t[GLGlyphBuilder::LINE].add(vec3f(0.f, 0.f, 0.f), vec3f(0.f, 0.f, 1.f));
+		t[GLGlyphBuilder::LINE].add(vec3f(0.f, 0.f, 1.f), vec3f(0.f, 0.f, 1.f));
+		return t;
+	}();
+	return tmp[prim];
+}
+
+}
+
+//-----------------------------------------------------------------------------
+GLGlyphBuilder::GLGlyphBuilder()
+{
+	m_triVerts = 0;
+	m_lineVerts = 0;
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::Clear()
+{
+	m_glyph.clear();
+	m_triVerts = 0;
+	m_lineVerts = 0;
+}
+
+//-----------------------------------------------------------------------------
+int GLGlyphBuilder::PrimitiveVertices(int prim)
+{
+	return (int)glyphTemplate(prim).r.size();
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::Frame(const vec3f& t, vec3f& ex, vec3f& ey)
+{
+	// pick the coordinate axis that is the least aligned with t
+	vec3f a = (fabs(t.x) < 0.9f ? vec3f(1.f, 0.f, 0.f) : vec3f(0.f, 1.f, 0.f));
+	ey = t ^ a; ey.Normalize();
+	ex = ey ^ t;
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::AddGlyph(int prim, const vec3f& r, const vec3f& ax, const vec3f& ay, const vec3f& az, const GLColor& c)
+{
+	Glyph g;
+	g.prim = prim;
+	g.r = r;
+	g.a[0] = ax;
+	g.a[1] = ay;
+	g.a[2] = az;
+	g.c = c;
+	m_glyph.push_back(g);
+
+	if (IsLine(prim)) m_lineVerts += PrimitiveVertices(prim);
+	else m_triVerts += PrimitiveVertices(prim);
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::AddGlyph(int prim, const vec3f& r, const vec3f& t, float sxy, float sz, const GLColor& c)
+{
+	vec3f ex, ey;
+	Frame(t, ex, ey);
+	AddGlyph(prim, r, ex*sxy, ey*sxy, t*sz, c);
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::BuildTriangles(float* vr, float* vn, unsigned char* vc) const
+{
+	Build(false, vr, vn, vc);
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::BuildLines(float* vr, unsigned char* vc) const
+{
+	Build(true, vr, nullptr, vc);
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::BuildMesh(GLTriMesh& triMesh, GLLineMesh& lineMesh) const
+{
+	triMesh.Create(m_triVerts / 3, GLMesh::FLAG_NORMAL | GLMesh::FLAG_COLOR);
+	triMesh.BeginMesh();
+	BuildTriangles(triMesh.VertexBuffer(), triMesh.NormalBuffer(), triMesh.ColorBuffer());
+	triMesh.SetVertexCount(m_triVerts);
+	triMesh.EndMesh();
+
+	lineMesh.Create((int)(m_lineVerts / 2), GLMesh::FLAG_COLOR);
+	lineMesh.BeginMesh();
+	BuildLines(lineMesh.VertexBuffer(), lineMesh.ColorBuffer());
+	lineMesh.SetVertexCount(m_lineVerts);
+	lineMesh.EndMesh();
+}
+
+//-----------------------------------------------------------------------------
+void GLGlyphBuilder::Build(bool lines, float* vr, float* vn, unsigned char* vc) const
+{
+	// find the offset of each glyph in the output arrays
+	int N = (int)m_glyph.size();
+	std::vector<size_t> off(N + 1, 0);
+	for (int i = 0; i < N; ++i)
+	{
+		int prim = m_glyph[i].prim;
+		off[i + 1] = off[i] + (IsLine(prim) == lines ? PrimitiveVertices(prim) : 0);
+	}
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < N; ++i)
+	{
+		const Glyph& g = m_glyph[i];
+		if (IsLine(g.prim) != lines) continue;
+
+		const GlyphTemplate& t = glyphTemplate(g.prim);
+		const vec3f& a = g.a[0];
+		const vec3f& b = g.a[1];
+		const vec3f& c = g.a[2];
+
+		// normals map with the cofactor matrix (the inverse transpose up to a scale)
+		// A mirroring map also flips the normals and the triangle orientation.
+		vec3f ca[3] = { b ^ c, c ^ a, a ^ b };
+		bool mirror = ((a*ca[0]) < 0.f);
+		if (mirror) { ca[0] = -ca[0]; ca[1] = -ca[1]; ca[2] = -ca[2]; }
+
+		size_t n0 = off[i];
+		int nv = (int)t.r.size();
+		for (int j = 0; j < nv; ++j)
+		{
+			// output slot of this vertex (swaps the last two vertices of mirrored triangles)
+			int k = j;
+			if (mirror && !lines) k = (j % 3 == 0 ? j : (j % 3 == 1 ? j + 1 : j - 1));
+
+			const vec3f& p = t.r[j];
+			vec3f r = g.r + a*p.x + b*p.y + c*p.z;
+			float* pr = vr + 3 * (n0 + k);
+			pr[0] = r.x; pr[1] = r.y; pr[2] = r.z;
+
+			if (vn)
+			{
+				const vec3f& q = t.n[j];
+				vec3f n = ca[0] * q.x + ca[1] * q.y + ca[2] * q.z;
+				n.Normalize();
+				float* pn = vn + 3 * (n0 + k);
+				pn[0] = n.x; pn[1] = n.y; pn[2] = n.z;
+			}
+
+			if (vc)
+			{
+				unsigned char* pc = vc + 4 * (n0 + k);
+				pc[0] = g.c.r; pc[1] = g.c.g; pc[2] = g.c.b; pc[3] = g.c.a;
+			}
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <FSCore/math3d.h>
+#include <FSCore/color.h>
+#include <vector>
+
+class GLTriMesh;
+class GLLineMesh;
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// Builds the geometry of a set of glyphs into flat vertex arrays. Each glyph is
+// a unit primitive that is placed by an affine map (position and three axes).
+// The geometry is generated in parallel and this class makes no OpenGL calls, 
+// so the same buffers can be used by any of the GLMesh classes.
+class GLGlyphBuilder
+{
+public:
+	// unit primitives. The round shapes are centered on the z-axis.
+	enum Primitive {
+		SHAFT,		// open cylinder, radius 1, z = [0,1], 5 slices
+		CYLINDER,	// open cylinder, radius 1, z = [0,1], 10 slices
+		CONE,		// open cone, base radius 1, z = [0,1], 10 slices
+		SPHERE,		// sphere of radius 1, 10 slices, 5 stacks
+		ELLIPSOID,	// sphere of radius 1, 16 slices, 16 stacks
+		BOX,		// box [-1,1]^3
+		LINE,		// line from (0,0,0) to (0,0,1)
+		MAX_PRIMITIVES
+	};
+
+	struct Glyph
+	{
+		int		prim;	// primitive type
+		vec3f	r;		// position
+		vec3f	a[3];	// images of the local x, y, z axes
+		GLColor	c;		// color
+	};
+
+public:
+	GLGlyphBuilder();
+
+	// remove all glyphs
+	void Clear();
+
+	// add a glyph
+	void AddGlyph(int prim, const vec3f& r, const vec3f& ax, const vec3f& ay, const vec3f& az, const GLColor& c);
+
+	// add a glyph with its z-axis along the (unit) vector t
+	void AddGlyph(int prim, const vec3f& r, const vec3f& t, float sxy, float sz, const GLColor& c);
+
+	int Glyphs() const { return (int)m_glyph.size(); }
+
+	// number of vertices of the triangle and line geometry
+	size_t TriangleVertices() const { return m_triVerts; }
+	size_t LineVertices() const { return m_lineVerts; }
+
+	// write the triangles. vr and vn must hold 3*TriangleVertices() floats and 
+	// vc 4*TriangleVertices() bytes. vn and vc can be null.
+	void BuildTriangles(float* vr, float* vn, unsigned char* vc) const;
+
+	// write the lines. vr must hold 3*LineVertices() floats and vc 4*LineVertices() bytes.
+	void BuildLines(float* vr, unsigned char* vc) const;
+
+	// write the triangles and lines into the meshes
+	void BuildMesh(GLTriMesh& triMesh, GLLineMesh& lineMesh) const;
+
+public:
+	// return two unit vectors that complete a right-handed frame with the unit vector t
+	static void Frame(const vec3f& t, vec3f& ex, vec3f& ey);
+
+	// number of vertices of a primitive
+	static int PrimitiveVertices(int prim);
+
+	// returns true for the primitives that are rendered as lines
+	static bool IsLine(int prim) { return (prim == LINE); }
+
+private:
+	void Build(bool lines, float* vr, float* vn, unsigned char* vc) const;
+
+private:
+	std::vector<Glyph>	m_glyph;
+	size_t	m_triVerts;
+	size_t	m_lineVerts;
+};
+
+}
@@ -203,50 +203,88 @@ void CGLIsoSurfacePlot::UpdateMesh()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Returns the element nodes that are used for the corners of the marching cubes hex
+static const int* iso_corner_nodes(int elemType)
+{
+	static const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	static const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
+	static const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
+	static const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
+
+	switch (elemType)
+	{
+	case FE_HEX8   : return HEX_NT;
+	case FE_HEX20  : return HEX_NT;
+	case FE_HEX27  : return HEX_NT;
+	case FE_PENTA6 : return PEN_NT;
+	case FE_PENTA15: return PEN_NT;
+	case FE_TET4   : return TET_NT;
+	case FE_TET5   : return TET_NT;
+	case FE_PYRA5  : return PYR_NT;
+	case FE_PYRA13 : return PYR_NT;
+	case FE_TET10  : return TET_NT;
+	case FE_TET15  : return TET_NT;
+	}
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Build the span-space index of the element value ranges for the current nodal values.
+void CGLIsoSurfacePlot::UpdateSpanSpace()
+{
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+
+	int NE = pm->Elements();
+	vector<float> vmin(NE, 1.f), vmax(NE, 0.f);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = pm->ElementRef(i);
+		const int* nt = (el.IsSolid() ? iso_corner_nodes(el.Type()) : nullptr);
+		if (nt)
+		{
+			float v0 = m_val[el.m_node[nt[0]]], v1 = v0;
+			for (int k = 1; k < 8; ++k)
+			{
+				float vk = m_val[el.m_node[nt[k]]];
+				if (vk < v0) v0 = vk;
+				if (vk > v1) v1 = vk;
+			}
+			vmin[i] = v0;
+			vmax[i] = v1;
+		}
+	}
+	m_span.Build(vmin, vmax);
+}
+
+//-----------------------------------------------------------------------------
 void CGLIsoSurfacePlot::UpdateSlice(GMesh& mesh, float ref, GLColor col)
 {
 	float ev[8];	// element nodal values
 	vec3f ex[8];	// element nodal positions
 	vec3f en[8];	// element nodal gradients
 
-	const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-	const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
-	const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
-    const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
-
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
 
 	// get the mesh
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
-	const int* nt = nullptr;
+	// find the elements whose value range contains the iso-value
+	m_span.Find(ref, m_cutElems);
 
-	// loop over all elements
-	for (int i=0; i<pm->Elements(); ++i)
+	// loop over these elements
+	for (int n=0; n<(int)m_cutElems.size(); ++n)
 	{
 		// render only if the element is visible and
 		// its material is enabled
+		int i = m_cutElems[n];
 		FEElement_& el = pm->ElementRef(i);
 		Material* pmat = ps->GetMaterial(el.m_MatID);
 		if (pmat->benable && (el.IsVisible() || m_bcut_hidden) && el.IsSolid())
 		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4   : nt = TET_NT; break;
-			case FE_TET5   : nt = TET_NT; break;
-			case FE_PYRA5  : nt = PYR_NT; break;
-			case FE_PYRA13 : nt = PYR_NT; break;
-			case FE_TET10  : nt = TET_NT; break;
-			case FE_TET15  : nt = TET_NT; break;
-			default:
-				assert(false);
-			}
+			const int* nt = iso_corner_nodes(el.Type());
+			assert(nt);
 
 			// get the nodal values
 			for (int k=0; k<8; ++k)
@@ -409,6 +447,9 @@ void CGLIsoSurfacePlot::Update(int ntime, float dt, bool breset)
 	m_val = m_map.State(ntime);
 	if (m_bsmooth) m_grd = m_GMap.State(ntime);
 
+	// update the element index for finding the cut elements
+	UpdateSpanSpace();
+
 	// update colormap range
 	vec2f r = m_rng[ntime];
 
@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "GLPlot.h"
 #include "GLWLib/GLWidget.h"
 #include "PostLib/DataMap.h"
+#include "PostLib/SpanSpace.h"
 #include <MeshLib/GMesh.h>
 #include <GLLib/GLMesh.h>
 
@@ -83,6 +84,7 @@ public:
 protected:
 	void UpdateMesh();
 	void UpdateSlice(GMesh& mesh, float ref, GLColor col);
+	void UpdateSpanSpace();
 
 protected:
 	int		m_nslices;		// nr. of iso surface slices
@@ -106,6 +108,9 @@ protected:
 	vector<float>	m_val;	// current nodal values
 	vector<vec3f>	m_grd;	// current gradient values
 
+	SpanSpace		m_span;		// element value ranges of current nodal values
+	vector<int>		m_cutElems;	// elements that are cut by the current slice
+
 	GLTriMesh	m_glmesh; // the mesh to render
 
 	int		m_lastTime;
@@ -59,6 +59,7 @@ CGLModel::CGLModel(FEPostModel* ps)
 	SetName("Model");
 
 	m_lastMesh = nullptr;
+	m_zsortStamp = 0;
 
 	static int layer = 1;
 	m_layer = layer++;
@@ -142,6 +143,7 @@ void CGLModel::SetFEModel(FEPostModel* ps)
 	ClearSelectionLists();
 	ClearInternalSurfaces();
 	m_ps = ps;
+	m_zsort.clear();
 	if (ps) BuildInternalSurfaces();
 }
 
@@ -228,6 +230,7 @@ bool CGLModel::Update(bool breset)
 
 	// update the state of the mesh
 	GetFSModel()->UpdateMeshState(ntime);
+	m_zsortStamp++;
 
 	// Calling this will rebuild the internal surfaces
 	// This should only be done when the mesh has changed
@@ -261,6 +264,7 @@ bool CGLModel::Update(bool breset)
 //-----------------------------------------------------------------------------
 void CGLModel::UpdateDisplacements(int nstate, bool breset)
 {
+	m_zsortStamp++;
 	if (m_pdis && m_pdis->IsActive()) m_pdis->Update(nstate, 0.f, breset);
 }
 
@@ -1328,32 +1332,7 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 	// render active faces
 	if (zsort)
 	{
-		int NF = dom.Faces();
-		std::map< double, int> zmap;
-		for (int i = 0; i < NF; ++i)
-		{
-			FSFace& face = dom.Face(i);
-			if (face.m_ntag == 1)
-			{
-				// get the face center
-				vec3d r = pm->FaceCenter(face);
-
-				// convert to eye coordinates
-				vec3d q = rc.m_cam->WorldToCam(r);
-
-				// add it to the z-list
-				zmap[q.z] = i;
-			}
-		}
-
-		// build the sorted face list
-		const vector<int>& faceList = dom.FaceList();
-		vector<int> sortedFaceList(zmap.size());
-		auto it = zmap.begin();
-		for (size_t i = 0; i < zmap.size(); ++i, it++) sortedFaceList[i] = faceList[it->second];
-
-		// render the list
-		m_render.RenderFEFaces(pm, sortedFaceList);
+		m_render.RenderFEFaces(pm, DepthSortedFaces(rc, dom, 1));
 	}
 	else
 	{
@@ -1371,32 +1350,7 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 
 		if (zsort)
 		{
-			int NF = dom.Faces();
-			std::map< double, int> zmap;
-			for (int i = 0; i < NF; ++i)
-			{
-				FSFace& face = dom.Face(i);
-				if (face.m_ntag == 2)
-				{
-					// get the face center
-					vec3d r = pm->FaceCenter(face);
-
-					// convert to eye coordinates
-					vec3d q = rc.m_cam->WorldToCam(r);
-
-					// add it to the z-list
-					zmap[q.z] = i;
-				}
-			}
-
-			// build the sorted face list
-			const vector<int>& faceList = dom.FaceList();
-			vector<int> sortedFaceList(zmap.size());
-			auto it = zmap.begin();
-			for (size_t i = 0; i < zmap.size(); ++i, ++it) sortedFaceList[i] = faceList[it->second];
-
-			// render the list
-			m_render.RenderFEFaces(pm, sortedFaceList);
+			m_render.RenderFEFaces(pm, DepthSortedFaces(rc, dom, 2));
 		}
 		else
 		{
@@ -1408,6 +1362,64 @@ void CGLModel::RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, boo
 	}
 }
 
+//-----------------------------------------------------------------------------
+const std::vector<int>& CGLModel::DepthSortedFaces(CGLContext& rc, MeshDomain& dom, int tag)
+{
+	FEPostMesh* pm = GetActiveMesh();
+	CGLCamera& cam = *rc.m_cam;
+
+	// find the cache for this domain
+	int n = 2 * dom.GetMatID() + (tag - 1);
+	if (n >= (int)m_zsort.size()) m_zsort.resize(n + 1);
+	ZSortCache& zc = m_zsort[n];
+
+	// collect the tagged faces
+	int NF = dom.Faces();
+	m_zsortFaces.clear();
+	for (int i = 0; i < NF; ++i)
+	{
+		if (dom.Face(i).m_ntag == tag) m_zsortFaces.push_back(i);
+	}
+
+	// see if we can reuse the last sort
+	vec3d camPos = cam.GetPosition();
+	vec3d camTrg = cam.Target();
+	quatd camRot = cam.GetOrientation();
+	bool sameCam = 
+		(zc.camPos.x == camPos.x) && (zc.camPos.y == camPos.y) && (zc.camPos.z == camPos.z) &&
+		(zc.camTrg.x == camTrg.x) && (zc.camTrg.y == camTrg.y) && (zc.camTrg.z == camTrg.z) &&
+		(zc.camRot.x == camRot.x) && (zc.camRot.y == camRot.y) && (zc.camRot.z == camRot.z) && (zc.camRot.w == camRot.w);
+	if (sameCam && (zc.dom == &dom) && (zc.stamp == m_zsortStamp) && (zc.faces == m_zsortFaces))
+	{
+		return zc.sorted;
+	}
+	zc.dom = &dom;
+	zc.stamp = m_zsortStamp;
+	zc.camPos = camPos;
+	zc.camTrg = camTrg;
+	zc.camRot = camRot;
+	zc.faces.swap(m_zsortFaces);
+
+	// calculate the view depth of the face centers
+	int nf = (int)zc.faces.size();
+	zc.z.resize(nf);
+#pragma omp parallel for
+	for (int i = 0; i < nf; ++i)
+	{
+		FSFace& face = dom.Face(zc.faces[i]);
+		vec3d q = cam.WorldToCam(pm->FaceCenter(face));
+		zc.z[i] = (float)q.z;
+	}
+
+	// sort and build the sorted face list
+	const vector<int>& order = zc.sorter.Sort(zc.z);
+	const vector<int>& faceList = dom.FaceList();
+	zc.sorted.resize(nf);
+	for (int i = 0; i < nf; ++i) zc.sorted[i] = faceList[zc.faces[order[i]]];
+
+	return zc.sorted;
+}
+
 //-----------------------------------------------------------------------------
 void CGLModel::RenderSolidPart(FEPostModel* ps, CGLContext& rc, int mat)
 {
@@ -33,6 +33,7 @@ SOFTWARE.*/
 #include "GLPlotGroup.h"
 #include <FSCore/FSObjectList.h>
 #include <GLLib/GLMeshRender.h>
+#include <GLLib/GLDepthSort.h>
 #include <MeshLib/Intersect.h>
 #include <vector>
 
@@ -232,6 +233,9 @@ protected:
 	void RenderTransparentMaterial(CGLContext& rc, FEPostModel* ps, int m);
 	void RenderSolidDomain(CGLContext& rc, MeshDomain& dom, bool btex, bool benable, bool zsort, bool activeOnly);
 
+	// returns the faces of a domain with the given tag, sorted by view depth
+	const std::vector<int>& DepthSortedFaces(CGLContext& rc, MeshDomain& dom, int tag);
+
 	void RenderInnerSurface(int m, bool btex = true);
 	void RenderInnerSurfaceOutline(int m, int ndivs);
 
@@ -403,6 +407,23 @@ protected:
 
 	Post::FEPostMesh*	m_lastMesh;	// mesh of last evaluated state
 
+	// depth-sorted face list of a domain. The list is only re-sorted when
+	// the camera, the mesh state, or the set of tagged faces changes.
+	struct ZSortCache
+	{
+		const MeshDomain*	dom = nullptr;
+		int					stamp = -1;
+		vec3d				camPos, camTrg;
+		quatd				camRot;
+		std::vector<int>	faces;		// tagged faces (indices into domain's face list)
+		std::vector<float>	z;			// view depth of tagged faces
+		std::vector<int>	sorted;		// sorted face list
+		GLDepthSort			sorter;
+	};
+	std::vector<ZSortCache>	m_zsort;		// one per material and face tag
+	std::vector<int>		m_zsortFaces;	// scratch buffer for tagged faces
+	int						m_zsortStamp;	// incremented each time the mesh state is updated
+
 	// selected items
 	vector<FSNode*>		m_nodeSelection;
 	vector<FSEdge*>		m_edgeSelection;
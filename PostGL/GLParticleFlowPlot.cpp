@@ -382,35 +382,41 @@ void CGLParticleFlowPlot::UpdateParticleColors()
 vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, bool& ok)
 {
 	vec3f v(0.f, 0.f, 0.f);
-	vec3f ve0[FSElement::MAX_NODES];
-	vec3f ve1[FSElement::MAX_NODES];
-	FEPostMesh& mesh = *GetModel()->GetActiveMesh();
-
-	vector<vec3f>& val0 = m_map.State(ntime    );
-	vector<vec3f>& val1 = m_map.State(ntime + 1);
-
 	int nelem;
 	double q[3];
 	if (m_find->FindElement(r, nelem, q))
 	{
 		ok = true;
-		FEElement_& el = mesh.ElementRef(nelem);
+		v = ElementVelocity(nelem, q, ntime, w);
+	}
+	else ok = false;
 
-		int ne = el.Nodes();
-		for (int i = 0; i<ne; ++i)
-		{
-			ve0[i] = val0[el.m_node[i]];
-			ve1[i] = val1[el.m_node[i]];
-		}
+	return v;
+}
 
-		vec3f v0 = el.eval(ve0, q[0], q[1], q[2]);
-		vec3f v1 = el.eval(ve1, q[0], q[1], q[2]);
+// evaluate the velocity at natural coordinates q of an element
+vec3f CGLParticleFlowPlot::ElementVelocity(int nelem, const double q[3], int ntime, float w)
+{
+	vec3f ve0[FSElement::MAX_NODES];
+	vec3f ve1[FSElement::MAX_NODES];
+	FEPostMesh& mesh = *GetModel()->GetActiveMesh();
 
-		v = v0*(1.f - w) + v1*w;
+	vector<vec3f>& val0 = m_map.State(ntime    );
+	vector<vec3f>& val1 = m_map.State(ntime + 1);
+
+	FEElement_& el = mesh.ElementRef(nelem);
+
+	int ne = el.Nodes();
+	for (int i = 0; i<ne; ++i)
+	{
+		ve0[i] = val0[el.m_node[i]];
+		ve1[i] = val1[el.m_node[i]];
 	}
-	else ok = false;
 
-	return v;
+	vec3f v0 = el.eval(ve0, q[0], q[1], q[2]);
+	vec3f v1 = el.eval(ve1, q[0], q[1], q[2]);
+
+	return v0*(1.f - w) + v1*w;
 }
 
 void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
@@ -428,6 +434,12 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 	float dt = m_dt;
 	if (dt <= 0.f) return;
 
+	// buffers for locating the particles
+	vector<int> alive;
+	vector<vec3f> x;
+	vector<int> elem;
+	vector<vec3d> q;
+
 	for (int ntime=n0; ntime<n1; ++ntime)
 	{
 		float t0 = fem.GetState(ntime    )->m_time;
@@ -450,30 +462,40 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 			if (t > t1) t = t1;
 			float w = (t - t0) / (t1 - t0);
 
+			// move the live particles
 			int NP = (int) m_particles.size();
-#pragma omp parallel for shared (NP)
+			alive.clear();
+			x.clear();
 			for (int i=0; i<NP; ++i)
 			{
 				FlowParticle& p = m_particles[i];
-
 				if (p.m_ndeath > ntime)
 				{
 					vec3f r0 = p.m_pos[ntime + 1];
 					vec3f v0 = p.m_vel[ntime + 1];
+					alive.push_back(i);
+					x.push_back(r0 + v0*dt);
+				}
+			}
+
+			// locate all particles at once
+			m_find->FindElements(x, elem, q);
 
-					vec3f r1 = r0 + v0*dt;
-
-					bool ok = true;
-					vec3f v1 = Velocity(r1, ntime, w, ok);
-					if (ok == false)
-					{
-						p.m_ndeath = ntime + 1;
-					}
-					else
-					{
-						p.m_pos[ntime + 1] = r1;
-						p.m_vel[ntime + 1] = v1;
-					}
+			// update their velocities
+			int NA = (int)alive.size();
+#pragma omp parallel for shared (NA)
+			for (int k=0; k<NA; ++k)
+			{
+				FlowParticle& p = m_particles[alive[k]];
+				if (elem[k] < 0)
+				{
+					p.m_ndeath = ntime + 1;
+				}
+				else
+				{
+					double qk[3] = { q[k].x, q[k].y, q[k].z };
+					p.m_pos[ntime + 1] = x[k];
+					p.m_vel[ntime + 1] = ElementVelocity(elem[k], qk, ntime, w);
 				}
 			}
 		}
@@ -108,6 +108,7 @@ protected:
 	void AdvanceParticles(int t0, int t1);
 
 	vec3f Velocity(const vec3f& r, int ntime, float dt, bool& ok);
+	vec3f ElementVelocity(int nelem, const double q[3], int ntime, float w);
 
 	void UpdateParticleState(int ntime);
 
@@ -31,6 +31,8 @@ SOFTWARE.*/
 #include "GLModel.h"
 #include <MeshLib/hex.h>
 #include <MeshTools/FESelection.h>
+#include <math.h>
+#include <float.h>
 using namespace Post;
 
 extern int LUT[256][15];
@@ -45,6 +47,32 @@ const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
 const int QUAD_NT[4] = { 0, 1, 2, 3 };
 const int TRI_NT[4]  = { 0, 1, 2, 2 };
 
+// Returns the element nodes that are used for the corners of the marching cubes hex
+static const int* plane_corner_nodes(int elemType)
+{
+	switch (elemType)
+	{
+	case FE_HEX8   : return HEX_NT;
+	case FE_HEX20  : return HEX_NT;
+	case FE_HEX27  : return HEX_NT;
+	case FE_PENTA6 : return PEN_NT;
+	case FE_PENTA15: return PEN_NT;
+	case FE_TET4   : return TET_NT;
+	case FE_TET5   : return TET_NT;
+	case FE_TET10  : return TET_NT;
+	case FE_TET15  : return TET_NT;
+	case FE_TET20  : return TET_NT;
+	case FE_PYRA5  : return PYR_NT;
+	case FE_PYRA13 : return PYR_NT;
+	}
+	return nullptr;
+}
+
+// Round to the nearest float that is not larger (float_down) or smaller (float_up) than v,
+// so that the float ranges in the span space always contain the exact range.
+static float float_down(double v) { float f = (float)v; return (f > v ? nextafterf(f, -FLT_MAX) : f); }
+static float float_up  (double v) { float f = (float)v; return (f < v ? nextafterf(f,  FLT_MAX) : f); }
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -91,6 +119,8 @@ CGLPlaneCutPlot::CGLPlaneCutPlot()
 	if (m_nclip >= 0) m_pcp[m_nclip] = this;
 
 	m_bupdateSlice = false;
+	m_bupdateSpan = true;
+	m_spanMesh = nullptr;
 
 	UpdateData(false);
 }
@@ -189,6 +219,9 @@ void CGLPlaneCutPlot::InitClipPlanes()
 void CGLPlaneCutPlot::Update(int ntime, float dt, bool breset)
 {
 	m_bupdateSlice = true;
+
+	// nodal positions may have changed
+	m_bupdateSpan = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -467,9 +500,9 @@ void CGLPlaneCutPlot::UpdateLineMesh()
 	int matId = -1;
 	Material* pmat = nullptr;
 
-	// repeat over all elements
+	// repeat over all elements that are cut by the plane
 	vector<vec3d> points; points.reserve(1024);
-	for (int i=0; i<pm->Elements(); ++i)
+	for (int i : m_cutElems)
 	{
 		// render only when visible
 		FEElement_& el = pm->ElementRef(i);
@@ -481,22 +514,9 @@ void CGLPlaneCutPlot::UpdateLineMesh()
 
 		if (pmat && (el.m_ntag > 0) && el.IsSolid() && (pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
 		{
-			const int* nt = nullptr;
-			switch (el.Type())
+			const int* nt = plane_corner_nodes(el.Type());
+			if (nt == nullptr)
 			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-            case FE_PENTA15: nt = PEN_NT; break;
-            case FE_TET4   : nt = TET_NT; break;
-            case FE_TET5   : nt = TET_NT; break;
-			case FE_TET10  : nt = TET_NT; break;
-			case FE_TET15  : nt = TET_NT; break;
-			case FE_TET20  : nt = TET_NT; break;
-            case FE_PYRA5  : nt = PYR_NT; break;
-            case FE_PYRA13 : nt = PYR_NT; break;
-			default:
 				assert(false);
 				continue;
 			}
@@ -688,27 +708,71 @@ void CGLPlaneCutPlot::UpdateSlice()
 
 	m_slice.Clear();
 
-	Post::FEState& state = *ps->CurrentState();
+	// rebuild the element index when the mesh or the plane orientation changed
+	if (m_bupdateSpan || (pm != m_spanMesh) || ((norm == m_spanNormal) == false))
+	{
+		UpdateSpanSpace(pm, norm);
+	}
+
+	// find the elements that are cut by the plane
+	m_span.Find((float)ref, m_cutElems);
 
-	// loop over all domains
-	for (int n = 0; n < pm->Domains(); ++n)
+	// only keep the elements of the materials that can be cut
+	int ncut = 0;
+	for (int i : m_cutElems)
 	{
-		MeshDomain& dom = pm->Domain(n);
-		int matId = dom.GetMatID();
+		FEElement_& el = pm->ElementRef(i);
+		int matId = el.m_MatID;
 		if ((matId >= 0) && (matId < ps->Materials()))
 		{
 			Material* pmat = ps->GetMaterial(matId);
-			if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip)
+			if ((pmat->bvisible || m_bcut_hidden) && pmat->bclip && (el.IsVisible() || m_bcut_hidden))
 			{
-				AddDomain(pm, n);
+				m_cutElems[ncut++] = i;
 			}
 		}
 	}
+	m_cutElems.resize(ncut);
+
+	AddElements(pm);
 
 	AddFaces(pm);
 }
 
-void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
+//-----------------------------------------------------------------------------
+// Build the span-space index of the element ranges along the plane normal
+void CGLPlaneCutPlot::UpdateSpanSpace(FEPostMesh* pm, const vec3d& norm)
+{
+	int NE = pm->Elements();
+	vector<float> wmin(NE, 1.f), wmax(NE, 0.f);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = pm->ElementRef(i);
+		const int* nt = (el.IsSolid() ? plane_corner_nodes(el.Type()) : nullptr);
+		if (nt)
+		{
+			double w0 = norm * pm->Node(el.m_node[nt[0]]).r, w1 = w0;
+			for (int k = 1; k < 8; ++k)
+			{
+				double wk = norm * pm->Node(el.m_node[nt[k]]).r;
+				if (wk < w0) w0 = wk;
+				if (wk > w1) w1 = wk;
+			}
+			wmin[i] = float_down(w0);
+			wmax[i] = float_up(w1);
+		}
+	}
+	m_span.Build(wmin, wmax);
+
+	m_spanMesh = pm;
+	m_spanNormal = norm;
+	m_bupdateSpan = false;
+}
+
+//-----------------------------------------------------------------------------
+// Add the slice faces of the elements that are cut by the plane
+void CGLPlaneCutPlot::AddElements(FEPostMesh* pm)
 {
 	float ev[8];
 	vec3d ex[8];
@@ -717,8 +781,6 @@ void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
 	int en[8];
 	int	rf[3];
 
-	MeshDomain& dom = pm->Domain(n);
-
 	// get the plane equations
 	GLdouble a[4];
 	GetNormalizedEquations(a);
@@ -734,29 +796,20 @@ void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
 	FEPostModel* ps = mdl->GetFSModel();
 	Post::FEState& state = *ps->CurrentState();
 
-	// repeat over all elements
-	for (int i = 0; i < dom.Elements(); ++i)
+	// The element tags store the case of the cut elements, which is used when 
+	// the mesh lines are rendered. Elements that are not cut must be cleared, 
+	// since the span-space query skips them.
+	for (int i = 0; i < pm->Elements(); ++i) pm->ElementRef(i).m_ntag = 0;
+
+	// repeat over all elements that are cut
+	for (int i : m_cutElems)
 	{
-		// render only when visible
-		FEElement_& el = dom.Element(i);
-		if ((el.IsVisible() || m_bcut_hidden) && el.IsSolid())
+		FEElement_& el = pm->ElementRef(i);
+		const int *nt = plane_corner_nodes(el.Type());
+		if (nt)
 		{
-			const int *nt = nullptr;
-			switch (el.Type())
-			{
-			case FE_HEX8: nt = HEX_NT; break;
-			case FE_HEX20: nt = HEX_NT; break;
-			case FE_HEX27: nt = HEX_NT; break;
-			case FE_PENTA6: nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4: nt = TET_NT; break;
-			case FE_TET5: nt = TET_NT; break;
-			case FE_TET10: nt = TET_NT; break;
-			case FE_TET15: nt = TET_NT; break;
-			case FE_TET20: nt = TET_NT; break;
-			case FE_PYRA5: nt = PYR_NT; break;
-            case FE_PYRA13: nt = PYR_NT; break;
-			}
+			// slice faces are tagged with the domain (i.e. material) index
+			int n = el.m_MatID;
 
 			// get the nodal values
 			for (int k = 0; k < 8; ++k)
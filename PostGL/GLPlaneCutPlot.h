@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "GLPlot.h"
 #include <FECore/FETransform.h>
 #include <GLLib/GLMesh.h>
+#include "PostLib/SpanSpace.h"
 #include <vector>
 
 namespace Post {
@@ -121,13 +122,14 @@ protected:
 	void ReleasePlane();
 	static int GetFreePlane();
 
-	void AddDomain(FEPostMesh* pm, int n);
+	void AddElements(FEPostMesh* pm);
 	void AddFaces(FEPostMesh* pm);
 
 	void UpdateTriMesh();
 	void UpdateLineMesh();
 	void UpdateOutlineMesh();
 	void UpdateSlice();
+	void UpdateSpanSpace(FEPostMesh* pm, const vec3d& norm);
 
 public:
 	static int ClipPlanes();
@@ -169,5 +171,11 @@ protected:
 	GLLineMesh	m_outlineMesh;	// for rendering the outline
 
 	bool	m_bupdateSlice; // update slice before rendering
+
+	SpanSpace			m_span;			// element ranges along the plane normal
+	std::vector<int>	m_cutElems;		// elements that are cut by the plane
+	vec3d				m_spanNormal;	// plane normal used for building the span space
+	FEPostMesh*			m_spanMesh;		// mesh used for building the span space
+	bool				m_bupdateSpan;	// rebuild span space on next slice update
 };
 }
@@ -72,6 +72,9 @@ CGLStreamLinePlot::CGLStreamLinePlot()
 	m_lastTime = 0;
 	m_lastdt = 1.f;
 
+	// the per-state values share the memory budget of the post plots
+	m_map.SetBudget(DataMapBudget::Shared());
+
 	m_Col.SetDivisions(10);
 
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::ORIENT_HORIZONTAL);
@@ -95,6 +95,9 @@ GLTensorPlot::GLTensorPlot()
 	m_range.mintype = RANGE_DYNAMIC;
 	m_range.valid = false;
 
+	m_glyphScale = 0.f;
+	m_bvalidGlyphs = false;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::ORIENT_HORIZONTAL);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->copy_label(szname);
@@ -124,6 +127,7 @@ bool GLTensorPlot::UpdateData(bool bsave)
 		m_bautoscale = GetBoolValue(AUTO_SCALE);
 		m_bnormalize = GetBoolValue(NORMALIZE);
 		m_ndivs = GetIntValue(RANGE_DIVS);
+		m_bvalidGlyphs = false;
 
 		m_range.maxtype = GetIntValue(MAX_RANGE_TYPE);
 		m_range.mintype = GetIntValue(MIN_RANGE_TYPE);
@@ -206,6 +210,7 @@ void GLTensorPlot::Update(int ntime, float dt, bool breset)
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
+	m_bvalidGlyphs = false;
 
 	CGLModel* mdl = GetModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
@@ -441,12 +446,7 @@ void GLTensorPlot::Render(CGLContext& rc)
 	//	glMateriali(GL_FRONT_AND_BACK, GL_SHININESS, 32);
 
 	// store attributes
-	glPushAttrib(GL_LIGHTING_BIT);
-
-	// create the cylinder object
-	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
+	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT);
 
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
@@ -458,21 +458,9 @@ void GLTensorPlot::Render(CGLContext& rc)
 
 	float scale = 0.02f*m_scale*pfem->GetBoundingBox().Radius();
 
-	if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
-	else
-	{
-		glEnable(GL_LIGHTING);
-		glEnable(GL_COLOR_MATERIAL);
-		glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
-
-		GLfloat dif[] = { 1.f, 1.f, 1.f, 1.f };
-		GLfloat amb[] = { 0.1f, 0.1f, 0.1f, 1.f };
-
-		glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
-		glLightfv(GL_LIGHT0, GL_AMBIENT, amb);
-	}
-
+	// find the items that get a glyph
+	vector<int> items;
+	int nitems = 0;
 	if (IS_ELEM_FIELD(m_ntensor))
 	{
 		pm->TagAllElements(0);
@@ -496,54 +484,11 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
-		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Elements(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
-		}
-
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
-		{
-			fmax = m_range.max;
-			fmin = m_range.min;
-		}
-
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
-
+		nitems = pm->Elements();
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
-			{
-				vec3d r = pm->ElementCenter(elem);
-
-				TENSOR& t = m_val[i];
-
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f - fmin) / (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
-				}
-
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
-			}
+			if ((frand() <= m_dens) && elem.m_ntag) items.push_back(i);
 		}
 	}
 	else
@@ -570,61 +515,60 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
+		nitems = pm->Nodes();
+		for (int i = 0; i < pm->Nodes(); ++i)
 		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Nodes(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
+			FSNode& node = pm->Node(i);
+			if ((frand() <= m_dens) && node.m_ntag) items.push_back(i);
 		}
+	}
 
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
+	if (m_bautoscale)
+	{
+		float Lmax = 0.f;
+		for (int i = 0; i < nitems; ++i)
 		{
-			fmax = m_range.max;
-			fmin = m_range.min;
+			for (int j = 0; j < 3; ++j)
+			{
+				float L = fabs(m_val[i].l[j]);
+				if (L > Lmax) Lmax = L;
+			}
 		}
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
+		if (Lmax == 0.f) Lmax = 1.f;
+		scale /= Lmax;
+	}
 
-		if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
+	float fmax = 1.f, fmin = 0.f;
+	if (m_ncol != Glyph_Col_Solid)
+	{
+		fmax = m_range.max;
+		fmin = m_range.min;
+	}
+	GetLegendBar()->SetRange(fmin, fmax);
 
-		glx::glcolor(m_gcl);
+	// the glyphs are only rebuilt when something changed since the last time
+	if ((m_bvalidGlyphs == false) || (m_glyphScale != scale) || (items != m_glyphItems))
+	{
+		BuildGlyphs(items, scale);
+		m_glyphItems = items;
+		m_glyphScale = scale;
+		m_bvalidGlyphs = true;
+	}
 
-		for (int i = 0; i < pm->Nodes(); ++i)
-		{
-			FSNode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
-			{
-				vec3d r = node.r;
+	glEnable(GL_LIGHTING);
+	glEnable(GL_COLOR_MATERIAL);
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 
-				TENSOR& t = m_val[i];
+	GLfloat dif[] = { 1.f, 1.f, 1.f, 1.f };
+	GLfloat amb[] = { 0.1f, 0.1f, 0.1f, 1.f };
 
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f  - fmin)/ (fmax - fmin);
-					GLColor c = map.map(w);
-					glx::glcolor(c);
-				}
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, amb);
 
-				glx::translate(r);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glx::translate(-r);
-			}
-		}
-	}
+	m_glyphMesh.Render();
 
-	gluDeleteQuadric(pglyph);
+	glDisable(GL_LIGHTING);
+	m_lineMesh.Render();
 
 	// restore attributes
 	glPopAttrib();
@@ -632,18 +576,54 @@ void GLTensorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void GLTensorPlot::RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph)
+void GLTensorPlot::BuildGlyphs(const vector<int>& items, float scale)
+{
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+	CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
+
+	float fmax = 1.f, fmin = 0.f;
+	if (m_ncol != Glyph_Col_Solid)
+	{
+		fmax = m_range.max;
+		fmin = m_range.min;
+	}
+	if (fmax == fmin) fmax++;
+
+	GLGlyphBuilder glyphs;
+	for (int i : items)
+	{
+		vec3f r;
+		if (IS_ELEM_FIELD(m_ntensor)) r = to_vec3f(pm->ElementCenter(pm->ElementRef(i)));
+		else r = to_vec3f(pm->Node(i).r);
+
+		const TENSOR& t = m_val[i];
+
+		GLColor c(m_gcl.r, m_gcl.g, m_gcl.b);
+		if (m_ncol != Glyph_Col_Solid)
+		{
+			float w = (t.f - fmin) / (fmax - fmin);
+			c = map.map(w);
+			c.a = 255;
+		}
+
+		AddGlyphs(glyphs, r, t, scale, c);
+	}
+
+	glyphs.BuildMesh(m_glyphMesh, m_lineMesh);
+}
+
+void GLTensorPlot::AddGlyphs(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c)
 {
 	switch (m_nglyph)
 	{
-	case Glyph_Arrow : RenderArrows(t, scale, glyph); break;
-	case Glyph_Line  : RenderLines (t, scale, glyph); break;
-	case Glyph_Sphere: RenderSphere(t, scale, glyph); break;
-	case Glyph_Box   : RenderBox   (t, scale, glyph); break;
+	case Glyph_Arrow : AddArrows(glyphs, r, t, scale); break;
+	case Glyph_Line  : AddLines (glyphs, r, t, scale); break;
+	case Glyph_Sphere: AddSphere(glyphs, r, t, scale, c); break;
+	case Glyph_Box   : AddBox   (glyphs, r, t, scale, c); break;
 	}
 }
 
-void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+void GLTensorPlot::AddArrows(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale)
 {
 	GLColor c[3];
 	c[0] = GLColor(255, 0, 0);
@@ -652,8 +632,6 @@ void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadric
 
 	for (int i = 0; i<3; ++i)
 	{
-		glPushMatrix();
-
 		float L = (m_bnormalize ? scale : scale*t.l[i]);
 		float l0 = L*.9;
 		float l1 = L*.2;
@@ -661,24 +639,15 @@ void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadric
 		float r1 = L*0.15;
 
 		vec3f v = t.r[i];
-		quatd q = quatd(vec3d(0,0,1), to_vec3d(v));
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		}
+		if (v.Length() == 0.f) continue;
+		v.Normalize();
 
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
-
-		glPopMatrix();
+		glyphs.AddGlyph(GLGlyphBuilder::SHAFT, r, v, r0, l0, c[i]);
+		glyphs.AddGlyph(GLGlyphBuilder::CONE, r + v*(l0*0.9f), v, r1, l1, c[i]);
 	}
 }
 
-void GLTensorPlot::RenderLines(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+void GLTensorPlot::AddLines(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale)
 {
 	GLColor c[3];
 	c[0] = GLColor(255, 0, 0);
@@ -687,27 +656,17 @@ void GLTensorPlot::RenderLines(GLTensorPlot::TENSOR& t, float scale, GLUquadricO
 
 	for (int i = 0; i<3; ++i)
 	{
-		glPushMatrix();
-
 		float L = (m_bnormalize ? scale : scale*t.l[i]);
 
 		vec3f v = t.r[i];
-		quatd q = quatd(vec3d(0, 0, 1), to_vec3d(v));
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotatef(w * 180 / PI, p.x, p.y, p.z);
-		}
-
-		glx::glcolor(c[i]);
-		glx::drawLine(0, 0, 0, 0, 0, L);
+		if (v.Length() == 0.f) continue;
+		v.Normalize();
 
-		glPopMatrix();
+		glyphs.AddGlyph(GLGlyphBuilder::LINE, r, v, L, L, c[i]);
 	}
 }
 
-void GLTensorPlot::RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph)
+void GLTensorPlot::AddSphere(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c)
 {
 	if (scale <= 0.f) return;
 
@@ -721,23 +680,11 @@ void GLTensorPlot::RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph)
 	if (sy < 0.1*smax) sy = 0.1f*smax;
 	if (sz < 0.1*smax) sz = 0.1f*smax;
 
-	glPushMatrix();
-	vec3f* e = t.r;
-	vec3f n = e[0] ^ e[1];
-	if (n*e[2] < 0) e[2] = -e[2];
-	GLfloat m[4][4] = {0};
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	gluSphere(glyph, 1.f, 16, 16);
-	glPopMatrix();
+	const vec3f* e = t.r;
+	glyphs.AddGlyph(GLGlyphBuilder::ELLIPSOID, r, e[0]*(scale*sx), e[1]*(scale*sy), e[2]*(scale*sz), c);
 }
 
-void GLTensorPlot::RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph)
+void GLTensorPlot::AddBox(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c)
 {
 	if (scale <= 0.f) return;
 
@@ -751,16 +698,7 @@ void GLTensorPlot::RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph)
 	if (sy < 0.1*smax) sy = 0.1f*smax;
 	if (sz < 0.1*smax) sz = 0.1f*smax;
 
-	glPushMatrix();
-	vec3f* e = t.r;
-	GLfloat m[4][4] = { 0 };
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	glx::drawBox(0.5, 0.5, 0.5);
-	glPopMatrix();
+	// the unit box spans [-1,1], so use half the size
+	const vec3f* e = t.r;
+	glyphs.AddGlyph(GLGlyphBuilder::BOX, r, e[0]*(0.5f*scale*sx), e[1]*(0.5f*scale*sy), e[2]*(0.5f*scale*sz), c);
 }
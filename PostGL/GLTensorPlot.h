@@ -26,12 +26,9 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
+#include "GLGlyphBuilder.h"
 #include <GLWLib/GLWidget.h>
-#ifdef __APPLE__
-    #include <OpenGL/GLU.h>
-#else
-    #include <GL/glu.h>
-#endif
+#include <GLLib/GLMesh.h>
 
 namespace Post {
 
@@ -77,6 +74,8 @@ public:
 
 	bool UpdateData(bool bsave = true) override;
 
+	void UpdateTexture() override { m_Col.UpdateTexture(); m_bvalidGlyphs = false; }
+
 public:
 	int GetTensorField() { return m_ntensor; }
 	void SetTensorField(int nfield);
@@ -84,36 +83,39 @@ public:
 	int GetVectorMethod() const { return m_nmethod; }
 	void SetVectorMethod(int m);
 
-	void SetScaleFactor(float g) { m_scale = g; }
+	void SetScaleFactor(float g) { m_scale = g; m_bvalidGlyphs = false; }
 	double GetScaleFactor() { return m_scale; }
 
-	void SetDensity(float d) { m_dens = d; }
+	void SetDensity(float d) { m_dens = d; m_bvalidGlyphs = false; }
 	double GetDensity() { return m_dens; }
 
 	bool ShowHidden() const { return m_bshowHidden; }
 	void ShowHidden(bool b) { m_bshowHidden = b; }
 
 	int GetGlyphType() { return m_nglyph; }
-	void SetGlyphType(int ntype) { m_nglyph = ntype; }
+	void SetGlyphType(int ntype) { m_nglyph = ntype; m_bvalidGlyphs = false; }
 
 	int GetColorType() { return m_ncol; }
-	void SetColorType(int ntype) { m_ncol = ntype; }
+	void SetColorType(int ntype) { m_ncol = ntype; m_bvalidGlyphs = false; }
 
 	GLColor GetGlyphColor() { return m_gcl; }
-	void SetGlyphColor(GLColor c) { m_gcl = c; }
+	void SetGlyphColor(GLColor c) { m_gcl = c; m_bvalidGlyphs = false; }
 
 	bool GetAutoScale() { return m_bautoscale; }
-	void SetAutoScale(bool b) { m_bautoscale = b; }
+	void SetAutoScale(bool b) { m_bautoscale = b; m_bvalidGlyphs = false; }
 
 	bool GetNormalize() { return m_bnormalize; }
-	void SetNormalize(bool b) { m_bnormalize = b; }
+	void SetNormalize(bool b) { m_bnormalize = b; m_bvalidGlyphs = false; }
 
 protected:
-	void RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderArrows(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderLines(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph);
+	void AddGlyphs(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c);
+	void AddArrows(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale);
+	void AddLines (GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale);
+	void AddSphere(GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c);
+	void AddBox   (GLGlyphBuilder& glyphs, const vec3f& r, const TENSOR& t, float scale, const GLColor& c);
+
+	// rebuild the glyph meshes for the given items
+	void BuildGlyphs(const vector<int>& items, float scale);
 
 	void Update() override;
 
@@ -144,5 +146,11 @@ protected:
 	int		m_lastTime;
 	float	m_lastDt;
 	int		m_lastCol;
+
+	GLTriMesh		m_glyphMesh;	// cached glyph geometry
+	GLLineMesh		m_lineMesh;		// cached line glyphs
+	vector<int>		m_glyphItems;	// items the cached glyphs were built for
+	float			m_glyphScale;	// scale factor the cached glyphs were built with
+	bool			m_bvalidGlyphs;	// are the cached glyphs up to date?
 };
 }
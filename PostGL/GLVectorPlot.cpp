@@ -93,6 +93,13 @@ CGLVectorPlot::CGLVectorPlot()
 	m_usr[0] = 0.0;
 	m_usr[1] = 1.0;
 
+	// the per-state values share the memory budget of the post plots
+	m_map.SetBudget(DataMapBudget::Shared());
+
+	m_fscale = 0.f;
+	m_glyphScale = 0.f;
+	m_bvalidGlyphs = false;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 120, 500);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->SetOrientation(GLLegendBar::ORIENT_HORIZONTAL);
@@ -125,6 +132,7 @@ bool CGLVectorPlot::UpdateData(bool bsave)
 		m_rngType = GetIntValue(RANGE_TYPE);
 		m_usr[1] = GetFloatValue(USER_MAX);
 		m_usr[0] = GetFloatValue(USER_MIN);
+		m_bvalidGlyphs = false;
 
 		GLLegendBar* bar = GetLegendBar();
 		if ((m_ncol == 0) || !IsActive()) bar->hide();
@@ -178,11 +186,6 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT);
 
-	// create the cylinder object
-	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
-
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFSModel();
 
@@ -210,18 +213,8 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		m_fscale *= autoscale;
 	}
 
-	if (m_nglyph == GLYPH_LINE) glDisable(GL_LIGHTING);
-	else
-	{
-		glEnable(GL_LIGHTING);
-		glEnable(GL_COLOR_MATERIAL);
-
-		GLfloat dif[] = {1.f, 1.f, 1.f, 1.f};
-
-		glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
-		glLightfv(GL_LIGHT0, GL_AMBIENT, dif);
-	}
-
+	// find the items that get a glyph
+	vector<int> items;
 	if (IS_ELEM_FIELD(m_nvec))
 	{
 		pm->TagAllElements(0);
@@ -245,16 +238,10 @@ void CGLVectorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		// render the vectors at the elements' centers
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
-			{
-				vec3f r = to_vec3f(pm->ElementCenter(elem));
-				vec3f v = m_val[i];
-				RenderVector(r, v, pglyph);
-			}
+			if ((frand() <= m_dens) && elem.m_ntag) items.push_back(i);
 		}
 	}
 	else if (IS_FACE_FIELD(m_nvec))
@@ -284,16 +271,10 @@ void CGLVectorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		// render the vectors at the face's center
 		for (int i = 0; i < pm->Faces(); ++i)
 		{
 			FSFace& face = pm->Face(i);
-			if ((frand() <= m_dens) && face.m_ntag)
-			{
-				vec3f r = to_vec3f(pm->FaceCenter(face));
-				vec3f v = m_val[i];
-				RenderVector(r, v, pglyph);
-			}
+			if ((frand() <= m_dens) && face.m_ntag) items.push_back(i);
 		}
 	}
 	else if (IS_NODE_FIELD(m_nvec))
@@ -323,18 +304,31 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FSNode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
-			{
-				vec3f r = to_vec3f(node.r);
-
-				vec3f v = m_val[i];
-
-				RenderVector(r, v, pglyph);
-			}
+			if ((frand() <= m_dens) && node.m_ntag) items.push_back(i);
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	// the glyphs are only rebuilt when something changed since the last time
+	if ((m_bvalidGlyphs == false) || (m_glyphScale != m_fscale) || (items != m_glyphItems))
+	{
+		BuildGlyphs(items);
+		m_glyphItems = items;
+		m_glyphScale = m_fscale;
+		m_bvalidGlyphs = true;
+	}
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_COLOR_MATERIAL);
+
+	GLfloat dif[] = {1.f, 1.f, 1.f, 1.f};
+
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, dif);
+
+	m_glyphMesh.Render();
+
+	glDisable(GL_LIGHTING);
+	m_lineMesh.Render();
 
 	// restore attributes
 	glPopAttrib();
@@ -342,7 +336,25 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 }
 
-void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
+void CGLVectorPlot::BuildGlyphs(const vector<int>& items)
+{
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+
+	GLGlyphBuilder glyphs;
+	for (int i : items)
+	{
+		vec3f r;
+		if      (IS_ELEM_FIELD(m_nvec)) r = to_vec3f(pm->ElementCenter(pm->ElementRef(i)));
+		else if (IS_FACE_FIELD(m_nvec)) r = to_vec3f(pm->FaceCenter(pm->Face(i)));
+		else r = to_vec3f(pm->Node(i).r);
+
+		AddVectorGlyph(glyphs, r, m_val[i]);
+	}
+
+	glyphs.BuildMesh(m_glyphMesh, m_lineMesh);
+}
+
+void CGLVectorPlot::AddVectorGlyph(GLGlyphBuilder& glyphs, const vec3f& r, vec3f v)
 {
 	float L = v.Length();
 	if (L == 0.f) return;
@@ -359,19 +371,14 @@ void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
 	switch (m_ncol)
 	{
 	case GLYPH_COL_LENGTH:
-		glColor3ub(col.r, col.g, col.b);
+		col.a = 255;
 		break;
 	case GLYPH_COL_ORIENT:
-	{
-		GLdouble r = fabs(v.x);
-		GLdouble g = fabs(v.y);
-		GLdouble b = fabs(v.z);
-		glColor3d(r, g, b);
-	}
-	break;
+		col = GLColor::FromRGBf(fabs(v.x), fabs(v.y), fabs(v.z));
+		break;
 	case GLYPH_COL_SOLID:
 	default:
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
+		col = GLColor(m_gcl.r, m_gcl.g, m_gcl.b);
 	}
 
 	if (m_bnorm) L = 1;
@@ -382,42 +389,27 @@ void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
 	float r0 = L*0.05*m_ar;
 	float r1 = L*0.15*m_ar;
 
-	glPushMatrix();
-
-	glTranslatef(r.x, r.y, r.z);
-	quatd q(vec3d(0,0,1), to_vec3d(v));
-	float w = q.GetAngle();
-	if (fabs(w) > 1e-6)
-	{
-		vec3d p = q.GetVector();
-		if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		else glRotated(w * 180 / PI, 1, 0, 0);
-	}
-
 	switch (m_nglyph)
 	{
 	case GLYPH_ARROW:
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
+		glyphs.AddGlyph(GLGlyphBuilder::SHAFT, r, v, r0, l0, col);
+		glyphs.AddGlyph(GLGlyphBuilder::CONE, r + v*(l0*0.9f), v, r1, l1, col);
 		break;
 	case GLYPH_CONE:
-		gluCylinder(pglyph, r1, 0, l0, 10, 1);
+		glyphs.AddGlyph(GLGlyphBuilder::CONE, r, v, r1, l0, col);
 		break;
 	case GLYPH_CYLINDER:
-		gluCylinder(pglyph, r1, r1, l0, 10, 1);
+		glyphs.AddGlyph(GLGlyphBuilder::CYLINDER, r, v, r1, l0, col);
 		break;
 	case GLYPH_SPHERE:
-		gluSphere(pglyph, r1, 10, 5);
+		glyphs.AddGlyph(GLGlyphBuilder::SPHERE, r, v, r1, r1, col);
 		break;
 	case GLYPH_BOX:
-		glx::drawBox(r0, r0, r0);
+		glyphs.AddGlyph(GLGlyphBuilder::BOX, r, v, r0, r0, col);
 		break;
 	case GLYPH_LINE:
-		glx::drawLine(0, 0, 0, 0, 0, L);
+		glyphs.AddGlyph(GLGlyphBuilder::LINE, r, v, L, L, col);
 	}
-
-	glPopMatrix();
 }
 
 void CGLVectorPlot::SetVectorField(int ntype) 
@@ -449,6 +441,7 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
+	m_bvalidGlyphs = false;
 
 	CGLModel* mdl = GetModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
@@ -497,8 +490,9 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	else
 	{
 		// get the state
-		FEState& s0 = *pfem->GetState(n0);
-		FEState& s1 = *pfem->GetState(n1);
+		FEStateLock lock0(*pfem, n0), lock1(*pfem, n1);
+		FEState& s0 = *lock0;
+		FEState& s1 = *lock1;
 
 		float df = s1.m_time - s0.m_time;
 		if (df == 0) df = 1.f;
@@ -26,8 +26,8 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
-
-class GLUquadric;
+#include "GLGlyphBuilder.h"
+#include <GLLib/GLMesh.h>
 
 namespace Post {
 
@@ -74,29 +74,29 @@ public:
 
 	void Render(CGLContext& rc) override;
 
-	void SetScaleFactor(float g) { m_scale = g; }
+	void SetScaleFactor(float g) { m_scale = g; m_bvalidGlyphs = false; }
 	double GetScaleFactor() { return m_scale; }
 
-	void SetDensity(float d) { m_dens = d; }
+	void SetDensity(float d) { m_dens = d; m_bvalidGlyphs = false; }
 	double GetDensity() { return m_dens; }
 
 	int GetVectorField() { return m_nvec; }
 	void SetVectorField(int ntype);
 
 	int GetGlyphType() { return m_nglyph; }
-	void SetGlyphType(int ntype) { m_nglyph = ntype; }
+	void SetGlyphType(int ntype) { m_nglyph = ntype; m_bvalidGlyphs = false; }
 
 	int GetColorType() { return m_ncol; }
-	void SetColorType(int ntype) { m_ncol = ntype; }
+	void SetColorType(int ntype) { m_ncol = ntype; m_bvalidGlyphs = false; }
 
 	GLColor GetGlyphColor() { return m_gcl; }
-	void SetGlyphColor(GLColor c) { m_gcl = c; }
+	void SetGlyphColor(GLColor c) { m_gcl = c; m_bvalidGlyphs = false; }
 
 	bool NormalizeVectors() { return m_bnorm; }
-	void NormalizeVectors(bool b) { m_bnorm = b; }
+	void NormalizeVectors(bool b) { m_bnorm = b; m_bvalidGlyphs = false; }
 
 	bool GetAutoScale() { return m_bautoscale; }
-	void SetAutoScale(bool b) { m_bautoscale = b; }
+	void SetAutoScale(bool b) { m_bautoscale = b; m_bvalidGlyphs = false; }
 
 	bool ShowHidden() const { return m_bshowHidden; }
 	void ShowHidden(bool b) { m_bshowHidden = b; }
@@ -105,7 +105,7 @@ public:
 
 	void Update(int ntime, float dt, bool breset) override;
 
-	void UpdateTexture() override { m_Col.UpdateTexture(); }
+	void UpdateTexture() override { m_Col.UpdateTexture(); m_bvalidGlyphs = false; }
 
 	bool UpdateData(bool bsave = true) override;
 
@@ -114,8 +114,11 @@ public:
 	void Activate(bool b) override;
 
 private:
-	// render a vector n at position r
-	void RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph);
+	// add the glyph of vector v at position r
+	void AddVectorGlyph(GLGlyphBuilder& glyphs, const vec3f& r, vec3f v);
+
+	// rebuild the glyph meshes for the given items
+	void BuildGlyphs(const vector<int>& items);
 
 	void UpdateState(int nstate);
 
@@ -152,5 +155,11 @@ protected:
 	vec2f			m_staticRange;
 
 	float			m_fscale;	// total scale factor for rendering
+
+	GLTriMesh		m_glyphMesh;	// cached glyph geometry
+	GLLineMesh		m_lineMesh;		// cached line glyphs
+	vector<int>		m_glyphItems;	// items the cached glyphs were built for
+	float			m_glyphScale;	// scale factor the cached glyphs were built with
+	bool			m_bvalidGlyphs;	// are the cached glyphs up to date?
 };
 }
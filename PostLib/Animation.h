@@ -41,4 +41,15 @@ public:
 	virtual bool IsValid() = 0;
 	virtual void Close();
 	virtual int Frames() = 0;
+
+	// Returns true if the frames can be written in any order and from several
+	// threads at once with WriteFrame (e.g. image sequences).
+	virtual bool FramesAreIndependent() { return false; }
+
+	// write frame n. Only used when FramesAreIndependent returns true.
+	virtual int WriteFrame(QImage& im, int n) { return Write(im); }
+
+	// Returns true if a frame could not be written after Write returned, which can happen 
+	// when frames are written in the background. This should be checked after Close.
+	virtual bool WriteFailed() { return false; }
 };
@@ -0,0 +1,147 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "AnimationQueue.h"
+
+CAnimationQueue::CAnimationQueue(CAnimation* anim) : m_anim(anim)
+{
+	m_maxQueue = 1;
+	m_bopen = false;
+	m_bclosing = false;
+	m_bok = true;
+	m_nframes = 0;
+}
+
+CAnimationQueue::~CAnimationQueue()
+{
+	Close();
+	delete m_anim;
+}
+
+int CAnimationQueue::Create(const char* szfile, int cx, int cy, float fps)
+{
+	if (m_anim->Create(szfile, cx, cy, fps) == 0) return 0;
+
+	// Sequential encoders get one thread, independent frames as many as the 
+	// machine has (leaving one core for rendering).
+	int nthreads = 1;
+	if (m_anim->FramesAreIndependent())
+	{
+		nthreads = (int)std::thread::hardware_concurrency() - 1;
+		if (nthreads < 1) nthreads = 1;
+		if (nthreads > 8) nthreads = 8;
+	}
+
+	// allow a couple of frames per thread to be waiting
+	m_maxQueue = 2 * nthreads;
+	m_bopen = true;
+	m_bclosing = false;
+	m_bok = true;
+	m_nframes = 0;
+
+	for (int i = 0; i < nthreads; ++i) m_workers.push_back(std::thread([this]() { EncodeFrames(); }));
+
+	return 1;
+}
+
+int CAnimationQueue::Write(QImage& im)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_bok == false) return 0;
+	if (m_workers.empty())
+	{
+		if (m_anim->Write(im) == 0) m_bok = false;
+		return (m_bok ? 1 : 0);
+	}
+
+	// wait for room in the queue
+	m_frameTaken.wait(lock, [this]() { return (m_queue.size() < m_maxQueue) || (m_bok == false); });
+	if (m_bok == false) return 0;
+
+	FRAME f;
+	f.im = im;
+	f.n = m_nframes++;
+	m_queue.push_back(f);
+	lock.unlock();
+
+	m_frameAdded.notify_one();
+	return 1;
+}
+
+void CAnimationQueue::EncodeFrames()
+{
+	bool independent = m_anim->FramesAreIndependent();
+	while (true)
+	{
+		FRAME f;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_frameAdded.wait(lock, [this]() { return (m_queue.empty() == false) || m_bclosing; });
+			if (m_queue.empty()) return;
+
+			f = m_queue.front();
+			m_queue.pop_front();
+		}
+		m_frameTaken.notify_one();
+
+		int nret = (independent ? m_anim->WriteFrame(f.im, f.n) : m_anim->Write(f.im));
+		if (nret == 0)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_bok = false;
+			m_frameTaken.notify_all();
+		}
+	}
+}
+
+bool CAnimationQueue::WriteFailed()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return (m_bok == false);
+}
+
+bool CAnimationQueue::IsValid()
+{
+	return m_anim->IsValid();
+}
+
+void CAnimationQueue::Close()
+{
+	if (m_bopen == false) return;
+	m_bopen = false;
+
+	// let the workers finish the frames that are still queued
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_bclosing = true;
+	}
+	m_frameAdded.notify_all();
+	for (std::thread& t : m_workers) t.join();
+	m_workers.clear();
+
+	m_anim->Close();
+}
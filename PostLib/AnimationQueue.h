@@ -0,0 +1,78 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include "Animation.h"
+#include <QImage>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//-----------------------------------------------------------------------------
+//! Writes the frames of an animation on background threads. Write only copies
+//! the frame into a bounded queue (and waits when the queue is full), so the 
+//! caller is not blocked by compression or encoding. Animations with independent
+//! frames (image sequences) are encoded by several threads at once, others by 
+//! a single thread in frame order. Close waits until all frames are written.
+class CAnimationQueue : public CAnimation
+{
+	struct FRAME
+	{
+		QImage	im;
+		int		n;	// frame index
+	};
+
+public:
+	// The queue takes ownership of the animation
+	CAnimationQueue(CAnimation* anim);
+	~CAnimationQueue();
+
+	int Create(const char* szfile, int cx, int cy, float fps = 10.f) override;
+	int Write(QImage& im) override;
+	bool IsValid() override;
+	void Close() override;
+	int Frames() override { return m_nframes; }
+	bool WriteFailed() override;
+
+private:
+	void EncodeFrames();
+
+private:
+	CAnimation*	m_anim;		// the animation that does the actual writing
+
+	std::deque<FRAME>			m_queue;	// frames waiting to be written
+	size_t						m_maxQueue;	// max number of frames in the queue
+	std::vector<std::thread>	m_workers;	// encoder threads
+	std::mutex					m_mutex;
+	std::condition_variable		m_frameAdded;
+	std::condition_variable		m_frameTaken;
+	bool	m_bopen;	// the animation was created and not closed yet
+	bool	m_bclosing;	// set when the queue is closed
+	bool	m_bok;		// false when a frame failed to write
+	int		m_nframes;	// number of frames passed to Write
+};
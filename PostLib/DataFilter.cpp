@@ -30,11 +30,15 @@ SOFTWARE.*/
 #include "constants.h"
 #include "FEMeshData_T.h"
 #include "evaluate.h"
+#include <map>
+#include <algorithm>
 using namespace Post;
 using namespace std;
 
 bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 {
+	FEStateEditScope edit(fem);
+
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 	float fscale = (float) scale;
 	// loop over all states
@@ -394,6 +398,8 @@ bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
 //-----------------------------------------------------------------------------
 bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 {
+	FEStateEditScope edit(fem);
+
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
 	vec3f fscale = to_vec3f(scale);
@@ -559,147 +565,254 @@ bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
 }
 
 //-----------------------------------------------------------------------------
-// Apply a smoothing step operation on data
-bool DataSmoothStep(FEPostModel& fem, int nfield, double theta)
+// Node adjacency used by the smoothing filter, stored in compressed row format.
+// For each node it lists the nodes that share an element with it, weighted by 
+// the number of elements they share. The weighted sum over the neighbors thus
+// equals the element-by-element neighbor sum of the original scatter loop.
+class NodeSmoothAdjacency
 {
-	// loop over all states
-	int ndata = FIELD_CODE(nfield);
-	for (int n = 0; n<fem.GetStates(); ++n)
+public:
+	void Build(Post::FEPostMesh& mesh)
 	{
-		FEState& s = *fem.GetState(n);
-		Post::FEPostMesh& mesh = *s.GetFEMesh();
-		if (IS_NODE_FIELD(nfield))
+		int NN = mesh.Nodes();
+		FSNodeElementList NEL;
+		NEL.Build(&mesh);
+
+		// first pass counts the distinct neighbors, second pass fills them in
+		vector<int> cnt(NN, 0);
+		for (int pass = 0; pass < 2; ++pass)
 		{
-			int NN = mesh.Nodes();
-			Post::FEMeshData& d = s.m_Data[ndata];
-			
-			switch (d.GetType())
-			{
-			case DATA_FLOAT:
+			if (pass == 1)
 			{
-				vector<float> D; D.assign(NN, 0.f);
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<float>& data = dynamic_cast< Post::FENodeData<float>& >(d);
+				m_off.assign(NN + 1, 0);
+				for (int i = 0; i < NN; ++i) m_off[i + 1] = m_off[i] + cnt[i];
+				m_nbr.resize(m_off[NN]);
+				m_w.resize(m_off[NN]);
+				m_wsum.assign(NN, 0.f);
+			}
 
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i=0; i<NE; ++i)
+#pragma omp parallel
+			{
+				vector<int> buf;
+#pragma omp for schedule(dynamic, 256)
+				for (int i = 0; i < NN; ++i)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j=0; j<ne; ++j)
+					buf.clear();
+					NodeElemRange nel = NEL.ElementList(i);
+					for (const NodeElemRef& ref : nel)
 					{
-						float f = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
+						FEElement_& el = mesh.ElementRef(ref.eid);
+						int ne = el.Nodes();
+						for (int k = 0; k < ne; ++k)
 						{
-							int nk = el.m_node[k];
-							D[nk] += f;
-							tag[nk]++;
+							if (k != ref.nid) buf.push_back(el.m_node[k]);
 						}
 					}
-				}
+					std::sort(buf.begin(), buf.end());
 
-				// normalize 
-				for (int i=0; i<NN; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = (1.0 - theta)*data[i] + theta*D[i];  }
-			}
-			break;
-			case DATA_VEC3F:
-			{
-				vector<vec3f> D; D.assign(NN, vec3f(0.f, 0.f, 0.f));
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<vec3f>& data = dynamic_cast< Post::FENodeData<vec3f>& >(d);
-
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i = 0; i<NE; ++i)
-				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j = 0; j<ne; ++j)
+					int m = 0;
+					int n0 = (pass == 1 ? m_off[i] : 0);
+					for (size_t k = 0; k < buf.size(); )
 					{
-						vec3f v = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
+						size_t l = k + 1;
+						while ((l < buf.size()) && (buf[l] == buf[k])) ++l;
+						if (pass == 1)
 						{
-							int nk = el.m_node[k];
-							D[nk] += v;
-							tag[nk]++;
+							m_nbr[n0 + m] = buf[k];
+							m_w[n0 + m] = (float)(l - k);
 						}
+						m++;
+						k = l;
 					}
+					if (pass == 0) cnt[i] = m;
+					else m_wsum[i] = (float)buf.size();
 				}
-
-				// normalize 
-				for (int i = 0; i<NN; ++i) if (tag[i]>0) D[i] /= (float)tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = data[i] * (1.0 - theta) + D[i]*theta; }
-			}
-			break;
-			default:
-				return false;
 			}
 		}
-		else if (IS_ELEM_FIELD(nfield))
-		{
-			Post::FEMeshData& d = s.m_Data[ndata];
-			if ((d.GetFormat() == DATA_ITEM)&&(d.GetType() == DATA_FLOAT))
-			{
-				int NE = mesh.Elements();
+	}
 
-				vector<float> D; D.assign(NE, 0.f);
-				vector<int> tag; tag.assign(NE, 0);
-				Post::FEElementData<float, DATA_ITEM>& data = dynamic_cast< Post::FEElementData<float, DATA_ITEM>& >(d);
+public:
+	vector<int>		m_off;	// offset into m_nbr for each node (size = nodes + 1)
+	vector<int>		m_nbr;	// neighbor nodes
+	vector<float>	m_w;	// number of elements shared with the neighbor
+	vector<float>	m_wsum;	// sum of weights for each node
+};
 
-				for (int i=0; i<NE; ++i) mesh.ElementRef(i).m_ntag = i;
+//-----------------------------------------------------------------------------
+static void setZero(float& v) { v = 0.f; }
+static void setZero(vec3f& v) { v = vec3f(0.f, 0.f, 0.f); }
+static void setZero(mat3fs& v) { v = mat3fs(0.f, 0.f, 0.f, 0.f, 0.f, 0.f); }
 
-				// evaluate the average value of the neighbors
-				for (int i=0; i<NE; ++i)
+//-----------------------------------------------------------------------------
+// Smooth one state's node data. Each iteration is a gather over the neighbor 
+// list, reading from one buffer and writing the other, so nodes can be updated
+// in any order.
+template <typename T> static void SmoothNodeData(const NodeSmoothAdjacency& adj, Post::FENodeData<T>& data, float theta, int niters, bool bparallel)
+{
+	int NN = data.size();
+	vector<T> a(NN), b(NN);
+	for (int i = 0; i < NN; ++i) a[i] = data[i];
+
+	for (int n = 0; n < niters; ++n)
+	{
+#pragma omp parallel for if(bparallel) schedule(static)
+		for (int i = 0; i < NN; ++i)
+		{
+			T D; setZero(D);
+			if (adj.m_wsum[i] > 0.f)
+			{
+				for (int k = adj.m_off[i]; k < adj.m_off[i + 1]; ++k)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int nf = el.Faces();
-					for (int j=0; j<nf; ++j)
-					{
-						FEElement_* pj = mesh.ElementPtr(el.m_nbr[j]);
-						if (pj && (data.active(pj->m_ntag)))
-						{
-							float f;
-							data.eval(pj->m_ntag, &f);
-							D[i] += f;
-							tag[i]++;
-						}
-					}
+					T v = a[adj.m_nbr[k]];
+					v *= adj.m_w[k];
+					D += v;
 				}
+				D /= adj.m_wsum[i];
+			}
 
-				// normalize 
-				for (int i=0; i<NE; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
+			T v = a[i];
+			v *= (1.f - theta);
+			D *= theta;
+			v += D;
+			b[i] = v;
+		}
+		a.swap(b);
+	}
 
-				// assign to data field
-				for (int i = 0; i<NE; ++i) 
-					if (data.active(i))
-					{
-						float f;
-						data.eval(i, &f);
-						D[i] = (1.0 - theta)*f + theta*D[i];
-						data.set(i, D[i]);
-					}
+	for (int i = 0; i < NN; ++i) data[i] = a[i];
+}
+
+//-----------------------------------------------------------------------------
+// Smooth one state's element data by averaging the active face neighbors
+static void SmoothElemData(Post::FEPostMesh& mesh, Post::FEElementData<float, DATA_ITEM>& data, float theta, int niters, bool bparallel)
+{
+	int NE = mesh.Elements();
+	vector<float> a(NE, 0.f), b(NE, 0.f);
+	vector<char> act(NE, 0);
+	for (int i = 0; i < NE; ++i)
+	{
+		act[i] = (data.active(i) ? 1 : 0);
+		if (act[i]) data.eval(i, &a[i]);
+	}
+
+	for (int n = 0; n < niters; ++n)
+	{
+#pragma omp parallel for if(bparallel) schedule(static)
+		for (int i = 0; i < NE; ++i)
+		{
+			if (act[i] == 0) { b[i] = a[i]; continue; }
+
+			FEElement_& el = mesh.ElementRef(i);
+			float D = 0.f;
+			int tag = 0;
+			int nf = el.Faces();
+			for (int j = 0; j < nf; ++j)
+			{
+				int nj = el.m_nbr[j];
+				if ((nj >= 0) && act[nj])
+				{
+					D += a[nj];
+					tag++;
+				}
 			}
+			if (tag > 0) D /= (float)tag;
+
+			b[i] = (1.f - theta)*a[i] + theta*D;
 		}
+		a.swap(b);
 	}
 
-	return true;
+	for (int i = 0; i < NE; ++i)
+		if (act[i]) data.set(i, a[i]);
 }
 
 //-----------------------------------------------------------------------------
-// Apply a smoothing operation on data
+// Apply a smoothing operation on data. The node adjacency is built once for 
+// each mesh, after which all iterations of a state are done in one go. States 
+// are independent and are processed in parallel; a model with a single state 
+// is instead parallelized over its nodes or elements.
 bool Post::DataSmooth(FEPostModel& fem, int nfield, double theta, int niters)
 {
-	for (int n = 0; n<niters; ++n) 
+	FEStateEditScope edit(fem);
+
+	int ndata = FIELD_CODE(nfield);
+	int nstates = fem.GetStates();
+	if ((nstates == 0) || (niters <= 0)) return true;
+
+	// States are processed in parallel, unless they are paged in by a loader. In that case
+	// the states are processed one at a time (and the nodes or elements in parallel), 
+	// since loading is serialized anyway. The edit scope makes sure that smoothed states 
+	// are not released (and reloaded without the smoothing).
+	bool parallelStates = (nstates > 1) && (fem.GetStateLoader() == nullptr);
+
+	// check the data type first, so that we don't modify anything we can't process
+	Post::FEMeshData& d0 = fem.GetState(0)->m_Data[ndata];
+	if (IS_NODE_FIELD(nfield))
 	{
-		if (DataSmoothStep(fem, nfield, theta) == false) return false;
+		Data_Type ntype = d0.GetType();
+		if ((ntype != DATA_FLOAT) && (ntype != DATA_VEC3F) && (ntype != DATA_MAT3FS)) return false;
+
+		// build the adjacency for each of the meshes
+		std::map<Post::FEPostMesh*, NodeSmoothAdjacency> adjMap;
+		vector<NodeSmoothAdjacency*> adj(nstates);
+		for (int n = 0; n < nstates; ++n)
+		{
+			Post::FEPostMesh* mesh = fem.GetState(n)->GetFEMesh();
+			auto it = adjMap.find(mesh);
+			if (it == adjMap.end())
+			{
+				it = adjMap.insert(std::make_pair(mesh, NodeSmoothAdjacency())).first;
+				it->second.Build(*mesh);
+			}
+			adj[n] = &it->second;
+		}
+
+		bool bok = true;
+		bool bstates = parallelStates;
+#pragma omp parallel for if(bstates) schedule(dynamic)
+		for (int n = 0; n < nstates; ++n)
+		{
+			Post::FEMeshData& d = fem.GetState(n)->m_Data[ndata];
+			switch (ntype)
+			{
+			case DATA_FLOAT:
+			{
+				Post::FENodeData<float>* data = dynamic_cast<Post::FENodeData<float>*>(&d);
+				if (data) SmoothNodeData(*adj[n], *data, (float)theta, niters, !bstates); else bok = false;
+			}
+			break;
+			case DATA_VEC3F:
+			{
+				Post::FENodeData<vec3f>* data = dynamic_cast<Post::FENodeData<vec3f>*>(&d);
+				if (data) SmoothNodeData(*adj[n], *data, (float)theta, niters, !bstates); else bok = false;
+			}
+			break;
+			case DATA_MAT3FS:
+			{
+				Post::FENodeData<mat3fs>* data = dynamic_cast<Post::FENodeData<mat3fs>*>(&d);
+				if (data) SmoothNodeData(*adj[n], *data, (float)theta, niters, !bstates); else bok = false;
+			}
+			break;
+			default:
+				bok = false;
+			}
+		}
+		return bok;
+	}
+	else if (IS_ELEM_FIELD(nfield))
+	{
+		if ((d0.GetFormat() != DATA_ITEM) || (d0.GetType() != DATA_FLOAT)) return true;
+
+		bool bok = true;
+		bool bstates = parallelStates;
+#pragma omp parallel for if(bstates) schedule(dynamic)
+		for (int n = 0; n < nstates; ++n)
+		{
+			FEState& s = *fem.GetState(n);
+			Post::FEElementData<float, DATA_ITEM>* data = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&s.m_Data[ndata]);
+			if (data) SmoothElemData(*s.GetFEMesh(), *data, (float)theta, niters, !bstates); else bok = false;
+		}
+		return bok;
 	}
 
 	return true;
@@ -716,6 +829,8 @@ double flt_err(double d, double s) { return fabs(d - s); }
 //-----------------------------------------------------------------------------
 bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 {
+	FEStateEditScope edit(fem);
+
 	int ndst = FIELD_CODE(nfield);
 	int nsrc = FIELD_CODE(noperand);
 
@@ -913,6 +1028,8 @@ bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
 //-----------------------------------------------------------------------------
 bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
 {
+	FEStateEditScope edit(fem);
+
 	int nvec = FIELD_CODE(vecField);
 	int nscl = FIELD_CODE(sclField);
 
@@ -1282,6 +1399,8 @@ void extractElemDataComponentCOMP(Data_Type ntype, Post::FEMeshData& dst, Post::
 
 ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int ncomp, const std::string& sname)
 {
+	FEStateEditScope edit(fem);
+
 	if (pdf == 0) return 0;
 
 	int nclass = pdf->DataClass();
@@ -1362,6 +1481,8 @@ ModelDataField* Post::DataComponent(FEPostModel& fem, ModelDataField* pdf, int n
 // Calculate the fractional anisotropy of a tensor field
 bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorField)
 {
+	FEStateEditScope edit(fem);
+
 	int ntns = FIELD_CODE(tensorField);
 	int nscl = FIELD_CODE(scalarField);
 
@@ -1414,6 +1535,8 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 // convert between formats
 ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, int newClass, int newFormat, const std::string& name)
 {
+	FEStateEditScope edit(fem);
+
 	if (dataField == nullptr) return nullptr;
 
 	int nclass = dataField->DataClass();
@@ -1924,6 +2047,8 @@ ModelDataField* Post::DataConvert(FEPostModel& fem, ModelDataField* dataField, i
 
 ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataField, const std::string& name)
 {
+	FEStateEditScope edit(fem);
+
 	int dataType = dataField->Type();
 	int nfmt = dataField->Format();
 	int nclass = dataField->DataClass();
@@ -1973,6 +2098,8 @@ ModelDataField* Post::DataEigenTensor(FEPostModel& fem, ModelDataField* dataFiel
 
 ModelDataField* Post::DataTimeRate(FEPostModel& fem, ModelDataField* dataField, const std::string& name)
 {
+	FEStateEditScope edit(fem);
+
 	if (dataField == nullptr) return nullptr;
 
 	int nclass = dataField->DataClass();
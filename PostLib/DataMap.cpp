@@ -30,6 +30,94 @@ SOFTWARE.*/
 #include <assert.h>
 using namespace Post;
 
+//-----------------------------------------------------------------------------
+DataMapBudget::DataMapBudget()
+{
+	m_used = 0;
+	m_limit = 0;
+}
+
+//-----------------------------------------------------------------------------
+DataMapBudget* DataMapBudget::Shared()
+{
+	static DataMapBudget budget;
+	return &budget;
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBudget::SetLimit(size_t bytes)
+{
+	m_limit = bytes;
+	Trim();
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBudget::Touch(DataMapBase* map, int state, size_t bytes)
+{
+	if (state >= (int)map->m_inBudget.size())
+	{
+		map->m_inBudget.resize(state + 1, false);
+		map->m_lruPos.resize(state + 1);
+	}
+
+	if (map->m_inBudget[state])
+	{
+		// move it to the front
+		auto it = map->m_lruPos[state];
+		m_used -= it->bytes;
+		it->bytes = bytes;
+		m_used += bytes;
+		if (it != m_lru.begin()) m_lru.splice(m_lru.begin(), m_lru, it);
+	}
+	else
+	{
+		Entry e = { map, state, bytes };
+		m_lru.push_front(e);
+		map->m_lruPos[state] = m_lru.begin();
+		map->m_inBudget[state] = true;
+		m_used += bytes;
+	}
+
+	Trim();
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBudget::Remove(DataMapBase* map, int state)
+{
+	if ((state >= (int)map->m_inBudget.size()) || (map->m_inBudget[state] == false)) return;
+
+	auto it = map->m_lruPos[state];
+	m_used -= it->bytes;
+	m_lru.erase(it);
+	map->m_inBudget[state] = false;
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBudget::Trim()
+{
+	if (m_limit == 0) return;
+
+	// always keep the two most recently used states
+	while ((m_used > m_limit) && (m_lru.size() > 2))
+	{
+		Entry e = m_lru.back();
+		Remove(e.map, e.state);
+		e.map->ReleaseState(e.state);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBase::TouchState(int n, size_t bytes)
+{
+	if (m_budget) m_budget->Touch(this, n, bytes);
+}
+
+//-----------------------------------------------------------------------------
+void DataMapBase::ForgetState(int n)
+{
+	if (m_budget) m_budget->Remove(this, n);
+}
+
 //-----------------------------------------------------------------------------
 // this function calculates the gradient map of the current evaluated
 // values at the nodes.
@@ -40,7 +128,7 @@ void VectorMap::Gradient(int ntime, std::vector<float> &v)
 {
 	assert(m_pmesh);
 	if (m_pmesh == 0) return;
-	std::vector<vec3f>& G = m_Data[ntime];
+	std::vector<vec3f>& G = State(ntime);
 	FEPostMesh& mesh = *m_pmesh;
 
 	int i, k;
@@ -161,7 +249,7 @@ void VectorMap::Gradient(int ntime, std::vector<float> &v)
 	// "normalize" the gradients
 	for (i=0; i<mesh.Nodes(); i++)
 	{
-		const std::vector<NodeElemRef>& nel = mesh.NodeElemList(i);
+		NodeElemRange nel = mesh.NodeElemList(i);
 		if (!nel.empty()) G[i] /= (float) nel.size();
 		G[i] *= -1;
 	}
@@ -28,20 +28,112 @@ SOFTWARE.*/
 #include <FSCore/math3d.h>
 #include <vector>
 
+#include <list>
+
 namespace Post {
 class FEPostMesh;
+class DataMapBase;
+
+//-----------------------------------------------------------------------------
+// Memory budget that can be shared by several data maps. When the allocated
+// state data of the maps goes over the limit, the least recently used states 
+// are released. The two most recently used states are always kept, so that a
+// caller can work with two states at once (e.g. to interpolate between them).
+class DataMapBudget
+{
+	struct Entry {
+		DataMapBase*	map;
+		int				state;
+		size_t			bytes;
+	};
+
+public:
+	DataMapBudget();
+
+	// the budget that is shared by the post plots
+	static DataMapBudget* Shared();
+
+	// set the memory limit (in bytes, 0 = no limit)
+	void SetLimit(size_t bytes);
+	size_t GetLimit() const { return m_limit; }
+
+	// memory used by the states in this budget
+	size_t MemoryUsage() const { return m_used; }
+
+private:
+	// mark a state as used (adds it when needed) and release old states when over the limit
+	void Touch(DataMapBase* map, int state, size_t bytes);
+
+	// remove a state (e.g. because its map released it)
+	void Remove(DataMapBase* map, int state);
+
+	void Trim();
+
+private:
+	std::list<Entry>	m_lru;		// most recently used states first
+	size_t	m_used;
+	size_t	m_limit;
+
+	friend class DataMapBase;
+};
+
+//-----------------------------------------------------------------------------
+// base class of data maps, which handles the bookkeeping with the budget
+class DataMapBase
+{
+public:
+	DataMapBase() { m_budget = nullptr; }
+	virtual ~DataMapBase() {}
+
+	// Assign a budget. This must be done before the map is created.
+	void SetBudget(DataMapBudget* budget) { m_budget = budget; }
+
+protected:
+	// called when a state is accessed
+	void TouchState(int n, size_t bytes);
+
+	// called when a state is released by the map itself
+	void ForgetState(int n);
+
+	// release the data of a state. Called by the budget.
+	virtual void ReleaseState(int n) = 0;
+
+protected:
+	DataMapBudget*	m_budget;
+	std::vector<std::list<DataMapBudget::Entry>::iterator>	m_lruPos;	// position of each state in the budget's list
+	std::vector<bool>	m_inBudget;
+
+	friend class DataMapBudget;
+};
 
 //-----------------------------------------------------------------------------
+// Stores item values for each state of a model. The values of a state are only
+// allocated when the state is first accessed. When a state is released by the
+// budget its tag is reset, so that the owner evaluates it again.
 template <typename T>
-class DataMap
+class DataMap : public DataMapBase
 {
 public:
-	DataMap(void) { m_pmesh = 0; }
-	~DataMap(void) {}
+	DataMap(void) { m_pmesh = 0; m_items = 0; m_ntag = 0; }
+	~DataMap(void) { Clear(); }
 
 	int States() { return (int)m_Data.size(); }
-	std::vector<T>& State(int n) { return m_Data[n]; }
-	int GetTag(int n) { return m_tag[n]; }
+	std::vector<T>& State(int n)
+	{
+		std::vector<T>& d = m_Data[n];
+		if (d.empty()) d.assign(m_items, m_val);
+		TouchState(n, d.capacity() * sizeof(T));
+		return d;
+	}
+	// Checking the tag counts as a use of the state, since the owner uses the 
+	// state's values when the tag is valid. This keeps the budget from releasing
+	// a state that was checked while another state is evaluated.
+	int GetTag(int n)
+	{
+		const std::vector<T>& d = m_Data[n];
+		if (!d.empty()) TouchState(n, d.capacity() * sizeof(T));
+		return m_tag[n];
+	}
 	void SetTag(int n, int ntag) { m_tag[n] = ntag; }
 	void SetTags(int n)
 	{
@@ -50,19 +142,36 @@ public:
 
 	void Create(int nstates, int items, T val = T(0), int ntag = 0)
 	{
+		Clear();
+		m_items = items;
+		m_val = val;
+		m_ntag = ntag;
 		m_tag.assign(nstates, ntag);
 		m_Data.resize(nstates);
-		for (int i=0; i<nstates; ++i) m_Data[i].assign(items, val);
 	}
 
-	void Clear() { m_Data.clear(); m_tag.clear(); }
+	void Clear()
+	{
+		for (int i = 0; i < (int)m_Data.size(); ++i) ForgetState(i);
+		m_Data.clear(); m_tag.clear();
+	}
 
 	void SetFEMesh(FEPostMesh* pm) { m_pmesh = pm; }
 
+protected:
+	void ReleaseState(int n) override
+	{
+		std::vector<T>().swap(m_Data[n]);
+		m_tag[n] = m_ntag;
+	}
+
 protected:
 	std::vector<int>	m_tag;
 	std::vector< std::vector<T> >	m_Data;
 	FEPostMesh*	m_pmesh;
+	int		m_items;	// number of items per state
+	T		m_val;		// initial value
+	int		m_ntag;		// initial tag
 };
 
 //-----------------------------------------------------------------------------
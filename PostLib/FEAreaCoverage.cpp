@@ -85,6 +85,29 @@ void FEAreaCoverage::Surface::Create(Post::FEPostMesh& mesh)
 			m_NLT[inode].push_back(i);
 		}
 	}
+
+	// the hierarchy is built on the first update
+	m_bvh.Clear();
+}
+
+//-----------------------------------------------------------------------------
+void FEAreaCoverage::Surface::UpdateBVH(Post::FEPostMesh& mesh)
+{
+	const int MN = FSFace::MAX_NODES;
+	int NF = Faces();
+	vector<BOX> box(NF);
+	for (int i = 0; i < NF; ++i)
+	{
+		FSFace& f = mesh.Face(m_face[i]);
+		vec3d r0 = to_vec3d(m_pos[m_lnode[i*MN]]);
+		BOX& b = box[i];
+		b = BOX(r0, r0);
+		for (int j = 1; j < f.Nodes(); ++j) b += to_vec3d(m_pos[m_lnode[i*MN + j]]);
+	}
+
+	// the topology doesn't change between states, so we only need to refit
+	if (m_bvh.IsEmpty()) m_bvh.Build(box);
+	else m_bvh.Refit(box);
 }
 
 //-----------------------------------------------------------------------------
@@ -255,6 +278,9 @@ void FEAreaCoverage::UpdateSurface(FEAreaCoverage::Surface& s, int nstate)
 		}
 	}
 	for (int i=0; i<(int)s.m_norm.size(); ++i) s.m_norm[i].Normalize();
+
+	// update the face hierarchy
+	s.UpdateBVH(mesh);
 }
 
 //-----------------------------------------------------------------------------
@@ -298,24 +324,23 @@ bool FEAreaCoverage::intersect(const vec3f& r, const vec3f& N, FEAreaCoverage::S
 	vec3d rd = to_vec3d(r);
 	Ray ray = {rd, to_vec3d(N)};
 
-	// loop over all facets connected to this node
+	// find the closest facet that intersects the ray. Back intersections are
+	// found by casting along the entire line. 
 	Intersection q;
 	int imin = -1;
-	double Lmin;
-	for (int i = 0; i<(int)surf.m_face.size(); ++i)
-	{
+	double Lmin = 0.0;
+	surf.m_bvh.ClosestHit(ray.origin, ray.direction, m_ballowBackIntersections, [&](int i, double& L) {
 		// see if the ray intersects this face
-		if (faceIntersect(surf, ray, i, q))
+		if (faceIntersect(surf, ray, i, q) == false) return false;
+		L = (q.point - rd).Length();
+		if ((imin == -1) || (L < Lmin))
 		{
-			double L = (q.point - rd).Length();
-			if ((imin == -1) || (L < Lmin))
-			{
-				imin = i;
-				Lmin = L;
-				qmin = q;
-			}
+			imin = i;
+			Lmin = L;
+			qmin = q;
 		}
-	}
+		return true;
+	});
 
 	return (imin != -1);
 }
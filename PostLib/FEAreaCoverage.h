@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include "FEPostMesh.h"
 #include <MeshLib/Intersect.h>
+#include <MeshLib/FEFaceBVH.h>
 #include <vector>
 #include <string>
 #include "FEDataField.h"
@@ -47,6 +48,9 @@ class FEAreaCoverage : public ModelDataField
 
 		int Nodes() { return (int)m_node.size(); }
 
+		// update the face hierarchy for the current node positions
+		void UpdateBVH(FEPostMesh& mesh);
+
 	public:
 		vector<int>		m_face;		// face list
 		vector<int>		m_node;		// node list
@@ -56,6 +60,8 @@ class FEAreaCoverage : public ModelDataField
 		vector<vec3f>	m_fnorm;	// face normals
 
 		vector<vector<int> >	m_NLT;	// node-facet look-up table
+
+		FSFaceBVH		m_bvh;		// face hierarchy for ray casting
 	};
 
 public:
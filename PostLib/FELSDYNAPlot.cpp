@@ -526,7 +526,7 @@ bool FELSDYNAPlotImport::ReadStates(FEPostModel& fem)
 					}
 
 					// load shell stress data
-					ELEMDATA* pe = &pstate->m_ELEM[0] + (m_hdr.nel8 + m_hdr.nel2);
+					int ne0 = m_hdr.nel8 + m_hdr.nel2;
 					for (int i=0; i<m_hdr.nel4; i++, pf += m_hdr.nv2d)
 					{
 						int n = i + m_hdr.nel8 + m_hdr.nel2;
@@ -534,10 +534,8 @@ bool FELSDYNAPlotImport::ReadStates(FEPostModel& fem)
 						s.add(n, m);
 						ps.add(n, pf[6]);
 						p.add(n, -m.tr()/3.f);
-						pe[i].m_h[0] = pf[29];
-						pe[i].m_h[1] = pf[29];
-						pe[i].m_h[2] = pf[29];
-						pe[i].m_h[3] = pf[29];
+						float* h = pstate->m_ELEM[ne0 + i].m_h;
+						if (h) h[0] = h[1] = h[2] = h[3] = pf[29];
 
 						if (m_hdr.nv2d == 44)
 						{
@@ -411,16 +411,18 @@ bool FELSDYNAimport::BuildMesh(FEPostModel& fem)
 	{
 		int nel8 = m_solid.size();
 		int nel2 = 0;	// we don't read beams yet
-		ELEMDATA* pd = &ps->m_ELEM[0] + (nel8 + nel2);
+		int ne0 = nel8 + nel2;
 
 		list<ELEMENT_SHELL>::iterator pe = m_shell.begin();
 		for (i=0; i<(int) m_shell.size(); ++i, ++pe)
 		{
 			double* h = pe->h;
-			pd[i].m_h[0] = (float) h[0];
-			pd[i].m_h[1] = (float) h[1];
-			pd[i].m_h[2] = (float) h[2];
-			pd[i].m_h[3] = (float) h[3];
+			float* hi = ps->m_ELEM[ne0 + i].m_h;
+			if (hi == nullptr) continue;
+			hi[0] = (float) h[0];
+			hi[1] = (float) h[1];
+			hi[2] = (float) h[2];
+			hi[3] = (float) h[3];
 		}
 
 		FEElementData<float,DATA_COMP>& d = dynamic_cast<FEElementData<float,DATA_COMP>&>(ps->m_Data[0]);
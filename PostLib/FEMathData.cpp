@@ -31,80 +31,138 @@ SOFTWARE.*/
 
 using namespace Post;
 
-FEMathData::FEMathData(FEState* state, FEMathDataField* pdf) : FENodeData_T<float>(state, pdf)
+//-----------------------------------------------------------------------------
+FEMathExpression::FEMathExpression()
 {
-	m_pdf = pdf;
+	m_bvalid = false;
 }
 
-// evaluate all the nodal data for this state
-void FEMathData::eval(int n, float* pv)
+FEMathExpression::FEMathExpression(const FEMathExpression& m)
 {
-	FEPostModel& fem = *GetFSModel();
+	m_bvalid = false;
+	Create(m.m_eq);
+}
 
+void FEMathExpression::operator = (const FEMathExpression& m)
+{
+	Create(m.m_eq);
+}
 
-	double time = m_state->m_time;
+void FEMathExpression::Create(const std::string& eq)
+{
+	m_eq = eq;
+
+	// the order of the variables must match the order of the values passed to value
+	m_math.Clear();
+	m_math.AddVariable("x");
+	m_math.AddVariable("y");
+	m_math.AddVariable("z");
+	m_math.AddVariable("t");
+	m_bvalid = (eq.empty() ? false : m_math.Create(eq));
+}
 
-	FEPostMesh& mesh = *m_state->GetFEMesh();
+double FEMathExpression::value(const std::vector<double>& var) const
+{
+	return (m_bvalid ? m_math.value_s(var) : 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// Get the current positions of all nodes of a state. This returns the state's time.
+static double get_node_positions(FEPostModel& fem, FEState& state, std::vector<vec3f>& r)
+{
+	int ntime = state.GetID();
+	int N = state.GetFEMesh()->Nodes();
+	r.resize(N);
+	for (int i = 0; i < N; ++i) r[i] = fem.NodePosition(i, ntime);
+	return (double)state.m_time;
+}
 
-	MSimpleExpression math;
-	math.AddVariable("t", time);
+//-----------------------------------------------------------------------------
+FEMathData::FEMathData(FEState* state, FEMathDataField* pdf) : FENodeData_T<float>(state, pdf)
+{
+	m_pdf = pdf;
+}
 
-	int ierr;
-	FSNode& node = mesh.Node(n);
+// evaluate the nodal data for this state
+void FEMathData::eval(int n, float* pv)
+{
+	FEPostModel& fem = *GetFSModel();
 
 	vec3f r = fem.NodePosition(n, m_state->GetID());
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
-
-	const std::string& eq = m_pdf->EquationString();
-	math.Create(eq);
+	std::vector<double> var = { (double)r.x, (double)r.y, (double)r.z, (double)m_state->m_time };
 
-	double v = math.value();
+	double v = m_pdf->Expression().value(var);
 
 	if (pv) *pv = (float) v;
 }
 
+// evaluate all the nodal data for this state
+void FEMathData::eval_all(float* pv)
+{
+	std::vector<vec3f> r;
+	double t = get_node_positions(*GetFSModel(), *m_state, r);
 
+	const FEMathExpression& math = m_pdf->Expression();
+	int N = (int)r.size();
+#pragma omp parallel
+	{
+		std::vector<double> var(4, t);
+#pragma omp for schedule(static)
+		for (int i = 0; i < N; ++i)
+		{
+			var[0] = r[i].x; var[1] = r[i].y; var[2] = r[i].z;
+			pv[i] = (float)math.value(var);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
 FEMathVec3Data::FEMathVec3Data(FEState* state, FEMathVec3DataField* pdf) : FENodeData_T<vec3f>(state, pdf)
 {
 	m_pdf = pdf;
 }
 
-// evaluate all the nodal data for this state
+// evaluate the nodal data for this state
 void FEMathVec3Data::eval(int n, vec3f* pv)
 {
 	FEPostModel& fem = *GetFSModel();
 
-	FEState& state = *m_state;
-	int ntime = state.GetID();
-	double time = (double)state.m_time;
-
-	FEPostMesh& mesh = *state.GetFEMesh();
-
-	MSimpleExpression math;
-	math.AddVariable("t", time);
-
-	int ierr;
-	FSNode& node = mesh.Node(n);
-
-	vec3f r = fem.NodePosition(n, ntime);
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
-
-	const std::string& x = m_pdf->EquationString(0);
-	const std::string& y = m_pdf->EquationString(1);
-	const std::string& z = m_pdf->EquationString(2);
+	vec3f r = fem.NodePosition(n, m_state->GetID());
+	std::vector<double> var = { (double)r.x, (double)r.y, (double)r.z, (double)m_state->m_time };
 
 	vec3f v;
-	v.x = (float)math.value(x);
-	v.y = (float)math.value(y);
-	v.z = (float)math.value(z);
+	v.x = (float)m_pdf->Expression(0).value(var);
+	v.y = (float)m_pdf->Expression(1).value(var);
+	v.z = (float)m_pdf->Expression(2).value(var);
 
 	if (pv) *pv = v;
 }
 
+// evaluate all the nodal data for this state
+void FEMathVec3Data::eval_all(vec3f* pv)
+{
+	std::vector<vec3f> r;
+	double t = get_node_positions(*GetFSModel(), *m_state, r);
+
+	const FEMathExpression& mx = m_pdf->Expression(0);
+	const FEMathExpression& my = m_pdf->Expression(1);
+	const FEMathExpression& mz = m_pdf->Expression(2);
+	int N = (int)r.size();
+#pragma omp parallel
+	{
+		std::vector<double> var(4, t);
+#pragma omp for schedule(static)
+		for (int i = 0; i < N; ++i)
+		{
+			var[0] = r[i].x; var[1] = r[i].y; var[2] = r[i].z;
+			pv[i].x = (float)mx.value(var);
+			pv[i].y = (float)my.value(var);
+			pv[i].z = (float)mz.value(var);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
 FEMathMat3Data::FEMathMat3Data(FEState* state, FEMathMat3DataField* pdf) : FENodeData_T<mat3f>(state, pdf)
 {
 	m_pdf = pdf;
@@ -117,29 +175,35 @@ void FEMathMat3Data::eval(int n, mat3f* pv)
 
 	FEPostModel& fem = *GetFSModel();
 
-	FEState& state = *m_state;
-	int ntime = state.GetID();
-	double time = (double)state.m_time;
-
-	FEPostMesh& mesh = *state.GetFEMesh();
-
-	MSimpleExpression math;
-	math.AddVariable("t", time);
-
-	int ierr;
-	FSNode& node = mesh.Node(n);
-
-	vec3f r = fem.NodePosition(n, ntime);
-	math.AddVariable("x", (double)r.x);
-	math.AddVariable("y", (double)r.y);
-	math.AddVariable("z", (double)r.z);
+	vec3f r = fem.NodePosition(n, m_state->GetID());
+	std::vector<double> var = { (double)r.x, (double)r.y, (double)r.z, (double)m_state->m_time };
 
 	float m[9] = { 0.f };
 	for (int i = 0; i < 9; ++i)
 	{
-		const std::string& eq = m_pdf->EquationString(i);
-		m[i] = (float) math.value(eq);
+		m[i] = (float) m_pdf->Expression(i).value(var);
 	}
 
 	*pv = mat3f(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
 }
+
+// evaluate all the nodal data for this state
+void FEMathMat3Data::eval_all(mat3f* pv)
+{
+	std::vector<vec3f> r;
+	double t = get_node_positions(*GetFSModel(), *m_state, r);
+
+	int N = (int)r.size();
+#pragma omp parallel
+	{
+		std::vector<double> var(4, t);
+		float m[9];
+#pragma omp for schedule(static)
+		for (int i = 0; i < N; ++i)
+		{
+			var[0] = r[i].x; var[1] = r[i].y; var[2] = r[i].z;
+			for (int j = 0; j < 9; ++j) m[j] = (float)m_pdf->Expression(j).value(var);
+			pv[i] = mat3f(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+		}
+	}
+}
@@ -26,9 +26,36 @@ SOFTWARE.*/
 
 #pragma once
 #include "FEMeshData_T.h"
+#include <FECore/MathObject.h>
 
 namespace Post {
 
+//-----------------------------------------------------------------------------
+// Math expression of the nodal coordinates (x, y, z) and the time (t). The 
+// expression is parsed when it is set, so that it can be evaluated many times 
+// without parsing it again. Evaluating does not modify the expression, so 
+// multiple threads can evaluate it at the same time.
+class FEMathExpression
+{
+public:
+	FEMathExpression();
+	FEMathExpression(const FEMathExpression& m);
+	void operator = (const FEMathExpression& m);
+
+	// set and parse the expression
+	void Create(const std::string& eq);
+
+	const std::string& String() const { return m_eq; }
+
+	// evaluate the expression. var must contain the values of (x, y, z, t).
+	double value(const std::vector<double>& var) const;
+
+private:
+	std::string			m_eq;
+	MSimpleExpression	m_math;
+	bool				m_bvalid;
+};
+
 class FEMathDataField;
 class FEMathVec3DataField;
 class FEMathMat3DataField;
@@ -41,6 +68,9 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, float* pv) override;
 
+	// evaluate the nodal data for all nodes
+	void eval_all(float* pv) override;
+
 private:
 	FEMathDataField*	m_pdf;
 };
@@ -53,6 +83,9 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, vec3f* pv) override;
 
+	// evaluate the nodal data for all nodes
+	void eval_all(vec3f* pv) override;
+
 private:
 	FEMathVec3DataField*	m_pdf;
 };
@@ -65,6 +98,9 @@ public:
 	// evaluate the nodal data for this state
 	void eval(int n, mat3f* pv) override;
 
+	// evaluate the nodal data for all nodes
+	void eval_all(mat3f* pv) override;
+
 private:
 	FEMathMat3DataField*	m_pdf;
 };
@@ -74,7 +110,6 @@ class FEMathDataField : public ModelDataField
 public:
 	FEMathDataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_FLOAT, DATA_NODE, CLASS_NODE, flag)
 	{
-		m_eq = "";
 	}
 
 	//! Create a copy
@@ -91,12 +126,14 @@ public:
 		return new FEMathData(pstate, this);
 	}
 
-	void SetEquationString(const std::string& eq) { m_eq = eq; }
+	void SetEquationString(const std::string& eq) { m_eq.Create(eq); }
 
-	const std::string& EquationString() const { return m_eq; }
+	const std::string& EquationString() const { return m_eq.String(); }
+
+	const FEMathExpression& Expression() const { return m_eq; }
 
 private:
-	std::string	m_eq;		//!< equation string
+	FEMathExpression	m_eq;		//!< equation
 };
 
 class FEMathVec3DataField : public ModelDataField
@@ -104,9 +141,6 @@ class FEMathVec3DataField : public ModelDataField
 public:
 	FEMathVec3DataField(Post::FEPostModel* fem, unsigned int flag = 0) : ModelDataField(fem, DATA_VEC3F, DATA_NODE, CLASS_NODE, flag)
 	{
-		m_eq[0] = "";
-		m_eq[1] = "";
-		m_eq[2] = "";
 	}
 
 	//! Create a copy
@@ -127,17 +161,19 @@ public:
 
 	void SetEquationStrings(const std::string& x, const std::string& y, const std::string& z)
 	{
-		m_eq[0] = x; 
-		m_eq[1] = y;
-		m_eq[2] = z;
+		m_eq[0].Create(x); 
+		m_eq[1].Create(y);
+		m_eq[2].Create(z);
 	}
 
-	void SetEquationString(int n, const std::string& eq) { m_eq[n] = eq; }
+	void SetEquationString(int n, const std::string& eq) { m_eq[n].Create(eq); }
+
+	const std::string& EquationString(int n) const { return m_eq[n].String(); }
 
-	const std::string& EquationString(int n) const { return m_eq[n]; }
+	const FEMathExpression& Expression(int n) const { return m_eq[n]; }
 
 private:
-	std::string	m_eq[3];		//!< equation string
+	FEMathExpression	m_eq[3];		//!< equations
 };
 
 class FEMathMat3DataField : public ModelDataField
@@ -166,16 +202,18 @@ public:
 		const std::string& m10, const std::string& m11, const std::string& m12,
 		const std::string& m20, const std::string& m21, const std::string& m22)
 	{
-		m_eq[0] = m00; m_eq[1] = m01; m_eq[2] = m02;
-		m_eq[3] = m10; m_eq[4] = m11; m_eq[5] = m12;
-		m_eq[6] = m20; m_eq[7] = m21; m_eq[8] = m22;
+		m_eq[0].Create(m00); m_eq[1].Create(m01); m_eq[2].Create(m02);
+		m_eq[3].Create(m10); m_eq[4].Create(m11); m_eq[5].Create(m12);
+		m_eq[6].Create(m20); m_eq[7].Create(m21); m_eq[8].Create(m22);
 	}
 
-	void SetEquationString(int n, const std::string& eq) { m_eq[n] = eq; }
+	void SetEquationString(int n, const std::string& eq) { m_eq[n].Create(eq); }
+
+	const std::string& EquationString(int n) const { return m_eq[n].String(); }
 
-	const std::string& EquationString(int n) const { return m_eq[n]; }
+	const FEMathExpression& Expression(int n) const { return m_eq[n]; }
 
 private:
-	std::string	m_eq[9];		//!< equation string
+	FEMathExpression	m_eq[9];		//!< equations
 };
 }
@@ -1802,7 +1802,14 @@ void SurfaceCongruency::set_facelist(vector<int>& L)
 //-----------------------------------------------------------------------------
 void SurfaceCongruency::eval(int n, float* f)
 {
-	FEPointCongruency map;
+	FEPointCongruency& map = m_map;
+
+	// The faces are evaluated in order, so a new evaluation pass starts when the face
+	// index does not increase. The nodes may have moved since the last pass (e.g. by
+	// the displacement map), so the search structures need to be updated.
+	if (n <= m_lastFace) map.Refit();
+	m_lastFace = n;
+
 	map.SetLevels(m_nlevels);
 	map.m_nmax = m_nmax;
 	map.m_bext = m_bext;
@@ -1827,10 +1834,10 @@ void FEFacetArea::eval(int n, float* f)
 	FEPostMesh* pmesh = GetFEMesh();
 	FSFace& face = pmesh->Face(n);
 
-	std::vector<Post::NODEDATA>& data = m_state->m_NODE;
+	const std::vector<vec3f>& rt = m_state->m_NODE.m_rt;
 
 	vector<vec3d> r(face.Nodes());
-	for (int i = 0; i < face.Nodes(); ++i) r[i] = to_vec3d(data[face.n[i]].m_rt);
+	for (int i = 0; i < face.Nodes(); ++i) r[i] = to_vec3d(rt[face.n[i]]);
 
 	// NOTE: Passing the face type doesn't work! 
 	f[0] = (float)pmesh->FaceArea(r, face.Nodes());
@@ -30,7 +30,9 @@ SOFTWARE.*/
 #include "FEState.h"
 #include "FEPostMesh.h"
 #include "FEDataField.h"
+#include "FEPointCongruency.h"
 #include <set>
+#include <algorithm>
 //using namespace std;
 
 namespace Post {
@@ -110,6 +112,13 @@ public:
 	virtual void eval(int n, T* pv) = 0;
 	virtual bool active(int n) { return true; }
 
+	// evaluate all nodes (pv must be large enough to hold the values of all nodes)
+	virtual void eval_all(T* pv)
+	{
+		int N = m_state->GetFEMesh()->Nodes();
+		for (int i = 0; i < N; ++i) eval(i, pv + i);
+	}
+
 	static Data_Type Type  () { return FEMeshDataTraits<T>::Type  (); }
 	static Data_Format Format() { return DATA_ITEM; }
 	static Data_Class Class() { return CLASS_NODE; }
@@ -123,6 +132,7 @@ template <typename T> class FENodeData : public FENodeData_T<T>
 public:
 	FENodeData(FEState* state, ModelDataField* pdf) : FENodeData_T<T>(state, pdf) { m_data.resize(state->GetFEMesh()->Nodes()); }
 	void eval(int n, T* pv) { (*pv) = m_data[n]; }
+	void eval_all(T* pv) { std::copy(m_data.begin(), m_data.end(), pv); }
 	void copy(FENodeData<T>& d) { m_data = d.m_data; }
 
 	int size() const { return (int) m_data.size(); }
@@ -804,7 +814,7 @@ public:
 class SurfaceCongruency : public FEFaceData_T<float, DATA_NODE>
 {
 public:
-	SurfaceCongruency(FEState* state, ModelDataField* pdf) : FEFaceData_T<float, DATA_NODE>(state, pdf) { m_face.assign(state->GetFEMesh()->Faces(), 1); }
+	SurfaceCongruency(FEState* state, ModelDataField* pdf) : FEFaceData_T<float, DATA_NODE>(state, pdf) { m_face.assign(state->GetFEMesh()->Faces(), 1); m_lastFace = -1; }
 
 	bool active(int n) { return (m_face[n] == 1); }
 
@@ -815,6 +825,9 @@ protected:
 
 	std::vector<int> m_face;
 
+	FEPointCongruency	m_map;	// keeps the search structures between evaluations
+	int					m_lastFace;	// last face that was evaluated
+
 public:
 	static int m_nlevels;
 	static int m_nmax;
@@ -37,6 +37,22 @@ FEPointCongruency::FEPointCongruency()
 	m_nlevels = 1;
 	m_nmax = 1;
 	m_bext = 0;
+	m_mesh = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void FEPointCongruency::Reset()
+{
+	m_mesh = nullptr;
+	m_NFL.Clear();
+	m_bvh.Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Update the search structures after the nodes of the mesh moved.
+void FEPointCongruency::Refit()
+{
+	if (m_mesh) m_bvh.Refit(*m_mesh);
 }
 
 //-----------------------------------------------------------------------------
@@ -54,11 +70,15 @@ FEPointCongruency::CONGRUENCY_DATA FEPointCongruency::Congruency(FSMesh* mesh, i
 	d.Kemax = 0;
 	d.nface = -1;
 
-	// store a pointer to the mesh
-	m_mesh = mesh;
 	if (mesh == nullptr) return d;
 
-	m_NFL.Build(m_mesh);
+	// build the search structures
+	if (mesh != m_mesh)
+	{
+		m_mesh = mesh;
+		m_NFL.Build(m_mesh);
+		m_bvh.Build(*m_mesh);
+	}
 
 	// find the projection of the node onto the opposing surface
 	vec3f q, sn;
@@ -135,14 +155,11 @@ bool FEPointCongruency::Project(int nid, int& nface, vec3f& q, double rs[2], vec
 
 	// find the normal at this node
 	sn = vec3f(0.f, 0.f, 0.f);
-	for (int i=0; i<pm->Faces(); ++i)
+	const vector<NodeFaceRef>& nfl = m_NFL.FaceList(nid);
+	for (int i=0; i<(int)nfl.size(); ++i)
 	{
-		FSFace& face = pm->Face(i);
-		int nf = face.Nodes();
-		for (int j=0; j<nf; ++j)
-		{
-			if (face.n[j] == nid) sn += face.m_nn[j];
-		}
+		FSFace& face = pm->Face(nfl[i].fid);
+		sn += face.m_nn[nfl[i].nid];
 	}
 	sn.Normalize();
 
@@ -159,33 +176,34 @@ bool FEPointCongruency::Intersect(const Ray& ray, int& nface, int nid, vec3f& q,
 	nface = -1;
 	double Dmin = 0;
 	double rsi[2];
+	vec3f qi;
 	vec3f o = to_vec3f(ray.origin);
-	for (int i=0; i<pm->Faces(); ++i)
-	{
+
+	// the intersection tests don't check the direction, so we search the entire line
+	m_bvh.ClosestHit(ray.origin, ray.direction, true, [&](int i, double& D) {
 		FSFace& face = pm->Face(i);
 		// make sure this face does not contain nid
-		if (face.HasNode(nid) == false)
+		if (face.HasNode(nid)) return false;
+
+		bool b = false;
+		switch (face.m_type)
 		{
-			bool b = false;
-			switch (face.m_type)
-			{
-			case FE_FACE_TRI3 : b = IntersectTri3 (ray, face, q, rsi); break;
-			case FE_FACE_QUAD4: b = IntersectQuad4(ray, face, q, rsi); break;
-			}
+		case FE_FACE_TRI3 : b = IntersectTri3 (ray, face, qi, rsi); break;
+		case FE_FACE_QUAD4: b = IntersectQuad4(ray, face, qi, rsi); break;
+		}
+		if (b == false) return false;
 
-			if (b)
-			{
-				double D = (q - o).Length();
-				if ((nface == -1) || (D < Dmin))
-				{
-					nface = i;
-					Dmin = D;
-					rs[0] = rsi[0];
-					rs[1] = rsi[1];
-				}
-			}
+		D = (qi - o).Length();
+		if ((nface == -1) || (D < Dmin))
+		{
+			nface = i;
+			Dmin = D;
+			q = qi;
+			rs[0] = rsi[0];
+			rs[1] = rsi[1];
 		}
-	}
+		return true;
+	});
 	return (nface != -1);
 }
 
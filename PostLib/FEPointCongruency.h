@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include <FSCore/math3d.h>
 #include <MeshLib/Intersect.h>
 #include <MeshLib/FENodeFaceList.h>
+#include <MeshLib/FEFaceBVH.h>
 #include <set>
 //using namespace std;
 
@@ -59,8 +60,15 @@ public:
 	FEPointCongruency();
 
 	// measure the congruency of a point
+	// The search structures are built on the first call and reused as long as
+	// the same mesh is passed in. Call Refit if the nodes of the mesh moved, or 
+	// Reset if the mesh was modified otherwise.
 	CONGRUENCY_DATA Congruency(FSMesh* pm, int node);
 
+	void Reset();
+
+	void Refit();
+
 	void SetLevels(int niter) { m_nlevels = niter; }
 
 private:
@@ -82,5 +90,6 @@ public:
 private:
 	FSMesh*		m_mesh;
 	FSNodeFaceList	m_NFL;
+	FSFaceBVH	m_bvh;
 };
 }
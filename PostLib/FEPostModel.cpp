@@ -35,6 +35,7 @@ SOFTWARE.*/
 #include "FEMeshData_T.h"
 #include <MeshLib/MeshTools.h>
 #include <stdio.h>
+#include <algorithm>
 using namespace std;
 
 extern int ET_HEX[12][2];
@@ -71,6 +72,12 @@ FEPostModel::FEPostModel()
 	m_nTime = 0;
 	m_fTime = 0.f;
 
+	m_stateLoader = nullptr;
+	m_stateCacheSize = 0;
+	m_stateCacheUsed = 0;
+	m_stateReadAhead = 0;
+	m_stateEdits = 0;
+
 	m_pThis = this;
 }
 
@@ -110,7 +117,190 @@ FEPostModel* FEPostModel::GetInstance()
 //-----------------------------------------------------------------------------
 FEState* FEPostModel::CurrentState()
 {
-	return m_State[m_nTime];
+	return GetState(m_nTime);
+}
+
+//-----------------------------------------------------------------------------
+FEState* FEPostModel::GetState(int nstate)
+{
+	FEState* ps = m_State[nstate];
+	if (m_stateLoader)
+	{
+		// the loader and the list of loaded states are shared
+		#pragma omp critical (state_paging)
+		{
+			PageInState(ps);
+			if (m_stateEdits > 0) ps->SetModified(true);
+		}
+	}
+	return ps;
+}
+
+//-----------------------------------------------------------------------------
+FEState* FEPostModel::PinState(int nstate)
+{
+	FEState* ps = m_State[nstate];
+	#pragma omp critical (state_paging)
+	{
+		if (m_stateLoader)
+		{
+			PageInState(ps);
+			if (m_stateEdits > 0) ps->SetModified(true);
+		}
+		ps->Pin();
+	}
+	return ps;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::UnpinState(FEState* ps)
+{
+	#pragma omp critical (state_paging)
+	ps->Unpin();
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::BeginStateEdit()
+{
+	#pragma omp critical (state_paging)
+	m_stateEdits++;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::EndStateEdit()
+{
+	#pragma omp critical (state_paging)
+	{
+		assert(m_stateEdits > 0);
+		m_stateEdits--;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetStateLoader(FEStateLoader* loader)
+{
+	m_stateLoader = loader;
+	m_loadedStates.clear();
+	m_stateCacheUsed = 0;
+}
+
+//-----------------------------------------------------------------------------
+FEStateLoader* FEPostModel::GetStateLoader()
+{
+	return m_stateLoader;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetStateCacheSize(int MB)
+{
+	m_stateCacheSize = (MB > 0 ? (size_t)MB * 1024 * 1024 : 0);
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::GetStateCacheSize() const
+{
+	return (int)(m_stateCacheSize / (1024 * 1024));
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetStateReadAhead(int n)
+{
+	m_stateReadAhead = (n > 0 ? n : 0);
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::GetStateReadAhead() const
+{
+	return m_stateReadAhead;
+}
+
+//-----------------------------------------------------------------------------
+bool FEStateLoader::LoadStates(FEPostModel& fem, std::vector<FEState*>& states)
+{
+	bool bret = true;
+	for (size_t i = 0; i < states.size(); ++i)
+	{
+		if (LoadState(fem, states[i]) == false) bret = false;
+	}
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+// Make sure the data of state ps is loaded and mark it as the most recently used state.
+void FEPostModel::PageInState(FEState* ps)
+{
+	if (ps->IsLoaded())
+	{
+		// move it to the front of the list
+		list<pair<FEState*, size_t> >::iterator it = m_loadedStates.begin();
+		for (; it != m_loadedStates.end(); ++it)
+		{
+			if (it->first == ps)
+			{
+				if (it != m_loadedStates.begin()) m_loadedStates.splice(m_loadedStates.begin(), m_loadedStates, it);
+				break;
+			}
+		}
+		return;
+	}
+
+	// collect the states to read: the requested state, followed by 
+	// the next states that are not loaded yet
+	vector<FEState*> states;
+	states.push_back(ps);
+	if (m_stateReadAhead > 0)
+	{
+		int n = (int)(std::find(m_State.begin(), m_State.end(), ps) - m_State.begin());
+		for (int i = n + 1; (i < (int)m_State.size()) && (i <= n + m_stateReadAhead); ++i)
+		{
+			if (m_State[i]->IsLoaded()) break;
+			states.push_back(m_State[i]);
+		}
+	}
+
+	// read the state data
+	for (size_t i = 0; i < states.size(); ++i) states[i]->AllocateData();
+	if (m_stateLoader->LoadStates(*this, states) == false)
+	{
+		// keep the (zero-initialized) data, so callers get a valid state
+		assert(false);
+	}
+
+	// add them to the list of loaded states, with the requested state in front
+	for (int i = (int)states.size() - 1; i >= 0; --i)
+	{
+		FEState* psi = states[i];
+		size_t mem = psi->MemoryUsage() + m_stateLoader->StateDataSize(psi);
+		m_loadedStates.push_front(pair<FEState*, size_t>(psi, mem));
+		m_stateCacheUsed += mem;
+	}
+
+	// release states if we use too much memory
+	ReleaseStates(ps);
+}
+
+//-----------------------------------------------------------------------------
+// Release the least recently used states until the memory used by the loaded
+// states falls under the cache size. The state ps, the current state, and states 
+// that are pinned or modified are kept.
+void FEPostModel::ReleaseStates(FEState* ps)
+{
+	if (m_stateCacheSize == 0) return;
+
+	FEState* current = ((m_nTime >= 0) && (m_nTime < (int)m_State.size()) ? m_State[m_nTime] : nullptr);
+
+	list<pair<FEState*, size_t> >::iterator it = m_loadedStates.end();
+	while ((m_stateCacheUsed > m_stateCacheSize) && (it != m_loadedStates.begin()))
+	{
+		--it;
+		FEState* psi = it->first;
+		if ((psi != ps) && (psi != current) && !psi->IsPinned() && !psi->IsModified())
+		{
+			m_stateCacheUsed -= it->second;
+			psi->ReleaseData();
+			it = m_loadedStates.erase(it);
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -132,15 +322,16 @@ void FEPostModel::SetTimeValue(float ftime)
 //
 int FEPostModel::GetClosestTime(double t)
 {
-	FEState& s0 = *GetState(0);
+	// (we access the states directly, since we only need the time values)
+	FEState& s0 = *m_State[0];
 	if (s0.m_time >= t) return 0;
 
-	FEState& s1 = *GetState(GetStates() - 1);
+	FEState& s1 = *m_State[GetStates() - 1];
 	if (s1.m_time <= t) return GetStates() - 1;
 
 	for (int i = 1; i<GetStates(); ++i)
 	{
-		FEState& s = *GetState(i);
+		FEState& s = *m_State[i];
 		if (s.m_time >= t) return i - 1;
 	}
 	return GetStates() - 1;
@@ -150,7 +341,7 @@ int FEPostModel::GetClosestTime(double t)
 //-----------------------------------------------------------------------------
 float FEPostModel::GetTimeValue(int ntime)
 {
-	return GetState(ntime)->m_time;
+	return m_State[ntime]->m_time;
 }
 
 //-----------------------------------------------------------------------------
@@ -245,6 +436,9 @@ void FEPostModel::ClearStates()
 	for (int i=0; i<(int) m_State.size(); i++) delete m_State[i];
 	m_State.clear();
 	m_nTime = 0;
+
+	// the loader only applies to the states we just deleted
+	SetStateLoader(nullptr);
 }
 
 //-----------------------------------------------------------------------------
@@ -552,6 +746,9 @@ void FEPostModel::InterpolateStateData(FEState* ps)
 {
 	if (ps == nullptr) return;
 
+	FEStateEditScope edit(*this);
+	FEStateLock lock(*this, ps->GetID());
+
 	FEState& sd = *ps;
 	int n = ps->GetID();
 	if (n == 0)
@@ -618,6 +815,19 @@ void FEPostModel::DeleteState(int n)
 	int N = m_State.size();
 	assert((n>=0) && (n<N));
 	for (int i=0; i<n; ++i) ++it;
+
+	// remove it from the loaded states
+	list<pair<FEState*, size_t> >::iterator il = m_loadedStates.begin();
+	for (; il != m_loadedStates.end(); ++il)
+	{
+		if (il->first == *it)
+		{
+			m_stateCacheUsed -= il->second;
+			m_loadedStates.erase(il);
+			break;
+		}
+	}
+
 	m_State.erase(it);
 
 	// reindex the states
@@ -668,6 +878,9 @@ template <typename Type, Data_Format Fmt> void copy_face_data(FEMeshData& d, FEM
 // Copy a data field
 ModelDataField* FEPostModel::CopyDataField(ModelDataField* pd, const char* sznewname)
 {
+	// the copied data is not read by the state loader
+	FEStateEditScope edit(*this);
+
 	// Clone the data field
 	ModelDataField* pdcopy = pd->Clone();
 
@@ -1009,6 +1222,9 @@ template <typename T> void cached_copy_elem_data_NODE(FEMeshData& dst, FEMeshDat
 //! Create a cached copy of a data field
 ModelDataField* FEPostModel::CreateCachedCopy(ModelDataField* pd, const char* sznewname)
 {
+	// the copied data is not read by the state loader
+	FEStateEditScope edit(*this);
+
 	// create a new data field that will store a cached copy
 	ModelDataField* pdcopy = createCachedDataField(pd);
 	if (pdcopy == 0) return 0;
@@ -1145,11 +1361,12 @@ void FEPostModel::DeleteDataField(ModelDataField* pd)
 	if (m == -1) { assert(false); return; }
 
 	// remove this field from all states
+	// (states that are not loaded don't have any data)
 	int NS = GetStates();
 	for (int i=0; i<NS; ++i)
 	{
-		FEState* ps = GetState(i);
-		ps->m_Data.erase(m);
+		FEState* ps = m_State[i];
+		if (ps->IsLoaded()) ps->m_Data.erase(m);
 	}
 	m_pDM->DeleteDataField(pd);
 
@@ -1165,10 +1382,11 @@ void FEPostModel::AddDataField(ModelDataField* pd, const std::string& name)
 	m_pDM->AddDataField(pd, name);
 
 	// now add new data for each of the states
+	// (states that are not loaded will create their data when loaded)
 	vector<FEState*>::iterator it;
 	for (it=m_State.begin(); it != m_State.end(); ++it)
 	{
-		(*it)->m_Data.push_back(pd->CreateData(*it));
+		if ((*it)->IsLoaded()) (*it)->m_Data.push_back(pd->CreateData(*it));
 	}
 
 	// update all dependants
@@ -1185,11 +1403,15 @@ void FEPostModel::AddDataField(ModelDataField* pd, vector<int>& L)
 	m_pDM->AddDataField(pd);
 
 	// now add new meshdata for each of the states
-	vector<FEState*>::iterator it;
-	for (it=m_State.begin(); it != m_State.end(); ++it)
+	// (the face list cannot be restored when a state is reloaded, so we load 
+	// all states and keep them)
+	FEStateEditScope edit(*this);
+	for (int i = 0; i < GetStates(); ++i)
 	{
-		FEFaceItemData* pmd = dynamic_cast<FEFaceItemData*>(pd->CreateData(*it));
-		(*it)->m_Data.push_back(pmd);
+		// (states that were loaded here already created their data)
+		FEState* ps = GetState(i);
+		if (ps->m_Data.size() < m_pDM->DataFields()) ps->m_Data.push_back(pd->CreateData(ps));
+		FEMeshData* pmd = &ps->m_Data[ps->m_Data.size() - 1];
 		if (dynamic_cast<Curvature*>(pmd))
 		{
 			Curvature* pcrv = dynamic_cast<Curvature*>(pmd);
@@ -1272,10 +1494,10 @@ void FEPostModel::GetElementCoords(int iel, int ntime, vec3f* r)
 {
 	FEPostMesh* mesh = GetState(ntime)->GetFEMesh();
 	FEElement_& elem = mesh->ElementRef(iel);
-	NODEDATA* pn = &m_State[ntime]->m_NODE[0];
+	const vec3f* pn = GetState(ntime)->m_NODE.m_rt.data();
 
 	for (int i=0; i<elem.Nodes(); i++)
-		r[i] = pn[ elem.m_node[i] ].m_rt;
+		r[i] = pn[ elem.m_node[i] ];
 }
 
 //-----------------------------------------------------------------------------
@@ -1374,7 +1596,7 @@ void FEPostModel::UpdateMeshState(int ntime)
 	for (int i = 0; i < NE; ++i)
 	{
 		FEElement_& el = mesh->ElementRef(i);
-		ELEMDATA& data = state.m_ELEM[i];
+		ElemDataRef data = state.m_ELEM[i];
 
 		if (el.IsShell())
 		{
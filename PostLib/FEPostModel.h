@@ -33,6 +33,7 @@ SOFTWARE.*/
 #include "GLObject.h"
 #include <FSCore/box.h>
 #include <vector>
+#include <list>
 //using namespace std;
 
 namespace Post {
@@ -58,6 +59,27 @@ public:
 	virtual void Update(FEPostModel* pfem) = 0;
 };
 
+//-----------------------------------------------------------------------------
+// Base class for classes that can read the data of a state on demand. When a 
+// model has a state loader, the states initially only store their time value
+// and the state data is read when the state is retrieved with FEPostModel::GetState.
+class FEStateLoader
+{
+public:
+	FEStateLoader() {}
+	virtual ~FEStateLoader() {}
+
+	// Read the data of state ps. The state's data will already be allocated.
+	virtual bool LoadState(FEPostModel& fem, FEState* ps) = 0;
+
+	// Read the data of several states. Loaders can override this to read the states
+	// in parallel. By default, this just calls LoadState for each state.
+	virtual bool LoadStates(FEPostModel& fem, std::vector<FEState*>& states);
+
+	// Return an estimate (in bytes) of the size of the data fields of state ps
+	virtual size_t StateDataSize(FEState* ps) { return 0; }
+};
+
 //-----------------------------------------------------------------------------
 // Class that describes an FEPostModel. A model consists of a mesh (in the future
 // there can be multiple meshes to support remeshing), a list of materials
@@ -172,8 +194,8 @@ public:
 	//! get the nr of states
 	int GetStates() { return (int) m_State.size(); }
 
-	//! retrieve pointer to a state
-	FEState* GetState(int nstate) { return m_State[nstate]; }
+	//! retrieve pointer to a state (this will page in the state's data if needed)
+	FEState* GetState(int nstate);
 
 	//! Add a new data field
 	void AddDataField(ModelDataField* pd, const std::string& name = "");
@@ -196,6 +218,32 @@ public:
 	// interpolate data between its neighbors
 	void InterpolateStateData(FEState* ps);
 
+	// --- S T A T E   P A G I N G ---
+	// Set the loader that reads state data on demand. This is cleared by ClearStates.
+	void SetStateLoader(FEStateLoader* loader);
+	FEStateLoader* GetStateLoader();
+
+	// Set the max amount of memory (in MB) that loaded states may use (0 = no limit).
+	// When exceeded, the least recently used states are released. States that are pinned
+	// or that were modified by a state edit (e.g. filters, cached copies) are kept.
+	void SetStateCacheSize(int MB);
+	int GetStateCacheSize() const;
+
+	// Set the number of states that are read in addition to the requested state,
+	// when that state needs to be loaded (0 = none).
+	void SetStateReadAhead(int n);
+	int GetStateReadAhead() const;
+
+	// Retrieve a state and keep it loaded until UnpinState is called. Use this 
+	// (or FEStateLock) when a state is accessed while other states are retrieved.
+	FEState* PinState(int nstate);
+	void UnpinState(FEState* ps);
+
+	// While a state edit is in progress, all states that are retrieved are marked 
+	// as modified, so that they are not released (see FEStateEditScope). 
+	void BeginStateEdit();
+	void EndStateEdit();
+
 public:
 	//! get the bounding box
 	BOX GetBoundingBox() { return m_bbox; }
@@ -221,6 +269,12 @@ public:
 	bool EvaluateFace   (int n, int ntime, int nfield, float* data, float& val);
 	bool EvaluateElement(int n, int ntime, int nfield, float* data, float& val);
 
+	// evaluate a node field for all nodes of a state
+	void EvaluateNodes(int ntime, int nfield);
+
+	// evaluate an element field for all elements of a state
+	void EvaluateElements(int ntime, int nfield);
+
 	// evaluate based on point
 	void EvaluateNode(const vec3f& r, int ntime, int nfield, NODEDATA& d);
 
@@ -286,6 +340,10 @@ protected:
 	void EvalNodeField(int ntime, int nfield);
 	void EvalFaceField(int ntime, int nfield);
 	void EvalElemField(int ntime, int nfield);
+
+	// Helper functions for state paging
+	void PageInState(FEState* ps);
+	void ReleaseStates(FEState* ps);
 	
 protected:
 	string	m_name;		// name (as displayed in model viewer)
@@ -314,9 +372,54 @@ protected:
 	FEDataManager*		m_pDM;		// the Data Manager
 	int					m_ndisp;	// vector field defining the displacement
 
+	// --- S T A T E   P A G I N G ---
+	FEStateLoader*		m_stateLoader;		// reads state data on demand
+	size_t				m_stateCacheSize;	// max memory of loaded states (in bytes, 0 = no limit)
+	size_t				m_stateCacheUsed;	// memory currently used by loaded states
+	int					m_stateReadAhead;	// nr of following states to load together with a requested state
+	int					m_stateEdits;		// nr of active state edits
+	std::list<std::pair<FEState*, size_t> >	m_loadedStates;	// loaded states (most recently used first)
+
 	// dependants
 	std::vector<FEModelDependant*>	m_Dependants;
 
 	static FEPostModel*	m_pThis;
 };
+
+//-----------------------------------------------------------------------------
+// Keeps a state of the model loaded for the lifetime of this object.
+class FEStateLock
+{
+public:
+	FEStateLock(FEPostModel& fem, int nstate) : m_fem(fem) { m_ps = fem.PinState(nstate); }
+	~FEStateLock() { m_fem.UnpinState(m_ps); }
+
+	FEState* operator -> () { return m_ps; }
+	FEState& operator * () { return *m_ps; }
+
+private:
+	FEStateLock(const FEStateLock&);
+	void operator = (const FEStateLock&);
+
+private:
+	FEPostModel&	m_fem;
+	FEState*		m_ps;
+};
+
+//-----------------------------------------------------------------------------
+// Use this when the data of the model's states is modified, so that the 
+// modified states are not released (and reloaded without the modifications).
+class FEStateEditScope
+{
+public:
+	FEStateEditScope(FEPostModel& fem) : m_fem(fem) { fem.BeginStateEdit(); }
+	~FEStateEditScope() { m_fem.EndStateEdit(); }
+
+private:
+	FEStateEditScope(const FEStateEditScope&);
+	void operator = (const FEStateEditScope&);
+
+private:
+	FEPostModel&	m_fem;
+};
 } // namespace Post
@@ -86,51 +86,77 @@ FERefState::FERefState(FEPostModel* fem)
 }
 
 //-----------------------------------------------------------------------------
-// Constructor
-FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(fem), m_mesh(pmesh)
+void NodeDataArray::resize(size_t n)
 {
-	m_id = -1;
-	m_ref = nullptr; // will be set by model
-
-	Post::FEPostMesh& mesh = *m_mesh;
+	m_rt.resize(n);
+	m_val.resize(n);
+	m_ntag.resize(n);
+}
 
-	int nodes = mesh.Nodes();
-	int edges = mesh.Edges();
-	int elems = mesh.Elements();
-	int faces = mesh.Faces();
+//-----------------------------------------------------------------------------
+void NodeDataArray::clear()
+{
+	vector<vec3f>().swap(m_rt);
+	vector<float>().swap(m_val);
+	vector<int>().swap(m_ntag);
+}
 
-	// allocate storage
-	m_NODE.resize(nodes);
-	m_EDGE.resize(edges);
-	m_ELEM.resize(elems);
-	m_FACE.resize(faces);
+//-----------------------------------------------------------------------------
+size_t NodeDataArray::MemoryUsage() const
+{
+	return m_rt.capacity() * sizeof(vec3f) + m_val.capacity() * sizeof(float) + m_ntag.capacity() * sizeof(int);
+}
 
-	// allocate element data
-	for (int i=0; i<elems; ++i)
+//-----------------------------------------------------------------------------
+void ElemDataArray::resize(FEPostMesh& mesh)
+{
+	int NE = mesh.Elements();
+	m_val.assign(NE, 0.f);
+	m_state.assign(NE, StatusFlags::VISIBLE);
+
+	// only allocate shell thicknesses for shells
+	int nh = 0;
+	vector<int>().swap(m_hoff);
+	for (int i = 0; i < NE; ++i)
 	{
 		FEElement_& el = mesh.ElementRef(i);
-		int ne = el.Nodes();
-		m_ElemData.append(ne);
-	}
+		if (el.IsShell())
+		{
+			if (m_hoff.empty()) m_hoff.assign(NE, -1);
+			m_hoff[i] = nh;
 
-	// allocate face data
-	for (int i=0; i<faces; ++i)
-	{
-		FSFace& face = mesh.Face(i);
-		int nf = face.Nodes();
-		m_FaceData.append(nf);
+			// some readers always set four values
+			int nn = el.Nodes();
+			nh += (nn < 4 ? 4 : nn);
+		}
 	}
+	m_h.assign(nh, 0.f);
+}
 
-	// initialize data
-	for (int i=0; i<nodes; ++i) m_NODE[i].m_rt = to_vec3f(mesh.Node(i).r);
-	for (int i=0; i<elems; ++i)
-	{
-		m_ELEM[i].m_state = StatusFlags::VISIBLE;
-		m_ELEM[i].m_h[0] = 0.f;
-		m_ELEM[i].m_h[1] = 0.f;
-		m_ELEM[i].m_h[2] = 0.f;
-		m_ELEM[i].m_h[3] = 0.f;
-	}
+//-----------------------------------------------------------------------------
+void ElemDataArray::clear()
+{
+	vector<float>().swap(m_val);
+	vector<unsigned int>().swap(m_state);
+	vector<int>().swap(m_hoff);
+	vector<float>().swap(m_h);
+}
+
+//-----------------------------------------------------------------------------
+size_t ElemDataArray::MemoryUsage() const
+{
+	return (m_val.capacity() + m_h.capacity()) * sizeof(float) + m_state.capacity() * sizeof(unsigned int) + m_hoff.capacity() * sizeof(int);
+}
+
+//-----------------------------------------------------------------------------
+// Constructor
+FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh, bool allocData) : m_fem(fem), m_mesh(pmesh)
+{
+	m_id = -1;
+	m_ref = nullptr; // will be set by model
+	m_bloaded = false;
+	m_bmodified = false;
+	m_npin = 0;
 
 	int ptObjs = fem->PointObjects();
 	m_objPt.resize(ptObjs);
@@ -193,10 +219,51 @@ FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(
 	m_nField = -1;
 	m_status = 0;
 
+	if (allocData) AllocateData();
+}
+
+//-----------------------------------------------------------------------------
+void FEState::AllocateData()
+{
+	Post::FEPostMesh& mesh = *m_mesh;
+
+	int nodes = mesh.Nodes();
+	int edges = mesh.Edges();
+	int elems = mesh.Elements();
+	int faces = mesh.Faces();
+
+	// allocate storage
+	m_NODE.resize(nodes);
+	m_EDGE.resize(edges);
+	m_ELEM.resize(mesh);
+	m_FACE.resize(faces);
+
+	// allocate element data
+	m_ElemData.clear();
+	for (int i=0; i<elems; ++i)
+	{
+		FEElement_& el = mesh.ElementRef(i);
+		int ne = el.Nodes();
+		m_ElemData.append(ne);
+	}
+
+	// allocate face data
+	m_FaceData.clear();
+	for (int i=0; i<faces; ++i)
+	{
+		FSFace& face = mesh.Face(i);
+		int nf = face.Nodes();
+		m_FaceData.append(nf);
+	}
+
+	// initialize data
+	for (int i=0; i<nodes; ++i) m_NODE.m_rt[i] = to_vec3f(mesh.Node(i).r);
+
 	// get the data manager
-	FEDataManager* pdm = fem->GetDataManager();
+	FEDataManager* pdm = m_fem->GetDataManager();
 
 	// Nodal data
+	m_Data.clear();
 	int N = pdm->DataFields();
 	FEDataFieldPtr it = pdm->FirstDataField();
 	for (int i=0; i<N; ++i, ++it)
@@ -204,6 +271,36 @@ FEState::FEState(float time, FEPostModel* fem, Post::FEPostMesh* pmesh) : m_fem(
 		ModelDataField& d = *(*it);
 		m_Data.push_back(d.CreateData(this));
 	}
+
+	m_bloaded = true;
+}
+
+//-----------------------------------------------------------------------------
+void FEState::ReleaseData()
+{
+	// swap with empty arrays, so that the memory is actually returned
+	m_NODE.clear();
+	vector<EDGEDATA>().swap(m_EDGE);
+	vector<FACEDATA>().swap(m_FACE);
+	m_ELEM.clear();
+	m_ElemData = ValArray();
+	m_FaceData = ValArray();
+	m_Data.clear();
+
+	m_nField = -1;
+	m_bloaded = false;
+}
+
+//-----------------------------------------------------------------------------
+size_t FEState::MemoryUsage() const
+{
+	size_t mem = 0;
+	mem += m_NODE.MemoryUsage();
+	mem += m_EDGE.size() * sizeof(EDGEDATA);
+	mem += m_FACE.size() * sizeof(FACEDATA);
+	mem += m_ELEM.MemoryUsage();
+	mem += (m_ElemData.size() + m_FaceData.size()) * sizeof(float);
+	return mem;
 }
 
 //-----------------------------------------------------------------------------
@@ -239,6 +336,9 @@ int FEState::GetID() const
 FEState::FEState(float time, FEPostModel* pfem, FEState* pstate) : m_fem(pfem)
 {
 	m_id = -1;
+	m_bloaded = true;
+	m_bmodified = false;
+	m_npin = 0;
 	m_time = time;
 	m_nField = -1;
 	m_status = 0;
@@ -325,7 +425,7 @@ void FEState::RebuildData()
 	// allocate storage
 	m_NODE.resize(nodes);
 	m_EDGE.resize(edges);
-	m_ELEM.resize(elems);
+	m_ELEM.resize(mesh);
 	m_FACE.resize(faces);
 
 	// allocate element data
@@ -335,8 +435,6 @@ void FEState::RebuildData()
 		FEElement_& el = mesh.ElementRef(i);
 		int ne = el.Nodes();
 		m_ElemData.append(ne);
-
-		m_ELEM[i].m_state = StatusFlags::VISIBLE;
 	}
 
 	// allocate face data
@@ -349,14 +447,7 @@ void FEState::RebuildData()
 	}
 
 	// initialize data
-	for (int i = 0; i < nodes; ++i) m_NODE[i].m_rt = to_vec3f(mesh.Node(i).r);
-	for (int i = 0; i < elems; ++i)
-	{
-		m_ELEM[i].m_h[0] = 0.f;
-		m_ELEM[i].m_h[1] = 0.f;
-		m_ELEM[i].m_h[2] = 0.f;
-		m_ELEM[i].m_h[3] = 0.f;
-	}
+	for (int i = 0; i < nodes; ++i) m_NODE.m_rt[i] = to_vec3f(mesh.Node(i).r);
 
 	int ptObjs = fem.PointObjects();
 	m_objPt.resize(ptObjs);
@@ -59,19 +59,84 @@ struct EDGEDATA
 	float	m_nv[FSEdge::MAX_NODES]; // nodal values
 };
 
-struct ELEMDATA
-{
-	float			m_val;		// current element value
-	unsigned int	m_state;	// state flags
-	float			m_h[FSElement::MAX_NODES];		// shell thickness (TODO: Can we move this to the face data?)
-};
-
 struct FACEDATA
 {
 	int		m_ntag;		// active flag
 	float	m_val;		// current face value
 };
 
+//-----------------------------------------------------------------------------
+// reference to the data of a node in a state (see NodeDataArray)
+struct NodeDataRef
+{
+	vec3f&	m_rt;	// nodal position determined by displacement map
+	float&	m_val;	// current nodal value
+	int&	m_ntag;	// active flag
+};
+
+//-----------------------------------------------------------------------------
+// The nodal data of a state. The positions, values, and tags are stored in 
+// separate arrays, but can be accessed per node through the [] operator.
+class NodeDataArray
+{
+public:
+	void resize(size_t n);
+
+	// clear the arrays and free the memory
+	void clear();
+
+	size_t size() const { return m_val.size(); }
+	bool empty() const { return m_val.empty(); }
+
+	NodeDataRef operator [] (size_t i) { return NodeDataRef{ m_rt[i], m_val[i], m_ntag[i] }; }
+
+	size_t MemoryUsage() const;
+
+public:
+	std::vector<vec3f>	m_rt;	// nodal positions
+	std::vector<float>	m_val;	// nodal values
+	std::vector<int>	m_ntag;	// active flags
+};
+
+//-----------------------------------------------------------------------------
+// reference to the data of an element in a state (see ElemDataArray)
+struct ElemDataRef
+{
+	float&			m_val;		// current element value
+	unsigned int&	m_state;	// state flags
+	float*			m_h;		// shell thickness (null for non-shells)
+};
+
+//-----------------------------------------------------------------------------
+// The element data of a state. The values and state flags are stored in 
+// separate arrays. Shell thicknesses are only stored for shell elements.
+class ElemDataArray
+{
+public:
+	// allocate the data for the elements of the mesh
+	void resize(FEPostMesh& mesh);
+
+	// clear the arrays and free the memory
+	void clear();
+
+	size_t size() const { return m_val.size(); }
+	bool empty() const { return m_val.empty(); }
+
+	ElemDataRef operator [] (size_t i) 
+	{ 
+		float* h = ((m_hoff.empty() || (m_hoff[i] < 0)) ? nullptr : &m_h[m_hoff[i]]);
+		return ElemDataRef{ m_val[i], m_state[i], h };
+	}
+
+	size_t MemoryUsage() const;
+
+public:
+	std::vector<float>			m_val;		// element values
+	std::vector<unsigned int>	m_state;	// state flags
+	std::vector<int>			m_hoff;		// offset into m_h for shells, -1 otherwise (empty when there are no shells)
+	std::vector<float>			m_h;		// shell thicknesses
+};
+
 class ObjectData
 {
 public:
@@ -136,7 +201,7 @@ public:
 class FEState
 {
 public:
-	FEState(float time, FEPostModel* fem, FEPostMesh* mesh);
+	FEState(float time, FEPostModel* fem, FEPostMesh* mesh, bool allocData = true);
 	FEState(float time, FEPostModel* fem, FEState* state);
 
 	void SetID(int n);
@@ -152,6 +217,29 @@ public:
 
 	void RebuildData();
 
+public:
+	// These functions are used when states are paged in on demand (see FEStateLoader).
+	// A state that is not loaded only stores its time value and status.
+	bool IsLoaded() const { return m_bloaded; }
+
+	// allocate the node, element and face data and the data fields
+	void AllocateData();
+
+	// free all the data of this state
+	void ReleaseData();
+
+	// estimate of the memory (in bytes) used by the state arrays (excluding data fields)
+	size_t MemoryUsage() const;
+
+	// A pinned state is not released while it is in use (see FEPostModel::PinState)
+	void Pin() { m_npin++; }
+	void Unpin() { assert(m_npin > 0); m_npin--; }
+	bool IsPinned() const { return (m_npin > 0); }
+
+	// A modified state holds data that the loader cannot restore, so it is never released
+	void SetModified(bool b) { m_bmodified = b; }
+	bool IsModified() const { return m_bmodified; }
+
 public:
 	float	m_time;		// time value
 	int		m_nField;	// the field whos values are contained in m_pval
@@ -159,10 +247,10 @@ public:
 	bool	m_bsmooth;
 	int		m_status;	// status flag
 
-	std::vector<NODEDATA>	m_NODE;		// nodal data
+	NodeDataArray			m_NODE;		// nodal data
 	std::vector<EDGEDATA>	m_EDGE;		// edge data
 	std::vector<FACEDATA>	m_FACE;		// face data
-	std::vector<ELEMDATA>	m_ELEM;		// element data
+	ElemDataArray			m_ELEM;		// element data
 
 	std::vector<OBJ_POINT_DATA>	m_objPt;		// object data
 	std::vector<OBJ_LINE_DATA>	m_objLn;		// object data
@@ -177,5 +265,10 @@ public:
 	FEPostModel*	m_fem;	//!< model this state belongs to
 	FERefState*		m_ref;	//!< the reference state for this state
 	FEPostMesh*		m_mesh;	//!< The mesh this state uses
+
+private:
+	bool	m_bloaded;		//!< data was allocated
+	bool	m_bmodified;	//!< data was modified after it was loaded
+	int		m_npin;			//!< pin count
 };
 }
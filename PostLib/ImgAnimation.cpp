@@ -43,19 +43,23 @@ int CImgAnimation::Create(const char* szfile, int cx, int cy, float fps)
 	if (ch) *ch = 0;
 	strcpy(m_szbase, sztmp);
 	strcpy(m_szext, ch+1);
+	m_bopen = true;
 	return 1;
 }
 
 int CImgAnimation::Write(QImage& im)
+{
+	return WriteFrame(im, m_ncnt++);
+}
+
+int CImgAnimation::WriteFrame(QImage& im, int n)
 {
 	if (im.width() != m_nx) { assert(false); return 0; }
 	if (im.height() != m_ny) { assert(false); return 0; }
 
-	// create the next file name
+	// create the file name
 	char szfile[512] = {0};
-	sprintf(szfile, "%s%04d.%s", m_szbase, m_ncnt, m_szext);
-
-	m_ncnt++;
+	sprintf(szfile, "%s%04d.%s", m_szbase, n, m_szext);
 
 	return (SaveFrame(im, szfile)? 1 : 0);
 }
@@ -40,6 +40,9 @@ public:
 	bool IsValid() override;
 	int Frames() override { return m_ncnt; }
 
+	bool FramesAreIndependent() override { return true; }
+	int WriteFrame(QImage& im, int n) override;
+
 	virtual bool SaveFrame(QImage& im, const char* szfile) = 0;
 
 protected:
@@ -43,6 +43,8 @@ SOFTWARE.*/
 #include <MeshLib/FEMesh.h>
 #include <sstream>
 #include <algorithm>
+#include <queue>
+#include <math.h>
 #include <assert.h>
 //using namespace std;
 
@@ -60,26 +62,351 @@ TriMesh::TriMesh()
 
 void TriMesh::Clear()
 {
+	m_Node.clear();
+	m_Norm.clear();
 	m_Face.clear();
 }
 
-void TriMesh::Reserve(size_t nsize)
+void TriMesh::Reserve(size_t nodes, size_t faces)
 {
-	m_Face.reserve(nsize);
+	m_Node.reserve(nodes);
+	m_Norm.reserve(nodes);
+	m_Face.reserve(faces);
 }
 
-void TriMesh::Resize(size_t nsize)
+void TriMesh::Merge(const TriMesh& tri)
 {
-	m_Face.resize(nsize);
+	int N0 = Nodes();
+	m_Node.insert(m_Node.end(), tri.m_Node.begin(), tri.m_Node.end());
+	m_Norm.insert(m_Norm.end(), tri.m_Norm.begin(), tri.m_Norm.end());
+	for (const TRI& f : tri.m_Face) AddFace(f.n[0] + N0, f.n[1] + N0, f.n[2] + N0);
 }
 
-void TriMesh::Merge(TriMesh& tri, int ncount)
+namespace {
+
+	// symmetric 4x4 error quadric
+	class Quadric
+	{
+	public:
+		Quadric() { for (int i = 0; i < 10; ++i) a[i] = 0.0; }
+
+		// quadric of the plane n*x + d = 0
+		Quadric(const vec3f& n, double d)
+		{
+			a[0] = n.x*n.x; a[1] = n.x*n.y; a[2] = n.x*n.z; a[3] = n.x*d;
+			a[4] = n.y*n.y; a[5] = n.y*n.z; a[6] = n.y*d;
+			a[7] = n.z*n.z; a[8] = n.z*d;
+			a[9] = d*d;
+		}
+
+		Quadric& operator += (const Quadric& q) { for (int i = 0; i < 10; ++i) a[i] += q.a[i]; return *this; }
+
+		double Error(const vec3f& r) const
+		{
+			double x = r.x, y = r.y, z = r.z;
+			return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+				 + a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+				 + a[7]*z*z + 2*a[8]*z
+				 + a[9];
+		}
+
+		// find the position that minimizes the error
+		bool Optimum(vec3f& r) const
+		{
+			double A[3][3] = { {a[0], a[1], a[2]}, {a[1], a[4], a[5]}, {a[2], a[5], a[7]} };
+			double D = A[0][0]*(A[1][1]*A[2][2] - A[1][2]*A[2][1])
+					 - A[0][1]*(A[1][0]*A[2][2] - A[1][2]*A[2][0])
+					 + A[0][2]*(A[1][0]*A[2][1] - A[1][1]*A[2][0]);
+			if (fabs(D) < 1e-10) return false;
+
+			double b[3] = { -a[3], -a[6], -a[8] };
+			double x = (b[0]*(A[1][1]*A[2][2] - A[1][2]*A[2][1]) - A[0][1]*(b[1]*A[2][2] - A[1][2]*b[2]) + A[0][2]*(b[1]*A[2][1] - A[1][1]*b[2])) / D;
+			double y = (A[0][0]*(b[1]*A[2][2] - A[1][2]*b[2]) - b[0]*(A[1][0]*A[2][2] - A[1][2]*A[2][0]) + A[0][2]*(A[1][0]*b[2] - b[1]*A[2][0])) / D;
+			double z = (A[0][0]*(A[1][1]*b[2] - b[1]*A[2][1]) - A[0][1]*(A[1][0]*b[2] - b[1]*A[2][0]) + b[0]*(A[1][0]*A[2][1] - A[1][1]*A[2][0])) / D;
+			r = vec3f((float)x, (float)y, (float)z);
+			return true;
+		}
+
+	private:
+		double	a[10];	// upper triangle of the matrix
+	};
+
+	// candidate edge collapse
+	struct COLLAPSE
+	{
+		double	cost;
+		int		n[2];	// the edge's vertices (n[1] is merged into n[0])
+		int		tag[2];	// vertex tags when this collapse was evaluated
+		vec3f	r;		// new position of the merged vertex
+
+		// the priority queue returns the collapse with the lowest cost first
+		bool operator < (const COLLAPSE& c) const { return cost > c.cost; }
+	};
+}
+
+void TriMesh::Decimate(int targetFaces)
 {
-	if (ncount < 0) ncount = tri.Faces();
-	int N = (int)m_Face.size();
-	m_Face.resize(m_Face.size() + ncount);
-	for (size_t i = 0; i < ncount; ++i)
-		m_Face[N + i] = tri.m_Face[i];
+	int NN = Nodes();
+	int NF = Faces();
+	if ((targetFaces <= 0) || (NF <= targetFaces)) return;
+
+	// build the vertex quadrics from the face planes
+	std::vector<Quadric> Q(NN);
+	for (int i = 0; i < NF; ++i)
+	{
+		TRI& f = m_Face[i];
+		const vec3f& r0 = m_Node[f.n[0]];
+		vec3f fn = (m_Node[f.n[1]] - r0) ^ (m_Node[f.n[2]] - r0);
+		if (fn.Length() == 0.f) continue;
+		fn.Normalize();
+		Quadric q(fn, -(fn*r0));
+		for (int j = 0; j < 3; ++j) Q[f.n[j]] += q;
+	}
+
+	// vertex-face lists
+	std::vector<std::vector<int> > NFL(NN);
+	for (int i = 0; i < NF; ++i)
+		for (int j = 0; j < 3; ++j) NFL[m_Face[i].n[j]].push_back(i);
+
+	// find the edges and lock the vertices on open or non-manifold edges
+	std::vector<std::pair<int, int> > edges; edges.reserve(3 * (size_t)NF);
+	for (int i = 0; i < NF; ++i)
+	{
+		TRI& f = m_Face[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			int a = f.n[j], b = f.n[(j + 1) % 3];
+			edges.push_back(a < b ? std::pair<int, int>(a, b) : std::pair<int, int>(b, a));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	std::vector<bool> locked(NN, false);
+	size_t NE = 0;
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t j = i + 1;
+		while ((j < edges.size()) && (edges[j] == edges[i])) ++j;
+		if (j - i != 2) { locked[edges[i].first] = true; locked[edges[i].second] = true; }
+		edges[NE++] = edges[i];
+		i = j;
+	}
+	edges.resize(NE);
+
+	std::vector<int> tag(NN, 0);
+	std::vector<bool> dead(NN, false);
+
+	// evaluate the collapse of an edge
+	auto evalCollapse = [&](int a, int b, COLLAPSE& c) {
+		if (locked[a] && locked[b]) return false;
+		if (locked[b]) std::swap(a, b);
+
+		Quadric q = Q[a]; q += Q[b];
+		const vec3f& ra = m_Node[a];
+		const vec3f& rb = m_Node[b];
+		vec3f r;
+		if (locked[a]) r = ra;
+		else
+		{
+			// use the optimal position if it is not too far from the edge,
+			// otherwise pick the best of the end points and the midpoint
+			vec3f rm = (ra + rb)*0.5f;
+			if ((q.Optimum(r) == false) || ((r - rm).Length() > (rb - ra).Length()))
+			{
+				r = rm;
+				if (q.Error(ra) < q.Error(r)) r = ra;
+				if (q.Error(rb) < q.Error(r)) r = rb;
+			}
+		}
+
+		c.cost = q.Error(r);
+		c.n[0] = a; c.n[1] = b;
+		c.tag[0] = tag[a]; c.tag[1] = tag[b];
+		c.r = r;
+		return true;
+	};
+
+	std::priority_queue<COLLAPSE> heap;
+	for (auto& e : edges)
+	{
+		COLLAPSE c;
+		if (evalCollapse(e.first, e.second, c)) heap.push(c);
+	}
+	edges.clear(); edges.shrink_to_fit();
+
+	std::vector<int> mark(NN, -1);
+	int stamp = 0;
+	std::vector<int> nbr;
+
+	int liveFaces = NF;
+	while ((liveFaces > targetFaces) && !heap.empty())
+	{
+		COLLAPSE c = heap.top(); heap.pop();
+		int u = c.n[0], v = c.n[1];
+		if (dead[u] || dead[v] || (tag[u] != c.tag[0]) || (tag[v] != c.tag[1])) continue;
+
+		// check the link condition, i.e. the edge is shared by two faces and
+		// u and v have no other common neighbors, so the mesh stays manifold
+		++stamp;
+		int sharedFaces = 0;
+		for (int fi : NFL[u])
+		{
+			TRI& f = m_Face[fi];
+			if (f.n[0] < 0) continue;
+			if ((f.n[0] == v) || (f.n[1] == v) || (f.n[2] == v)) sharedFaces++;
+			for (int j = 0; j < 3; ++j) mark[f.n[j]] = stamp;
+		}
+		if (sharedFaces != 2) continue;
+
+		int common = 0;
+		nbr.clear();
+		for (int fi : NFL[v])
+		{
+			TRI& f = m_Face[fi];
+			if (f.n[0] < 0) continue;
+			for (int j = 0; j < 3; ++j)
+			{
+				int w = f.n[j];
+				if ((w != u) && (w != v) && (mark[w] == stamp)) { nbr.push_back(w); }
+			}
+		}
+		std::sort(nbr.begin(), nbr.end());
+		common = (int)(std::unique(nbr.begin(), nbr.end()) - nbr.begin());
+		if (common != 2) continue;
+
+		// make sure none of the remaining faces flip
+		bool bflip = false;
+		for (int k = 0; (k < 2) && !bflip; ++k)
+		{
+			for (int fi : NFL[k == 0 ? u : v])
+			{
+				TRI& f = m_Face[fi];
+				if (f.n[0] < 0) continue;
+
+				vec3f r0[3], r1[3];
+				int nuv = 0;
+				for (int j = 0; j < 3; ++j)
+				{
+					r0[j] = m_Node[f.n[j]];
+					if ((f.n[j] == u) || (f.n[j] == v)) { r1[j] = c.r; nuv++; }
+					else r1[j] = r0[j];
+				}
+				if (nuv == 2) continue;
+
+				vec3f n0 = (r0[1] - r0[0]) ^ (r0[2] - r0[0]);
+				vec3f n1 = (r1[1] - r1[0]) ^ (r1[2] - r1[0]);
+				if ((n0*n0 > 0.f) && (n0*n1 <= 0.f)) { bflip = true; break; }
+			}
+		}
+		if (bflip) continue;
+
+		// collapse v into u
+		for (int fi : NFL[v])
+		{
+			TRI& f = m_Face[fi];
+			if (f.n[0] < 0) continue;
+			if ((f.n[0] == u) || (f.n[1] == u) || (f.n[2] == u))
+			{
+				f.n[0] = f.n[1] = f.n[2] = -1;
+				liveFaces--;
+			}
+			else
+			{
+				for (int j = 0; j < 3; ++j) if (f.n[j] == v) f.n[j] = u;
+				NFL[u].push_back(fi);
+			}
+		}
+		NFL[v].clear(); NFL[v].shrink_to_fit();
+
+		std::vector<int>& fl = NFL[u];
+		fl.erase(std::remove_if(fl.begin(), fl.end(), [&](int fi) { return m_Face[fi].n[0] < 0; }), fl.end());
+
+		m_Node[u] = c.r;
+		vec3f nu = m_Norm[u] + m_Norm[v];
+		if (nu.Length() > 0.f) nu.Normalize();
+		m_Norm[u] = nu;
+		Q[u] += Q[v];
+		dead[v] = true;
+		tag[u]++;
+		tag[v]++;
+
+		// re-evaluate the edges around u
+		++stamp;
+		mark[u] = stamp;
+		for (int fi : fl)
+		{
+			TRI& f = m_Face[fi];
+			for (int j = 0; j < 3; ++j)
+			{
+				int w = f.n[j];
+				if (mark[w] != stamp)
+				{
+					mark[w] = stamp;
+					COLLAPSE cw;
+					if (evalCollapse(u, w, cw)) heap.push(cw);
+				}
+			}
+		}
+	}
+
+	// remove the collapsed faces and vertices
+	std::vector<int> newID(NN, -1);
+	std::vector<vec3f> node, norm;
+	node.reserve(NN - std::count(dead.begin(), dead.end(), true));
+	norm.reserve(node.capacity());
+	int faces = 0;
+	for (int i = 0; i < NF; ++i)
+	{
+		TRI f = m_Face[i];
+		if (f.n[0] < 0) continue;
+		for (int j = 0; j < 3; ++j)
+		{
+			int& id = newID[f.n[j]];
+			if (id < 0)
+			{
+				id = (int)node.size();
+				node.push_back(m_Node[f.n[j]]);
+				norm.push_back(m_Norm[f.n[j]]);
+			}
+			f.n[j] = id;
+		}
+		m_Face[faces++] = f;
+	}
+	m_Node.swap(node);
+	m_Norm.swap(norm);
+	m_Face.resize(faces); m_Face.shrink_to_fit();
+}
+
+namespace {
+
+	// part of the iso-surface that is extracted from a slab of voxel layers
+	struct MCSlab
+	{
+		TriMesh	mesh;
+		std::vector<std::pair<int, int> >	bottom;	// (edge, vertex) of the vertices on the bottom plane
+		std::vector<std::pair<int, int> >	top;	// (edge, vertex) of the vertices on the top plane
+	};
+
+	// collect the vertices on the x- and y-edges of a grid layer
+	void get_plane_nodes(const std::vector<int>& layer, std::vector<std::pair<int, int> >& nodes)
+	{
+		nodes.clear();
+		for (int i = 0; i < (int)layer.size(); ++i)
+		{
+			if ((i % 3 != 2) && (layer[i] >= 0)) nodes.push_back(std::pair<int, int>(i, layer[i]));
+		}
+	}
+
+	// Keys of the corner (0-3) and edge (4-7) vertices of a pixel on one of the six bounding planes
+	void cap_keys(long long key[8], int plane, int NA, int NB, int a, int b)
+	{
+		long long g0 = ((long long)plane*NB + b)*NA + a;	// grid point (a  , b  )
+		long long g1 = g0 + 1;								// grid point (a+1, b  )
+		long long g3 = g0 + NA;								// grid point (a  , b+1)
+		long long g2 = g3 + 1;								// grid point (a+1, b+1)
+		key[0] = 3*g0; key[1] = 3*g1; key[2] = 3*g2; key[3] = 3*g3;
+		key[4] = 3*g0 + 1; key[5] = 3*g1 + 2; key[6] = 3*g3 + 1; key[7] = 3*g0 + 2;
+	}
 }
 
 CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
@@ -97,6 +424,7 @@ CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
 	AddColorParam(GLColor::White(), "surface color");
 	AddColorParam(GLColor::White(), "specular color");
 	AddDoubleParam(0, "shininess")->SetFloatRange(0.0, 1.0);
+	AddIntParam(0, "target triangles");
 
 	m_val = 0.5;
 	m_oldVal = -1.0;
@@ -106,6 +434,8 @@ CMarchingCubes::CMarchingCubes(CImageModel* img) : CGLImageRenderer(img)
 	m_col = GLColor(200, 185, 185);
 	m_spc = GLColor(85, 85, 85);
 	m_shininess = 0.25;
+	m_targetFaces = 0;
+	m_surfFaces = 0;
 
     m_del8BitImage = true;
     switch (GetImageModel()->Get3DImage()->PixelType())
@@ -177,6 +507,7 @@ bool CMarchingCubes::UpdateData(bool bsave)
 		if (m_bsmooth != GetBoolValue(SMOOTH)) { m_bsmooth = GetBoolValue(SMOOTH); update = true; }
 		if (m_bcloseSurface != GetBoolValue(CLOSE_SURFACE)) { m_bcloseSurface = GetBoolValue(CLOSE_SURFACE); update = true; };
 		if (m_binvertSpace != GetBoolValue(INVERT_SPACE)) { m_binvertSpace = GetBoolValue(INVERT_SPACE); update = true; }
+		if (m_targetFaces != GetIntValue(TARGET_FACES)) { m_targetFaces = GetIntValue(TARGET_FACES); update = true; }
 		AllowClipping(GetBoolValue(CLIP));
 		m_col = GetColorValue(COLOR);
 		m_spc = GetColorValue(SPECULAR_COLOR);
@@ -194,6 +525,7 @@ bool CMarchingCubes::UpdateData(bool bsave)
 		SetColorValue(COLOR, m_col);
 		SetColorValue(SPECULAR_COLOR, m_spc);
 		SetFloatValue(SHININESS, m_shininess);
+		SetIntValue(TARGET_FACES, m_targetFaces);
 	}
 
 	return false;
@@ -217,6 +549,12 @@ void CMarchingCubes::SetCloseSurface(bool b)
 	m_oldVal = -1.f;
 }
 
+void CMarchingCubes::SetTargetFaces(int n)
+{
+	m_targetFaces = n;
+	m_oldVal = -1.f;
+}
+
 void CMarchingCubes::Update()
 {
 	UpdateData();
@@ -250,25 +588,202 @@ void CMarchingCubes::CreateSurface()
 	float dzi = (b.z1 - b.z0) / (NZ - 1);
 
 	uint8_t ref = (uint8_t)(m_val * 255.0);
-	float fref = (float)ref;
 	m_ref = ref;
 
+	// extract the (welded) iso-surface
+	TriMesh& mesh = m_tri;
+	mesh.Clear();
+	ExtractSurface(mesh);
+
+	// reduce the nr. of triangles
+	if (m_targetFaces > 0) mesh.Decimate(m_targetFaces);
+	m_surfFaces = mesh.Faces();
+
+	// create surface meshes
+	if (m_bcloseSurface)
+	{
+		uint8_t val[4];
+		vec3f r[4];
+		long long key[8];
+
+		// cap vertices are shared between the triangles of the same plane
+		std::unordered_map<long long, int> capNodes;
+
+		// X-planes
+		for (int i = 0; i <= NX - 1; i += NX - 1)
+		{
+			vec3f faceNormal(1.f, 0.f, 0.f);
+
+			float x = (i == 0 ? b.x0 : b.x1);
+
+			for (int k = 0; k < NZ - 1; k++)
+			{
+				for (int j = 0; j < NY - 1; ++j)
+				{
+					// get the pixel's values
+					val[0] = im3d.GetByte(i, j, k);
+					val[1] = im3d.GetByte(i, j + 1, k);
+					val[2] = im3d.GetByte(i, j + 1, k + 1);
+					val[3] = im3d.GetByte(i, j, k + 1);
+
+					// get the corners
+					r[0].x = x; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k*dzi;
+					r[1].x = x; r[1].y = b.y0 + (j + 1)*dyi; r[1].z = b.z0 + k*dzi;
+					r[2].x = x; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = b.z0 + (k + 1)*dzi;
+					r[3].x = x; r[3].y = b.y0 + j      *dyi; r[3].z = b.z0 + (k + 1)*dzi;
+
+					// add the triangles
+					cap_keys(key, (i == 0 ? 0 : 1), NY, NZ, j, k);
+					AddSurfaceTris(mesh, capNodes, key, val, r, faceNormal);
+				}
+			}
+		}
+
+		// Y-planes
+		for (int j = 0; j <= NY - 1; j += NY - 1)
+		{
+			vec3f faceNormal(0.f, -1.f, 0.f);
+
+			float y = (j == 0 ? b.y0 : b.y1);
+
+			for (int k = 0; k < NZ - 1; k++)
+			{
+				for (int i = 0; i < NX - 1; ++i)
+				{
+					// get the pixel's values
+					val[0] = im3d.GetByte(i  , j, k);
+					val[1] = im3d.GetByte(i+1, j, k);
+					val[2] = im3d.GetByte(i+1, j, k + 1);
+					val[3] = im3d.GetByte(i  , j, k + 1);
+
+					// get the corners
+					r[0].x = b.x0 + i    *dxi; r[0].y = y; r[0].z = b.z0 + k*dzi;
+					r[1].x = b.x0 + (i+1)*dxi; r[1].y = y; r[1].z = b.z0 + k*dzi;
+					r[2].x = b.x0 + (i+1)*dxi; r[2].y = y; r[2].z = b.z0 + (k + 1)*dzi;
+					r[3].x = b.x0 + i    *dxi; r[3].y = y; r[3].z = b.z0 + (k + 1)*dzi;
+
+					// add the triangles
+					cap_keys(key, (j == 0 ? 2 : 3), NX, NZ, i, k);
+					AddSurfaceTris(mesh, capNodes, key, val, r, faceNormal);
+				}
+			}
+		}
+
+		// Z-planes
+		for (int k = 0; k <= NZ - 1; k += NZ - 1)
+		{
+			vec3f faceNormal(0.f, 0.f, 1.f);
+
+			float z = (k == 0 ? b.z0 : b.z1);
+
+			for (int j = 0; j < NY - 1; ++j)
+			{
+				for (int i = 0; i < NX - 1; ++i)
+				{
+					// get the pixel's values
+					val[0] = im3d.GetByte(i    , j    , k);
+					val[1] = im3d.GetByte(i + 1, j    , k);
+					val[2] = im3d.GetByte(i + 1, j + 1, k);
+					val[3] = im3d.GetByte(i    , j + 1, k);
+
+					// get the corners
+					r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = z;
+					r[1].x = b.x0 + (i + 1)*dxi; r[1].y = b.y0 + j      *dyi; r[1].z = z;
+					r[2].x = b.x0 + (i + 1)*dxi; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = z;
+					r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = z;
+
+					// add the triangles
+					cap_keys(key, (k == 0 ? 4 : 5), NX, NY, i, j);
+					AddSurfaceTris(mesh, capNodes, key, val, r, faceNormal);
+				}
+			}
+		}
+	}
+
+	// create vertex arrays from mesh
+	int faces = mesh.Faces();
+	m_mesh.Create(faces, GLMesh::FLAG_NORMAL);
+	m_mesh.BeginMesh();
+	for (int i = 0; i < faces; ++i)
+	{
+		TriMesh::TRI& face = mesh.Face(i);
+		if ((m_bsmooth == false) && (i < m_surfFaces))
+		{
+			const vec3f& r0 = mesh.Node(face.n[0]);
+			const vec3f& r1 = mesh.Node(face.n[1]);
+			const vec3f& r2 = mesh.Node(face.n[2]);
+			vec3f normal = (r1 - r0) ^ (r2 - r0);
+			normal.Normalize();
+			for (int j = 0; j < 3; ++j) m_mesh.AddVertex(mesh.Node(face.n[j]), normal);
+		}
+		else
+		{
+			for (int j = 0; j < 3; ++j) m_mesh.AddVertex(mesh.Node(face.n[j]), mesh.Normal(face.n[j]));
+		}
+	}
+	m_mesh.EndMesh();
+}
+
+// Run the marching cubes algorithm over the image. The voxel layers are processed in slabs 
+// that are distributed over the threads. Vertices are shared between the triangles by 
+// hashing the voxel edge they lie on, and the vertices on the planes between two slabs
+// are welded when the slabs are merged.
+void CMarchingCubes::ExtractSurface(TriMesh& mesh)
+{
+	CImageModel& im = *GetImageModel();
+	C3DImage& im3d = *m_8bitImage;
+
+	BOX b = im.GetBoundingBox();
+
+	int NX = im3d.Width();
+	int NY = im3d.Height();
+	int NZ = im3d.Depth();
+
+	float dxi = (b.x1 - b.x0) / (NX - 1);
+	float dyi = (b.y1 - b.y0) / (NY - 1);
+	float dzi = (b.z1 - b.z0) / (NZ - 1);
+
+	uint8_t ref = m_ref;
+	float fref = (float)ref;
+
 	C3DGradientMap grad(im3d, b);
 
-	// construct a mesh object
-	TriMesh mesh;
+	// offset of the voxel corners
+	const int HEX_CORNER[8][3] = { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
 
-	#pragma omp parallel default(shared)
+	// For each voxel edge, the offset of its first grid point and its direction
+	int EDGE_OFFSET[12][4];
+	for (int e = 0; e < 12; ++e)
 	{
-		const int MAX_FACES = 1000000;
-		TriMesh temp;
-		temp.Resize(MAX_FACES);
-		int nfaces = 0;
+		const int* c0 = HEX_CORNER[ET_HEX[e][0]];
+		const int* c1 = HEX_CORNER[ET_HEX[e][1]];
+		for (int l = 0; l < 3; ++l)
+		{
+			EDGE_OFFSET[e][l] = std::min(c0[l], c1[l]);
+			if (c0[l] != c1[l]) EDGE_OFFSET[e][3] = l;
+		}
+	}
+
+	const int SLAB_LAYERS = 16;
+	int nslabs = (NZ - 2) / SLAB_LAYERS + 1;
+	std::vector<MCSlab> slab(nslabs);
+
+	// the edge hash of a grid layer: for each grid point the vertex on the edge in the x, y, and z direction
+	const int layerSize = 3 * NX * NY;
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < nslabs; ++s)
+	{
+		int k0 = s * SLAB_LAYERS;
+		int k1 = std::min(k0 + SLAB_LAYERS, NZ - 1);
+
+		TriMesh& tri = slab[s].mesh;
+		std::vector<int> layer0(layerSize, -1), layer1(layerSize, -1);
+
 		uint8_t val[8];
 		vec3f r[8], g[8];
 
-		#pragma omp for schedule(dynamic, 5)
-		for (int k = 0; k < NZ - 1; ++k)
+		for (int k = k0; k < k1; ++k)
 		{
 			for (int j = 0; j < NY - 1; ++j)
 			{
@@ -345,43 +860,37 @@ void CMarchingCubes::CreateSurface()
 						{
 							if (*pf == -1) break;
 
-							// calculate nodal positions
-							TriMesh::TRI& tri = temp.Face(nfaces++);
+							// find or create the vertices
+							int nv[3];
 							for (int m = 0; m < 3; m++)
 							{
-								int n1 = ET_HEX[pf[m]][0];
-								int n2 = ET_HEX[pf[m]][1];
+								const int* eo = EDGE_OFFSET[pf[m]];
+								std::vector<int>& layer = (eo[2] == 0 ? layer0 : layer1);
+								int& nid = layer[3 * ((i + eo[0]) + NX * (j + eo[1])) + eo[3]];
+								if (nid < 0)
+								{
+									int n1 = ET_HEX[pf[m]][0];
+									int n2 = ET_HEX[pf[m]][1];
 
-								float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-								assert((w >= 0.f) && (w <= 1.f));
+									float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
+									assert((w >= 0.f) && (w <= 1.f));
 
-								tri.m_node[2 - m] = r[n1] * (1.f - w) + r[n2] * w;
+									vec3f normal(0.f, 0.f, 0.f);
+									if (m_bsmooth)
+									{
+										normal = g[n1] * (1.f - w) + g[n2] * w;
+										normal.Normalize();
+										if (m_binvertSpace == false) normal = -normal;
+									}
 
-								if (m_bsmooth)
-								{
-									vec3f normal = g[n1] * (1.f - w) + g[n2] * w;
-									normal.Normalize();
-									tri.m_norm[2 - m] = (m_binvertSpace ? normal : -normal);
+									nid = tri.AddNode(r[n1] * (1.f - w) + r[n2] * w, normal);
 								}
+								nv[2 - m] = nid;
 							}
 
-							if (m_bsmooth == false)
-							{
-								vec3f normal = (tri.m_node[1] - tri.m_node[0]) ^ (tri.m_node[2] - tri.m_node[0]);
-								normal.Normalize();
-								tri.m_norm[0] = normal;
-								tri.m_norm[1] = normal;
-								tri.m_norm[2] = normal;
-							}
+							tri.AddFace(nv[0], nv[1], nv[2]);
 
 							pf += 3;
-
-							if (nfaces == MAX_FACES)
-							{
-								#pragma omp critical
-								mesh.Merge(temp, nfaces);
-								nfaces = 0;
-							}
 						}
 					}
 
@@ -392,119 +901,61 @@ void CMarchingCubes::CreateSurface()
 					val[7] = val[6];
 				}
 			}
+
+			// store the vertices on the bottom plane of the slab, which are shared with the previous slab
+			if (k == k0) get_plane_nodes(layer0, slab[s].bottom);
+
+			// move to the next layer
+			layer0.swap(layer1);
+			std::fill(layer1.begin(), layer1.end(), -1);
 		}
 
-		#pragma omp critical
-		mesh.Merge(temp, nfaces);
+		// the vertices on the top plane are shared with the next slab
+		get_plane_nodes(layer0, slab[s].top);
 	}
 
-	// create surface meshes
-	if (m_bcloseSurface)
-	{
-		uint8_t val[4];
-		vec3f r[4];
+	// merge the slabs
+	size_t nodes = 0, faces = 0;
+	for (MCSlab& sl : slab) { nodes += sl.mesh.Nodes(); faces += sl.mesh.Faces(); }
+	mesh.Reserve(nodes, faces);
 
-		// X-planes
-		for (int i = 0; i <= NX - 1; i += NX - 1)
+	std::vector<std::pair<int, int> > prevTop;	// global vertex IDs on the top plane of the previous slab
+	std::vector<int> gid;
+	for (int s = 0; s < nslabs; ++s)
+	{
+		MCSlab& sl = slab[s];
+		TriMesh& tri = sl.mesh;
+		gid.assign(tri.Nodes(), -1);
+
+		// weld the vertices on the bottom plane to the previous slab
+		// (both lists are sorted by edge)
+		size_t m = 0;
+		for (auto& it : sl.bottom)
 		{
-			vec3f faceNormal(1.f, 0.f, 0.f);
-
-			float x = (i == 0 ? b.x0 : b.x1);
-
-			for (int k = 0; k < NZ - 1; k++)
-			{
-				for (int j = 0; j < NY - 1; ++j)
-				{
-					// get the pixel's values
-					val[0] = im3d.GetByte(i, j, k);
-					val[1] = im3d.GetByte(i, j + 1, k);
-					val[2] = im3d.GetByte(i, j + 1, k + 1);
-					val[3] = im3d.GetByte(i, j, k + 1);
-
-					// get the corners
-					r[0].x = x; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k*dzi;
-					r[1].x = x; r[1].y = b.y0 + (j + 1)*dyi; r[1].z = b.z0 + k*dzi;
-					r[2].x = x; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = b.z0 + (k + 1)*dzi;
-					r[3].x = x; r[3].y = b.y0 + j      *dyi; r[3].z = b.z0 + (k + 1)*dzi;
-
-					// add the triangles
-					AddSurfaceTris(mesh, val, r, faceNormal);
-				}
-			}
+			while ((m < prevTop.size()) && (prevTop[m].first < it.first)) ++m;
+			if ((m < prevTop.size()) && (prevTop[m].first == it.first)) gid[it.second] = prevTop[m].second;
 		}
 
-		// Y-planes
-		for (int j = 0; j <= NY - 1; j += NY - 1)
+		for (int i = 0; i < tri.Nodes(); ++i)
 		{
-			vec3f faceNormal(0.f, -1.f, 0.f);
-
-			float y = (j == 0 ? b.y0 : b.y1);
-
-			for (int k = 0; k < NZ - 1; k++)
-			{
-				for (int i = 0; i < NX - 1; ++i)
-				{
-					// get the pixel's values
-					val[0] = im3d.GetByte(i  , j, k);
-					val[1] = im3d.GetByte(i+1, j, k);
-					val[2] = im3d.GetByte(i+1, j, k + 1);
-					val[3] = im3d.GetByte(i  , j, k + 1);
-
-					// get the corners
-					r[0].x = b.x0 + i    *dxi; r[0].y = y; r[0].z = b.z0 + k*dzi;
-					r[1].x = b.x0 + (i+1)*dxi; r[1].y = y; r[1].z = b.z0 + k*dzi;
-					r[2].x = b.x0 + (i+1)*dxi; r[2].y = y; r[2].z = b.z0 + (k + 1)*dzi;
-					r[3].x = b.x0 + i    *dxi; r[3].y = y; r[3].z = b.z0 + (k + 1)*dzi;
-
-					// add the triangles
-					AddSurfaceTris(mesh, val, r, faceNormal);
-				}
-			}
+			if (gid[i] < 0) gid[i] = mesh.AddNode(tri.Node(i), tri.Normal(i));
 		}
 
-		// Z-planes
-		for (int k = 0; k <= NZ - 1; k += NZ - 1)
+		for (int i = 0; i < tri.Faces(); ++i)
 		{
-			vec3f faceNormal(0.f, 0.f, 1.f);
-
-			float z = (k == 0 ? b.z0 : b.z1);
-
-			for (int j = 0; j < NY - 1; ++j)
-			{
-				for (int i = 0; i < NX - 1; ++i)
-				{
-					// get the pixel's values
-					val[0] = im3d.GetByte(i    , j    , k);
-					val[1] = im3d.GetByte(i + 1, j    , k);
-					val[2] = im3d.GetByte(i + 1, j + 1, k);
-					val[3] = im3d.GetByte(i    , j + 1, k);
-
-					// get the corners
-					r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = z;
-					r[1].x = b.x0 + (i + 1)*dxi; r[1].y = b.y0 + j      *dyi; r[1].z = z;
-					r[2].x = b.x0 + (i + 1)*dxi; r[2].y = b.y0 + (j + 1)*dyi; r[2].z = z;
-					r[3].x = b.x0 + i      *dxi; r[3].y = b.y0 + (j + 1)*dyi; r[3].z = z;
-
-					// add the triangles
-					AddSurfaceTris(mesh, val, r, faceNormal);
-				}
-			}
+			TriMesh::TRI& f = tri.Face(i);
+			mesh.AddFace(gid[f.n[0]], gid[f.n[1]], gid[f.n[2]]);
 		}
-	}
 
-	// create vertex arrays from mesh
-	int faces = mesh.Faces();
-	m_mesh.Create(faces, GLMesh::FLAG_NORMAL);
-	m_mesh.BeginMesh();
-	for (int i = 0; i < faces; ++i)
-	{
-		Post::TriMesh::TRI& face = mesh.Face(i);
-		for (int j = 0; j < 3; ++j) m_mesh.AddVertex(face.m_node[j], face.m_norm[j]);
+		prevTop = sl.top;
+		for (auto& it : prevTop) it.second = gid[it.second];
+
+		// release the slab's memory
+		sl = MCSlab();
 	}
-	m_mesh.EndMesh();
 }
 
-void CMarchingCubes::AddSurfaceTris(TriMesh& mesh, uint8_t val[4], vec3f r[4], const vec3f& faceNormal)
+void CMarchingCubes::AddSurfaceTris(TriMesh& mesh, std::unordered_map<long long, int>& nodeMap, const long long key[8], uint8_t val[4], vec3f r[4], const vec3f& faceNormal)
 {
 	// calculate the case of the voxel
 	int ncase = 0;
@@ -531,28 +982,35 @@ void CMarchingCubes::AddSurfaceTris(TriMesh& mesh, uint8_t val[4], vec3f r[4], c
 	{
 		if (*pf == -1) break;
 
-		// calculate nodal positions
-		TriMesh::TRI tri;
+		// find or create the vertices
+		int nv[3];
 		for (int m = 0; m < 3; m++)
 		{
 			int node = pf[m];
-			if (node < 4)
-			{
-				tri.m_node[m] = r[node];
-			}
+			auto it = nodeMap.find(key[node]);
+			if (it != nodeMap.end()) nv[m] = it->second;
 			else
 			{
-				int n1 = ET2D[node - 4][0];
-				int n2 = ET2D[node - 4][1];
+				vec3f rm;
+				if (node < 4)
+				{
+					rm = r[node];
+				}
+				else
+				{
+					int n1 = ET2D[node - 4][0];
+					int n2 = ET2D[node - 4][1];
 
-				float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
-				tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
-			}
+					float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
+					rm = r[n1] * (1.f - w) + r[n2] * w;
+				}
 
-			tri.m_norm[m] = faceNormal;
+				nv[m] = mesh.AddNode(rm, faceNormal);
+				nodeMap[key[node]] = nv[m];
+			}
 		}
 
-		mesh.AddFace(tri);
+		mesh.AddFace(nv[0], nv[1], nv[2]);
 
 		pf += 3;
 	}
@@ -575,22 +1033,22 @@ void CMarchingCubes::Render(CGLContext& rc)
 
 bool CMarchingCubes::GetMesh(FSMesh& mesh)
 {
-	int nodes = m_mesh.Vertices();
-	int faces = nodes / 3; assert((nodes % 3) == 0);
+	int nodes = m_tri.Nodes();
+	int faces = m_tri.Faces();
 	mesh.Create(nodes, 0, faces);
 	for (int i = 0; i < nodes; ++i)
 	{
-		GLMesh::Vertex v = m_mesh.GetVertex(i);
-		mesh.Node(i).r = to_vec3d(v.r);
+		mesh.Node(i).r = to_vec3d(m_tri.Node(i));
 	}
 
 	for (int i = 0; i < faces; ++i)
 	{
+		const TriMesh::TRI& tri = m_tri.Face(i);
 		FSFace& face = mesh.Face(i);
 		face.SetType(FE_FACE_TRI3);
-		face.n[0] = 3 * i;
-		face.n[1] = 3 * i + 1;
-		face.n[2] = 3 * i + 2;
+		face.n[0] = tri.n[0];
+		face.n[1] = tri.n[1];
+		face.n[2] = tri.n[2];
 	}
 
 	mesh.UpdateNormals();
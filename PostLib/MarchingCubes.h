@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include "GLImageRenderer.h"
 #include <vector>
+#include <unordered_map>
 #include <FSCore/math3d.h>
 #include <FSCore/color.h>
 #include <GLLib/GLMesh.h>
@@ -37,13 +38,13 @@ class C3DImage;
 
 namespace Post {
 
+// Indexed triangle mesh that is generated by the marching cubes algorithm
 class TriMesh
 {
 public:
 	struct TRI
 	{
-		vec3f	m_node[3];
-		vec3f	m_norm[3];
+		int		n[3];	// vertex indices
 	};
 
 public:
@@ -51,24 +52,36 @@ public:
 
 	void Clear();
 
-	void Merge(TriMesh& tri, int ncount = -1);
+	void Reserve(size_t nodes, size_t faces);
 
-	void Reserve(size_t nsize);
+	// append the mesh, offsetting its vertex indices
+	void Merge(const TriMesh& tri);
 
-	void Resize(size_t nsize);
+	int Nodes() const { return (int)m_Node.size(); }
+	const vec3f& Node(int i) const { return m_Node[i]; }
+	const vec3f& Normal(int i) const { return m_Norm[i]; }
 
 	TRI& Face(int i) { return m_Face[i]; }
+	const TRI& Face(int i) const { return m_Face[i]; }
 	int Faces() const { return (int)m_Face.size(); }
 
-	void AddFace(TRI& tri) { m_Face.push_back(tri); }
+	int AddNode(const vec3f& r, const vec3f& n) { m_Node.push_back(r); m_Norm.push_back(n); return (int)m_Node.size() - 1; }
+
+	void AddFace(int n0, int n1, int n2) { TRI t = { n0, n1, n2 }; m_Face.push_back(t); }
+
+	// Reduce the number of triangles to (about) the target count using quadric error metrics.
+	// Vertices on open boundaries are kept fixed.
+	void Decimate(int targetFaces);
 
 protected:
-	std::vector<TRI>	m_Face;
+	std::vector<vec3f>	m_Node;	// vertex positions
+	std::vector<vec3f>	m_Norm;	// vertex normals
+	std::vector<TRI>	m_Face;	// triangles
 };
 
 class CMarchingCubes : public CGLImageRenderer
 {
-	enum { ISO_VALUE, SMOOTH, CLOSE_SURFACE, INVERT_SPACE, CLIP, COLOR, SPECULAR_COLOR, SHININESS };
+	enum { ISO_VALUE, SMOOTH, CLOSE_SURFACE, INVERT_SPACE, CLIP, COLOR, SPECULAR_COLOR, SHININESS, TARGET_FACES };
 
 public:
 	CMarchingCubes(CImageModel* img);
@@ -89,6 +102,10 @@ public:
 	bool GetCloseSurface() const { return m_bcloseSurface; }
 	void SetCloseSurface(bool b);
 
+	// target nr. of triangles of the iso-surface (0 = no decimation)
+	int GetTargetFaces() const { return m_targetFaces; }
+	void SetTargetFaces(int n);
+
 	void Create();
 
 	void Render(CGLContext& rc) override;
@@ -100,7 +117,9 @@ public:
 	bool GetMesh(FSMesh& mesh);
 
 private:
-	void AddSurfaceTris(TriMesh& mesh, uint8_t val[4], vec3f r[4], const vec3f& faceNormal);
+	void AddSurfaceTris(TriMesh& mesh, std::unordered_map<long long, int>& nodeMap, const long long key[8], uint8_t val[4], vec3f r[4], const vec3f& faceNormal);
+
+	void ExtractSurface(TriMesh& mesh);
 
 	void CreateSurface();
 
@@ -118,7 +137,10 @@ private:
 	GLColor	m_spc;
 	double	m_shininess;
 	uint8_t m_ref;
+	int		m_targetFaces;	// target nr. of iso-surface triangles for decimation
 
+	TriMesh		m_tri;		// the surface (iso-surface triangles first, then the caps)
+	int			m_surfFaces;	// nr. of iso-surface triangles in m_tri
 	GLTriMesh	m_mesh;
 
     C3DImage* m_8bitImage;
@@ -0,0 +1,145 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "SpanSpace.h"
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+using namespace Post;
+using namespace std;
+
+// Get the bin of value v (v >= v0) and clamp it to the last bin. This is clamped
+// before the conversion to int, since that conversion is undefined for values 
+// that don't fit in an int.
+static int bin_index(float v, float v0, float dv, int K)
+{
+	float t = (v - v0) / dv;
+	if (!(t < (float)K)) return K - 1;
+	return (t > 0.f ? (int)t : 0);
+}
+
+SpanSpace::SpanSpace()
+{
+	m_v0 = 0.f;
+	m_dv = 1.f;
+}
+
+void SpanSpace::Clear()
+{
+	m_v0 = 0.f;
+	m_dv = 1.f;
+	m_bin.clear();
+	m_item.clear();
+	m_min.clear();
+	m_max.clear();
+}
+
+void SpanSpace::Build(const vector<float>& vmin, const vector<float>& vmax)
+{
+	Clear();
+
+	// find the range of the min values
+	int N = (int)vmin.size();
+	assert(vmax.size() == vmin.size());
+	int items = 0;
+	float fmin = 0.f, fmax = 0.f;
+	for (int i = 0; i < N; ++i)
+	{
+		if (vmin[i] <= vmax[i])
+		{
+			if ((items == 0) || (vmin[i] < fmin)) fmin = vmin[i];
+			if ((items == 0) || (vmin[i] > fmax)) fmax = vmin[i];
+			items++;
+		}
+	}
+	if (items == 0) return;
+
+	// we use about sqrt(N) bins, so that neither the nr. of bins nor the size
+	// of the bins gets too large.
+	int K = (int)sqrt((double)items);
+	if (K < 1) K = 1;
+	m_v0 = fmin;
+	m_dv = (fmax > fmin ? (fmax - fmin) / K : 1.f);
+
+	// count the items in each bin
+	vector<int> bin(N, -1);
+	m_bin.assign(K + 1, 0);
+	for (int i = 0; i < N; ++i)
+	{
+		if (vmin[i] <= vmax[i])
+		{
+			int k = bin_index(vmin[i], m_v0, m_dv, K);
+			bin[i] = k;
+			m_bin[k + 1]++;
+		}
+	}
+	for (int k = 0; k < K; ++k) m_bin[k + 1] += m_bin[k];
+
+	// place the items in their bins
+	m_item.resize(items);
+	vector<int> pos(m_bin.begin(), m_bin.end() - 1);
+	for (int i = 0; i < N; ++i)
+	{
+		if (bin[i] >= 0) m_item[pos[bin[i]]++] = i;
+	}
+
+	// sort each bin by max value (largest first)
+	for (int k = 0; k < K; ++k)
+	{
+		std::sort(m_item.begin() + m_bin[k], m_item.begin() + m_bin[k + 1], [&](int a, int b) {
+			return vmax[a] > vmax[b];
+		});
+	}
+
+	// copy the ranges, so the queries don't need to jump around in memory
+	m_min.resize(items);
+	m_max.resize(items);
+	for (int i = 0; i < items; ++i)
+	{
+		m_min[i] = vmin[m_item[i]];
+		m_max[i] = vmax[m_item[i]];
+	}
+}
+
+void SpanSpace::Find(float v, vector<int>& items) const
+{
+	items.clear();
+	if (m_item.empty() || !std::isfinite(v) || (v < m_v0)) return;
+
+	// only the bins up to (and including) the bin of v can contain items with min <= v
+	int K = (int)m_bin.size() - 1;
+	int kb = bin_index(v, m_v0, m_dv, K);
+
+	for (int k = 0; k <= kb; ++k)
+	{
+		for (int j = m_bin[k]; j < m_bin[k + 1]; ++j)
+		{
+			if (m_max[j] < v) break;
+			if (m_min[j] <= v) items.push_back(m_item[j]);
+		}
+	}
+}
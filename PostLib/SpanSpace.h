@@ -0,0 +1,64 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// Span-space index for a set of items (e.g. elements) that each cover a range
+// of values [min, max]. It finds the items whose range contains a value (e.g.
+// the elements that are cut by an iso-surface) without visiting all items.
+// The items are binned by their min value, and each bin is sorted by max value 
+// (largest first), so a query only touches the bins below the value and stops
+// in each bin at the first item whose max value is too small.
+class SpanSpace
+{
+public:
+	SpanSpace();
+
+	void Clear();
+
+	// Build the index. Item i covers the range [vmin[i], vmax[i]]. Items 
+	// with vmin > vmax are not added to the index.
+	void Build(const std::vector<float>& vmin, const std::vector<float>& vmax);
+
+	// Find the items whose range contains v.
+	void Find(float v, std::vector<int>& items) const;
+
+	// number of items in the index
+	int Items() const { return (int)m_item.size(); }
+
+private:
+	float	m_v0;	// smallest min value
+	float	m_dv;	// bin width
+	std::vector<int>	m_bin;		// start of each bin in the arrays below
+	std::vector<int>	m_item;		// item indices
+	std::vector<float>	m_min;		// min values
+	std::vector<float>	m_max;		// max values
+};
+}
@@ -35,6 +35,9 @@ public:
 
 	void clear();
 
+	// total number of values
+	int size() const { return (int) m_data.size(); }
+
 	int itemSize(int n) const { return m_index[n + 1] - m_index[n]; }
 
 	// append an item with n values
@@ -29,6 +29,7 @@ SOFTWARE.*/
 #include "FEMeshData_T.h"
 #include <MeshLib/MeshMetrics.h>
 #include <MeshLib/MeshTools.h>
+#include <typeinfo>
 using namespace Post;
 using namespace std;
 
@@ -188,7 +189,7 @@ bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 	if ((nstate < 0) || (nstate >= GetStates())) return false;
 
 	// get the state info
-	FEState& state = *m_State[nstate];
+	FEState& state = *GetState(nstate);
 
 	// get the data field
 	int ndata = FIELD_CODE(nfield);
@@ -206,7 +207,7 @@ bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 bool FEPostModel::Evaluate(int nfield, int ntime, bool breset)
 {
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 	if (mesh->Nodes() == 0) return false;
 
@@ -226,25 +227,102 @@ bool FEPostModel::Evaluate(int nfield, int ntime, bool breset)
 }
 
 //-----------------------------------------------------------------------------
-// Evaluate a nodal field
-void FEPostModel::EvalNodeField(int ntime, int nfield)
+namespace {
+
+// get the scalar value of a data value
+inline float field_value(float v, int ncomp) { return v; }
+template <typename T> inline float field_value(const T& v, int ncomp) { return component(v, ncomp); }
+
+// Evaluate a node field for all nodes at once
+template <typename T> bool eval_node_field(FEPostMesh& mesh, FEState& state, Post::FEMeshData& rd, int ncomp)
+{
+	Post::FENodeData_T<T>* pd = dynamic_cast<Post::FENodeData_T<T>*>(&rd);
+	if (pd == nullptr) return false;
+
+	int NN = mesh.Nodes();
+	std::vector<T> v(NN);
+	if (NN > 0) pd->eval_all(&v[0]);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < NN; ++i)
+	{
+		NodeDataRef d = state.m_NODE[i];
+		if (mesh.Node(i).IsEnabled())
+		{
+			d.m_val = field_value(v[i], ncomp);
+			d.m_ntag = 1;
+		}
+		else
+		{
+			d.m_val = 0.f;
+			d.m_ntag = 0;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Evaluate a node field for all nodes of a state. The results are stored in 
+// the state's m_NODE array. The data fields can evaluate all their nodes at once,
+// which can be much faster than calling EvaluateNode for each node.
+void FEPostModel::EvaluateNodes(int ntime, int nfield)
 {
 	assert(IS_NODE_FIELD(nfield));
 
-	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
-	// first, we evaluate all the nodes
-	int i, j;
-	for (i=0; i<mesh->Nodes(); ++i)
+	bool bdone = false;
+	if (state.m_Data.size() > 0)
+	{
+		int ndata = FIELD_CODE(nfield);
+		assert((ndata >= 0) && (ndata < state.m_Data.size()));
+		int ncomp = FIELD_COMP(nfield);
+		FEMeshData& rd = state.m_Data[ndata];
+
+		switch (rd.GetType())
+		{
+		case DATA_FLOAT  : bdone = eval_node_field<float  >(*mesh, state, rd, ncomp); break;
+		case DATA_VEC3F  : bdone = eval_node_field<vec3f  >(*mesh, state, rd, ncomp); break;
+		case DATA_MAT3F  : bdone = eval_node_field<mat3f  >(*mesh, state, rd, ncomp); break;
+		case DATA_MAT3D  : bdone = eval_node_field<mat3d  >(*mesh, state, rd, ncomp); break;
+		case DATA_MAT3FS : bdone = eval_node_field<mat3fs >(*mesh, state, rd, ncomp); break;
+		case DATA_MAT3FD : bdone = eval_node_field<mat3fd >(*mesh, state, rd, ncomp); break;
+		case DATA_TENS4FS: bdone = eval_node_field<tens4fs>(*mesh, state, rd, ncomp); break;
+		default:
+			break;
+		}
+	}
+	if (bdone) return;
+
+	// evaluate one node at a time
+	for (int i=0; i<mesh->Nodes(); ++i)
 	{
 		FSNode& node = mesh->Node(i);
-		NODEDATA& d = state.m_NODE[i];
+		NODEDATA d;
 		d.m_val = 0;
 		d.m_ntag = 0;
 		if (node.IsEnabled()) EvaluateNode(i, ntime, nfield, d);
+		state.m_NODE.m_val[i] = d.m_val;
+		state.m_NODE.m_ntag[i] = d.m_ntag;
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate a nodal field
+void FEPostModel::EvalNodeField(int ntime, int nfield)
+{
+	assert(IS_NODE_FIELD(nfield));
+
+	// get the state data 
+	FEState& state = *GetState(ntime);
+	FEPostMesh* mesh = state.GetFEMesh();
+
+	// first, we evaluate all the nodes
+	EvaluateNodes(ntime, nfield);
+	int i, j;
 
 	// Next, we project the nodal data onto the faces
 	ValArray& faceData = state.m_FaceData;
@@ -267,7 +345,7 @@ void FEPostModel::EvalNodeField(int ntime, int nfield)
 	for (i=0; i<mesh->Elements(); ++i)
 	{
 		FEElement_& e = mesh->ElementRef(i);
-		ELEMDATA& d = state.m_ELEM[i];
+		ElemDataRef d = state.m_ELEM[i];
 		d.m_val = 0.f;
 		d.m_state &= ~StatusFlags::ACTIVE;
 		e.Deactivate();
@@ -288,7 +366,7 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 	assert(IS_FACE_FIELD(nfield));
 
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
 	// get the data ID
@@ -365,7 +443,7 @@ void FEPostModel::EvalFaceField(int ntime, int nfield)
 		ValArray& faceData = state.m_FaceData;
 		for (i=0; i<mesh->Nodes(); ++i)
 		{
-			NODEDATA& node = state.m_NODE[i];
+			NodeDataRef node = state.m_NODE[i];
 			const vector<NodeFaceRef>& nfl = mesh->NodeFaceList(i);
 			node.m_val = 0.f; 
 			node.m_ntag = 0;
@@ -405,46 +483,29 @@ void FEPostModel::EvalElemField(int ntime, int nfield)
 	assert(IS_ELEM_FIELD(nfield));
 
 	// get the state data 
-	FEState& state = *m_State[ntime];
+	FEState& state = *GetState(ntime);
 	FEPostMesh* mesh = state.GetFEMesh();
 
 	// first evaluate all elements
-	float data[FSElement::MAX_NODES] = {0.f};
-	float val;
-	for (int i=0; i<mesh->Elements(); ++i)
-	{
-		FEElement_& el = mesh->ElementRef(i);
-		state.m_ELEM[i].m_val = 0.f;
-		state.m_ELEM[i].m_state &= ~StatusFlags::ACTIVE;
-		el.Deactivate();
-		if (el.IsEnabled()) 
-		{
-			if (EvaluateElement(i, ntime, nfield, data, val))
-			{
-				state.m_ELEM[i].m_state |= StatusFlags::ACTIVE;
-				state.m_ELEM[i].m_val = val;
-				el.Activate();
-				int ne = el.Nodes();
-				for (int j=0; j<ne; ++j) state.m_ElemData.value(i, j) = data[j];
-			}
-		}
-	}
+	EvaluateElements(ntime, nfield);
 
 	// now evaluate the nodes
 	ValArray& elemData = state.m_ElemData;
-	for (int i=0; i<mesh->Nodes(); ++i)
+	int NN = mesh->Nodes();
+#pragma omp parallel for schedule(static)
+	for (int i=0; i<NN; ++i)
 	{
 		FSNode& node = mesh->Node(i);
 		state.m_NODE[i].m_val = 0.f;
 		state.m_NODE[i].m_ntag = 0;
 		if (node.IsEnabled())
 		{
-			const vector<NodeElemRef>& nel = mesh->NodeElemList(i);
+			NodeElemRange nel = mesh->NodeElemList(i);
 			int m = (int) nel.size(), n=0;
 			float val = 0.f;
 			for (int j=0; j<m; ++j)
 			{
-				ELEMDATA& e = state.m_ELEM[nel[j].eid];
+				ElemDataRef e = state.m_ELEM[nel[j].eid];
 				if (e.m_state & StatusFlags::ACTIVE)
 				{
 					val += elemData.value(nel[j].eid, nel[j].nid);
@@ -461,7 +522,9 @@ void FEPostModel::EvalElemField(int ntime, int nfield)
 
 	// evaluate faces
 	ValArray& fd = state.m_FaceData;
-	for (int i=0; i<mesh->Faces(); ++i)
+	int NF = mesh->Faces();
+#pragma omp parallel for schedule(static)
+	for (int i=0; i<NF; ++i)
 	{
 		FSFace& f = mesh->Face(i);
 		FACEDATA& d = state.m_FACE[i];
@@ -478,7 +541,7 @@ void FEPostModel::EvalElemField(int ntime, int nfield)
 			}
 		}
 
-		ELEMDATA& e = state.m_ELEM[eid];
+		ElemDataRef e = state.m_ELEM[eid];
 		if (e.m_state & StatusFlags::ACTIVE)
 		{
 			d.m_ntag = 1;
@@ -855,7 +918,7 @@ void FEPostModel::EvaluateNode(int n, int ntime, int nfield, NODEDATA& d)
 	else if (IS_ELEM_FIELD(nfield))
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		float data[FSElement::MAX_NODES] = {0.f}, val;
 		int ne = (int)nel.size(), n = 0;
 		if (!nel.empty())
@@ -922,7 +985,7 @@ bool FEPostModel::EvaluateFace(int n, int ntime, int nfield, float* data, float&
 	int ntag = 0;
 
 	// get the state
-	FEState& s = *m_State[ntime];
+	FEState& s = *GetState(ntime);
 
 
 	if (IS_FACE_FIELD(nfield))
@@ -1609,6 +1672,151 @@ bool FEPostModel::EvaluateFace(int n, int ntime, int nfield, float* data, float&
 	return (ntag == 1);
 }
 
+//-----------------------------------------------------------------------------
+// Helper functions for evaluating an element field for all elements.
+// When the field is stored in an FEElementData object, the data is accessed with
+// non-virtual calls and the elements are evaluated in parallel. Other fields 
+// (e.g. fields that are calculated on the fly) are evaluated serially.
+namespace {
+
+template <typename T, Data_Format fmt> inline bool elem_active(Post::FEElementData<T, fmt>& d, int n) { return d.Post::FEElementData<T, fmt>::active(n); }
+template <typename T, Data_Format fmt> inline bool elem_active(Post::FEElemData_T<T, fmt>& d, int n) { return d.active(n); }
+
+template <typename T, Data_Format fmt> inline void elem_eval(Post::FEElementData<T, fmt>& d, int n, T* v) { d.Post::FEElementData<T, fmt>::eval(n, v); }
+template <typename T, Data_Format fmt> inline void elem_eval(Post::FEElemData_T<T, fmt>& d, int n, T* v) { d.eval(n, v); }
+
+template <typename T, Data_Format fmt, class D> void eval_elem_kernel(FEPostMesh& mesh, FEState& state, D& df, int ncomp, bool bparallel)
+{
+	ValArray& elemData = state.m_ElemData;
+	int NE = mesh.Elements();
+#pragma omp parallel for schedule(static) if (bparallel)
+	for (int i = 0; i < NE; ++i)
+	{
+		FEElement_& el = mesh.ElementRef(i);
+		ElemDataRef ed = state.m_ELEM[i];
+		ed.m_val = 0.f;
+		ed.m_state &= ~StatusFlags::ACTIVE;
+		el.Deactivate();
+		if (el.IsEnabled() == false) continue;
+
+		int ne = el.Nodes();
+		if (el.IsEroded() || (elem_active(df, i) == false))
+		{
+			for (int j = 0; j < ne; ++j) elemData.value(i, j) = 0.f;
+			continue;
+		}
+
+		T v[FSElement::MAX_NODES];
+		if ((fmt == DATA_ITEM) || (fmt == DATA_REGION))
+		{
+			elem_eval(df, i, v);
+			float val = field_value(v[0], ncomp);
+			for (int j = 0; j < ne; ++j) elemData.value(i, j) = val;
+			ed.m_val = val;
+		}
+		else
+		{
+			for (int j = 0; j < ne; ++j) v[j] = T();
+			elem_eval(df, i, v);
+			float val = 0.f;
+			for (int j = 0; j < ne; ++j)
+			{
+				float vj = field_value(v[j], ncomp);
+				elemData.value(i, j) = vj;
+				val += vj;
+			}
+			ed.m_val = val / (float)ne;
+		}
+
+		ed.m_state |= StatusFlags::ACTIVE;
+		el.Activate();
+	}
+}
+
+template <typename T, Data_Format fmt> bool eval_elem_field(FEPostMesh& mesh, FEState& state, Post::FEMeshData& rd, int ncomp)
+{
+	if (typeid(rd) == typeid(Post::FEElementData<T, fmt>))
+	{
+		eval_elem_kernel<T, fmt>(mesh, state, static_cast<Post::FEElementData<T, fmt>&>(rd), ncomp, true);
+		return true;
+	}
+
+	Post::FEElemData_T<T, fmt>* pd = dynamic_cast<Post::FEElemData_T<T, fmt>*>(&rd);
+	if (pd == nullptr) return false;
+	eval_elem_kernel<T, fmt>(mesh, state, *pd, ncomp, false);
+	return true;
+}
+
+template <typename T> bool eval_elem_field(FEPostMesh& mesh, FEState& state, Post::FEMeshData& rd, int ncomp)
+{
+	switch (rd.GetFormat())
+	{
+	case DATA_NODE  : return eval_elem_field<T, DATA_NODE  >(mesh, state, rd, ncomp);
+	case DATA_ITEM  : return eval_elem_field<T, DATA_ITEM  >(mesh, state, rd, ncomp);
+	case DATA_COMP  : return eval_elem_field<T, DATA_COMP  >(mesh, state, rd, ncomp);
+	case DATA_REGION: return eval_elem_field<T, DATA_REGION>(mesh, state, rd, ncomp);
+	default:
+		break;
+	}
+	return false;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Evaluate an element field for all elements. The results are stored in the 
+// state's m_ELEM and m_ElemData arrays. This gives the same results as calling
+// EvaluateElement for each element, but the data type is only resolved once.
+void FEPostModel::EvaluateElements(int ntime, int nfield)
+{
+	assert(IS_ELEM_FIELD(nfield));
+
+	FEState& state = *GetState(ntime);
+	FEPostMesh* mesh = state.GetFEMesh();
+
+	int ndata = FIELD_CODE(nfield);
+	assert((ndata >= 0) && (ndata < state.m_Data.size()));
+	int ncomp = FIELD_COMP(nfield);
+	FEMeshData& rd = state.m_Data[ndata];
+
+	bool bdone = false;
+	switch (rd.GetType())
+	{
+	case DATA_FLOAT  : bdone = eval_elem_field<float  >(*mesh, state, rd, ncomp); break;
+	case DATA_VEC3F  : bdone = eval_elem_field<vec3f  >(*mesh, state, rd, ncomp); break;
+	case DATA_MAT3D  : bdone = eval_elem_field<mat3d  >(*mesh, state, rd, ncomp); break;
+	case DATA_MAT3F  : bdone = eval_elem_field<mat3f  >(*mesh, state, rd, ncomp); break;
+	case DATA_MAT3FS : bdone = eval_elem_field<mat3fs >(*mesh, state, rd, ncomp); break;
+	case DATA_MAT3FD : bdone = eval_elem_field<mat3fd >(*mesh, state, rd, ncomp); break;
+	case DATA_TENS4FS: bdone = eval_elem_field<tens4fs>(*mesh, state, rd, ncomp); break;
+	default:
+		break;
+	}
+	if (bdone) return;
+
+	// evaluate one element at a time (e.g. array data)
+	float data[FSElement::MAX_NODES] = {0.f};
+	float val;
+	for (int i=0; i<mesh->Elements(); ++i)
+	{
+		FEElement_& el = mesh->ElementRef(i);
+		state.m_ELEM[i].m_val = 0.f;
+		state.m_ELEM[i].m_state &= ~StatusFlags::ACTIVE;
+		el.Deactivate();
+		if (el.IsEnabled()) 
+		{
+			if (EvaluateElement(i, ntime, nfield, data, val))
+			{
+				state.m_ELEM[i].m_state |= StatusFlags::ACTIVE;
+				state.m_ELEM[i].m_val = val;
+				el.Activate();
+				int ne = el.Nodes();
+				for (int j=0; j<ne; ++j) state.m_ElemData.value(i, j) = data[j];
+			}
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 bool FEPostModel::EvaluateElement(int n, int ntime, int nfield, float* data, float& val)
 {
@@ -2198,7 +2406,7 @@ vec3f FEPostModel::EvaluateNodeVector(int n, int ntime, int nvec)
 	else if (IS_ELEM_FIELD(nvec))
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		if (!nel.empty())
 		{
 			int n = 0;
@@ -2521,7 +2729,7 @@ mat3f FEPostModel::EvaluateNodeTensor(int n, int ntime, int nten, int ntype)
 	else 
 	{
 		// we take the average of the elements that contain this element
-		const vector<NodeElemRef>& nel = mesh->NodeElemList(n);
+		NodeElemRange nel = mesh->NodeElemList(n);
 		if (!nel.empty())
 		{
 			for (int i=0; i<(int) nel.size(); ++i) m += EvaluateElemTensor(nel[i].eid, ntime, nten, ntype);
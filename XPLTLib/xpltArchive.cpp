@@ -32,18 +32,6 @@ SOFTWARE.*/
 #include <zlib.h>
 #endif
 
-#ifdef WIN32
-typedef __int64 off_type;
-#endif
-
-#ifdef LINUX // same for Linux and Mac OS X
-typedef off_t off_type;
-#endif
-
-#ifdef __APPLE__ // same for Linux and Mac OS X
-typedef off_t off_type;
-#endif
-
 #ifdef WIN32
 #define ftell64(a)     _ftelli64(a)
 #define fseek64(a,b,c) _fseeki64(a,b,c)
@@ -79,8 +67,10 @@ public:
 
 #ifdef HAVE_ZLIB
 	z_stream		strm;
+	std::vector<unsigned char>	m_in;	// compressed input buffer
 #endif
-	char* m_buf;		// data buffer
+	std::vector<char>	m_pool;		// storage for the data buffer (reused for all top-level chunks)
+	char* m_buf;		// data buffer (points to m_pool while a top-level chunk is open)
 	void* m_pdata;	// data pointer
 	unsigned int	m_bufsize;	// size of data buffer
 
@@ -144,8 +134,11 @@ void xpltArchive::Close()
 	// close the file pointer
 	im.m_fp = 0;
 
-	// delete the buffer
-	if (im.m_buf) delete[] im.m_buf;
+	// delete the buffers
+	std::vector<char>().swap(im.m_pool);
+#ifdef HAVE_ZLIB
+	std::vector<unsigned char>().swap(im.m_in);
+#endif
 	im.m_buf = 0;
 	im.m_pdata = 0;
 	im.m_bufsize = 0;
@@ -259,80 +252,168 @@ bool xpltArchive::Open(FileStream* fp)
 	return true;
 }
 
-bool xpltArchive::DecompressChunk(unsigned int& nid, unsigned int& nsize)
-{
 #ifdef HAVE_ZLIB
-	const int CHUNK = 16384;
-	nsize = -1;
-
-	int ret;
-	unsigned have;
-	static unsigned char in[CHUNK];
-	static unsigned char out[CHUNK];
+// size of the buffer used for reading compressed data from file
+static const unsigned int ZBUF_SIZE = 262144;
 
-	/* allocate inflate state */
-	ret = inflateInit(&im.strm);
-	if (ret != Z_OK) return ret;
+// extra space in the output buffer, so that the end of the stream can be processed in the same call
+static const unsigned int ZBUF_SLACK = 1024;
 
-	// the uncompressed buffer
-	IOMemBuffer buf;
+//-----------------------------------------------------------------------------
+// Inflate the stream into the output buffer until the buffer is full or the stream ends.
+// If fp is not null, the input buffer is refilled from the file when needed.
+static int inflate_buffer(z_stream& strm, char* out, unsigned int size, FileStream* fp, std::vector<unsigned char>& in)
+{
+	strm.next_out = (Bytef*)out;
+	strm.avail_out = size;
 
-	/* decompress until deflate stream ends or end of file */
-	do {
-		if (im.strm.avail_in == 0)
+	int ret = Z_OK;
+	while (strm.avail_out > 0)
+	{
+		if (strm.avail_in == 0)
 		{
-			im.strm.avail_in = im.m_fp->read(in, 1, CHUNK);
-			if (ferror(im.m_fp->FilePtr())) {
-				(void)inflateEnd(&im.strm);
-				return Z_ERRNO;
-			}
-			if (im.strm.avail_in == 0) break;
-			im.strm.next_in = in;
+			if (fp == nullptr) return Z_BUF_ERROR;
+			strm.avail_in = (uInt)fp->read(in.data(), 1, in.size());
+			if (ferror(fp->FilePtr())) return Z_ERRNO;
+			if (strm.avail_in == 0) return Z_BUF_ERROR;
+			strm.next_in = in.data();
 		}
 
-		/* run inflate() on input until output buffer not full */
-		do {
-			im.strm.avail_out = CHUNK;
-			im.strm.next_out = out;
-			ret = inflate(&im.strm, Z_NO_FLUSH);
-			assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-			switch (ret) {
-			case Z_NEED_DICT:
-				ret = Z_DATA_ERROR;     /* and fall through */
-			case Z_DATA_ERROR:
-			case Z_MEM_ERROR:
-				(void)inflateEnd(&im.strm);
-				return ret;
-			}
-			have = CHUNK - im.strm.avail_out;
-
-			buf.append(out, have);
+		ret = inflate(&strm, Z_NO_FLUSH);
+		assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+		switch (ret) {
+		case Z_NEED_DICT:
+			return Z_DATA_ERROR;
+		case Z_DATA_ERROR:
+		case Z_MEM_ERROR:
+		case Z_STREAM_ERROR:
+			return ret;
+		case Z_STREAM_END:
+			return ret;
+		}
+	}
+	return ret;
+}
 
-		} while (im.strm.avail_out == 0);
+//-----------------------------------------------------------------------------
+// Inflate a compressed top-level chunk into buf. The decompressed data starts
+// with the chunk ID and size, so after inflating those we know how large the
+// buffer needs to be and the rest of the chunk is inflated in one go.
+// On return, buf contains the chunk header followed by bytes of chunk data.
+static bool inflate_chunk(z_stream& strm, FileStream* fp, std::vector<unsigned char>& in, bool bswp, std::vector<char>& buf, unsigned int& bytes)
+{
+	bytes = 0;
+	if (inflateInit(&strm) != Z_OK) return false;
 
-		/* done when inflate() says it's done */
-	} while (ret != Z_STREAM_END);
+	// inflate the chunk header
+	const unsigned int HDR = 2 * sizeof(unsigned int);
+	if (buf.size() < HDR) buf.resize(HDR);
+	int ret = inflate_buffer(strm, buf.data(), HDR, fp, in);
+	if (strm.avail_out != 0) ret = Z_DATA_ERROR;
 
-	char* pbuf = buf.data();
-	if (pbuf)
+	if (ret == Z_OK)
 	{
-		memcpy(&nid, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nid);
-		memcpy(&nsize, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nsize);
-
-		im.m_bufsize = buf.size() - 2 * sizeof(int);
-		im.m_buf = new char[im.m_bufsize];
-		memcpy(im.m_buf, pbuf, im.m_bufsize);
-		im.m_pdata = im.m_buf;
+		unsigned int nsize;
+		memcpy(&nsize, buf.data() + sizeof(unsigned int), sizeof(unsigned int));
+		if (bswp) bswap(nsize);
+
+		// inflate the chunk data
+		size_t cap = (size_t)HDR + nsize + ZBUF_SLACK;
+		if (buf.size() < cap) buf.resize(cap);
+		ret = inflate_buffer(strm, buf.data() + HDR, (unsigned int)(buf.size() - HDR), fp, in);
+		bytes = (unsigned int)(buf.size() - HDR) - strm.avail_out;
+
+		// this should not happen, but in case the chunk holds more data than its
+		// size says, keep going until the end of the stream.
+		while (ret == Z_OK)
+		{
+			size_t n0 = buf.size();
+			buf.resize(2 * n0);
+			ret = inflate_buffer(strm, buf.data() + n0, (unsigned int)n0, fp, in);
+			bytes += (unsigned int)n0 - strm.avail_out;
+		}
 	}
 
-	/* clean up and return */
-	(void)inflateEnd(&im.strm);
-//	return (ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
-	return (ret == Z_STREAM_END ? true : false);
+	(void)inflateEnd(&strm);
+	return (ret == Z_STREAM_END);
+}
+#endif
+
+bool xpltArchive::DecompressChunk(unsigned int& nid, unsigned int& nsize)
+{
+#ifdef HAVE_ZLIB
+	nsize = -1;
+	if (im.m_in.size() != ZBUF_SIZE) im.m_in.resize(ZBUF_SIZE);
+
+	unsigned int bytes = 0;
+	bool bret = inflate_chunk(im.strm, im.m_fp, im.m_in, im.m_bswap, im.m_pool, bytes);
+	if (bret == false) return false;
+
+	char* pbuf = im.m_pool.data();
+	memcpy(&nid, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nid);
+	memcpy(&nsize, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nsize);
+
+	im.m_buf = im.m_pool.data();
+	im.m_bufsize = bytes;
+	im.m_pdata = pbuf;
+	return true;
 #endif
 	return false;
 }
 
+bool xpltArchive::ReadBlock(off_type pos, size_t size, std::vector<char>& buf)
+{
+	if (Seek(pos) == false) return false;
+	buf.resize(size);
+	if (size == 0) return true;
+	return (im.m_fp->read(buf.data(), 1, size) == size);
+}
+
+bool xpltArchive::DecompressBlock(const std::vector<char>& src, std::vector<char>& buf, unsigned int& bytes) const
+{
+#ifdef HAVE_ZLIB
+	z_stream strm;
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.next_in = (Bytef*)src.data();
+	strm.avail_in = (uInt)src.size();
+	strm.avail_out = 0;
+
+	std::vector<unsigned char> dummy;
+	return inflate_chunk(strm, nullptr, dummy, im.m_bswap, buf, bytes);
+#else
+	return false;
+#endif
+}
+
+int xpltArchive::OpenChunk(std::vector<char>& buf, unsigned int bytes)
+{
+	// this can only be used for top-level chunks
+	assert(im.m_Chunk.empty());
+	if (buf.size() < 2 * sizeof(unsigned int)) return IO_ERROR;
+
+	unsigned int id, nsize;
+	char* pbuf = buf.data();
+	memcpy(&id, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(id);
+	memcpy(&nsize, pbuf, sizeof(int)); pbuf += sizeof(int); if (im.m_bswap) bswap(nsize);
+
+	// take over the buffer (the caller gets our old buffer, so it can be reused)
+	im.m_pool.swap(buf);
+	im.m_buf = im.m_pool.data();
+	im.m_bufsize = bytes;
+	im.m_pdata = pbuf;
+	im.m_bend = false;
+
+	CHUNK* pc = new CHUNK;
+	pc->id = id;
+	pc->nsize = nsize;
+	pc->pdata = im.m_pdata;
+	im.m_Chunk.push(pc);
+
+	return IO_OK;
+}
+
 
 bool xpltArchive::Append(const char* szfile)
 {
@@ -378,7 +459,8 @@ int xpltArchive::OpenChunk()
 			{
 				// allocate the buffer
 				im.m_bufsize = nsize;
-				im.m_buf = new char[im.m_bufsize];
+				if (im.m_pool.size() < nsize) im.m_pool.resize(nsize);
+				im.m_buf = im.m_pool.data();
 
 				// read the buffer from file
 				int nread = im.m_fp->read(im.m_buf, sizeof(char), nsize);
@@ -445,8 +527,7 @@ void xpltArchive::CloseChunk()
 		// we just deleted the master chunk
 		im.m_bend = true;
 
-		// delete the buffer
-		delete[] im.m_buf;
+		// release the buffer (the storage is kept for the next chunk)
 		im.m_buf = 0;
 		im.m_pdata = 0;
 		im.m_bufsize = 0;
@@ -459,6 +540,42 @@ void xpltArchive::CloseChunk()
 	}
 }
 
+off_type xpltArchive::Tell()
+{
+	off_type pos = ftell64(im.m_fp->FilePtr());
+#ifdef HAVE_ZLIB
+	// The decompression stream may have read past the end of the last chunk.
+	if (im.m_ncompress) pos -= im.strm.avail_in;
+#endif
+	return pos;
+}
+
+bool xpltArchive::Seek(off_type pos)
+{
+	// clear the stack
+	while (im.m_Chunk.empty() == false)
+	{
+		CHUNK* pc = im.m_Chunk.top(); im.m_Chunk.pop();
+		delete pc;
+	}
+
+	// release the buffer
+	im.m_buf = 0;
+	im.m_pdata = 0;
+	im.m_bufsize = 0;
+
+#ifdef HAVE_ZLIB
+	// discard any input that was read ahead
+	im.strm.avail_in = 0;
+	im.strm.next_in = Z_NULL;
+#endif
+
+	if (fseek64(im.m_fp->FilePtr(), pos, SEEK_SET) != 0) return false;
+
+	im.m_bend = false;
+	return true;
+}
+
 unsigned int xpltArchive::GetChunkID()
 {
 	CHUNK* pc = im.m_Chunk.top();
@@ -31,6 +31,18 @@ SOFTWARE.*/
 #include <FSCore/math3d.h>
 #include <FSCore/Archive.h>
 
+#ifdef WIN32
+typedef __int64 off_type;
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+typedef off_t off_type;
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+typedef off_t off_type;
+#endif
+
 //-----------------------------------------------------------------------------
 // Input archive
 class xpltArchive  
@@ -120,6 +132,13 @@ public: // reading
 	// Close a chunk
 	void CloseChunk();
 
+	// Get the file position of the next top-level chunk.
+	// (Only valid in between top-level chunks)
+	off_type Tell();
+
+	// Move to the top-level chunk at the file position returned by Tell.
+	bool Seek(off_type pos);
+
 	// input functions
 	IOResult read(char&   c);
 	IOResult read(int&    n);
@@ -167,6 +186,19 @@ public: // reading
 
 	bool DecompressChunk(unsigned int& nid, unsigned int& nsize);
 
+	// Read size bytes from file, starting at pos (as returned by Tell). This moves
+	// the file position, so call Seek before reading chunks again.
+	bool ReadBlock(off_type pos, size_t size, std::vector<char>& buf);
+
+	// Decompress a top-level chunk that was read with ReadBlock. On return, buf
+	// contains the chunk header followed by bytes of chunk data. This does not
+	// change the archive, so it can be called from multiple threads at once.
+	bool DecompressBlock(const std::vector<char>& src, std::vector<char>& buf, unsigned int& bytes) const;
+
+	// Open a top-level chunk from a buffer that was filled by DecompressBlock. The
+	// archive takes over the buffer's data and returns its previous buffer in buf.
+	int OpenChunk(std::vector<char>& buf, unsigned int bytes);
+
 protected:
 	Imp& im;
 };
@@ -59,11 +59,18 @@ int xpltParser::FileVersion() const
 xpltFileReader::xpltFileReader(Post::FEPostModel* fem) : FEFileReader(fem)
 {
 	m_xplt = 0;
+	m_fs = 0;
 	m_read_state_flag = XPLT_READ_ALL_STATES;
+	m_bpaging = false;
+	m_cacheSize = 0;
 }
 
 xpltFileReader::~xpltFileReader()
 {
+	m_ar.Close();
+	Close();
+	delete m_fs;
+	delete m_xplt;
 }
 
 bool xpltFileReader::Load(const char* szfile)
@@ -72,8 +79,9 @@ bool xpltFileReader::Load(const char* szfile)
 	if (Open(szfile, "rb") == false) return errf("Failed opening file.");
 
 	// attach the file to the archive
-	FileStream fs(m_fp, false);
-	if (m_ar.Open(&fs) == false) return errf("This is not a valid XPLT file.");
+	delete m_fs;
+	m_fs = new FileStream(m_fp, false);
+	if (m_ar.Open(m_fs) == false) return errf("This is not a valid XPLT file.");
 
 	// open the root chunk (no compression for this sectio)
 	m_ar.SetCompression(0);
@@ -112,9 +120,21 @@ bool xpltFileReader::Load(const char* szfile)
 	// load the rest of the file
 	bool bret = m_xplt->Load(*m_fem);
 
-	// clean up
-	m_ar.Close();
-	Close();
+	if (bret && m_xplt->HasPagedStates())
+	{
+		// keep the file open so we can read the states later
+		m_fem->SetStateLoader(this);
+		m_fem->SetStateCacheSize(m_cacheSize);
+
+		// compressed states can be decompressed in parallel, so read a few states at a time
+		m_fem->SetStateReadAhead(m_hdr.ncompression ? 7 : 0);
+	}
+	else
+	{
+		// clean up
+		m_ar.Close();
+		Close();
+	}
 
 	if (m_xplt->warnings() > 0)
 	{
@@ -135,6 +155,26 @@ bool xpltFileReader::Load(const char* szfile)
 }
 
 
+//-----------------------------------------------------------------------------
+bool xpltFileReader::LoadState(Post::FEPostModel& fem, Post::FEState* ps)
+{
+	if ((m_xplt == 0) || (m_fp == 0)) return false;
+	return m_xplt->LoadState(fem, ps);
+}
+
+//-----------------------------------------------------------------------------
+bool xpltFileReader::LoadStates(Post::FEPostModel& fem, std::vector<Post::FEState*>& states)
+{
+	if ((m_xplt == 0) || (m_fp == 0)) return false;
+	return m_xplt->LoadStates(fem, states);
+}
+
+//-----------------------------------------------------------------------------
+size_t xpltFileReader::StateDataSize(Post::FEState* ps)
+{
+	return (m_xplt ? m_xplt->StateDataSize(ps) : 0);
+}
+
 //-----------------------------------------------------------------------------
 bool xpltFileReader::ReadHeader()
 {
@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include "PostLib/FEFileReader.h"
+#include "PostLib/FEPostModel.h"
 #include "xpltArchive.h"
 
 enum XPLT_READ_STATE_FLAG { 
@@ -44,7 +45,7 @@ class xpltParser;
 
 class xpltFileReader;
 
-class xpltParser
+class xpltParser : public Post::FEStateLoader
 {
 public:
 	xpltParser(xpltFileReader* xplt);
@@ -52,6 +53,11 @@ public:
 
 	virtual bool Load(Post::FEPostModel& fem) = 0;
 
+	// Parsers that support state paging only index the states in Load
+	// and read the state data with the FEStateLoader functions.
+	virtual bool HasPagedStates() const { return false; }
+	bool LoadState(Post::FEPostModel& fem, Post::FEState* ps) override { return false; }
+
 	bool errf(const char* sz);
 
 	void addWarning(int n);
@@ -66,7 +72,7 @@ protected:
 	std::vector<int>	m_wrng;	// warning list
 };
 
-class xpltFileReader : public Post::FEFileReader
+class xpltFileReader : public Post::FEFileReader, public Post::FEStateLoader
 {
 protected:
 	// file tags
@@ -110,6 +116,20 @@ public:
 	int GetReadStateFlag() const { return m_read_state_flag; }
 	std::vector<int> GetReadStates() const { return m_state_list; }
 
+	// When state paging is on, the state data is read when a state is first accessed
+	// and the file remains open. In that case, the reader must outlive the model.
+	void SetStatePaging(bool b) { m_bpaging = b; }
+	bool GetStatePaging() const { return m_bpaging; }
+
+	// max memory (in MB) used by loaded states when paging (0 = no limit)
+	void SetStateCacheSize(int MB) { m_cacheSize = MB; }
+	int GetStateCacheSize() const { return m_cacheSize; }
+
+public: // from FEStateLoader
+	bool LoadState(Post::FEPostModel& fem, Post::FEState* ps) override;
+	bool LoadStates(Post::FEPostModel& fem, std::vector<Post::FEState*>& states) override;
+	size_t StateDataSize(Post::FEState* ps) override;
+
 public:
 	xpltArchive& GetArchive() { return m_ar; }
 
@@ -123,11 +143,14 @@ protected:
 private:
 	xpltParser*		m_xplt;
 	xpltArchive		m_ar;
+	FileStream*		m_fs;
 	HEADER			m_hdr;
 
 	// Options
 	int			m_read_state_flag;	//!< flag setting option for reading states
 	std::vector<int>	m_state_list;		//!< list of states to read (only when m_read_state_flag == XPLT_READ_STATES_FROM_LIST)
+	bool		m_bpaging;			//!< only index the states and read them on demand
+	int			m_cacheSize;		//!< max memory (MB) of loaded states
 
 	friend class xpltParser;
 };
@@ -1228,8 +1228,8 @@ bool XpltReader::ReadStateSection(FEPostModel& fem)
 		float h[FSElement::MAX_NODES] = {0.f};
 		for (int i=0; i<NE; ++i)
 		{
-			ELEMDATA& d = ps->m_ELEM[i];
-			if (df.active(i))
+			ElemDataRef d = ps->m_ELEM[i];
+			if (df.active(i) && d.m_h)
 			{
 				df.eval(i, h);
 				int n = mesh.ElementRef(i).Nodes();
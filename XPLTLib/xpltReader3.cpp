@@ -138,6 +138,7 @@ XpltReader3::XpltReader3(xpltFileReader* xplt) : xpltParser(xplt)
 {
 	m_pstate = 0;
 	m_mesh = 0;
+	m_nxmesh = 0;
 }
 
 XpltReader3::~XpltReader3()
@@ -157,6 +158,9 @@ void XpltReader3::Clear()
 	m_bHasElasticity = false;
 	m_nel = 0;
 	m_pstate = 0;
+	m_stateIndex.clear();
+	m_xmeshList.clear();
+	m_nxmesh = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -195,16 +199,29 @@ bool XpltReader3::Load(FEPostModel& fem)
 	const xpltFileReader::HEADER& hdr = m_xplt->GetHeader();
 	m_ar.SetCompression(hdr.ncompression);
 	int read_state_flag = m_xplt->GetReadStateFlag();
+	bool paging = m_xplt->GetStatePaging();
 	int nstate = 0;
 	try{
 		while (true)
 		{
+			// remember where this section starts, in case we need to come back
+			off_type pos = m_ar.Tell();
+
 			if (m_ar.OpenChunk() != xpltArchive::IO_OK) break;
 
+			bool bindexed = false;
+			FEState* pindexed = 0;
 			if (m_ar.GetChunkID() == PLT_STATE)
 			{
 				if (m_pstate) { delete m_pstate; m_pstate = 0; }
-				if (ReadStateSection(fem) == false) break;
+				if (paging)
+				{
+					m_entry.pos = pos;
+					if (IndexStateSection(fem) == false) break;
+					bindexed = true;
+				}
+				else if (ReadStateSection(fem) == false) break;
+				FEState* ps = m_pstate;
 				if (read_state_flag == XPLT_READ_ALL_STATES) { fem.AddState(m_pstate); m_pstate = 0; }
 				else if (read_state_flag == XPLT_READ_ALL_CONVERGED_STATES) 
 				{ 
@@ -228,13 +245,27 @@ bool XpltReader3::Load(FEPostModel& fem)
 						}
 					}
 				}
+
+				// remember the indexed states that were added
+				if (paging && (m_pstate == 0)) pindexed = ps;
 			}
 			else if (m_ar.GetChunkID() == PLT_MESH)
 			{
+				if (paging)
+				{
+					// indexed states may still need the current mesh
+					m_xmeshList.resize(fem.Meshes());
+					m_xmeshList[m_nxmesh] = m_xmesh;
+					m_nxmesh = fem.Meshes();
+				}
 				if (ReadMesh(fem) == false) return errf("Error while reading mesh section.");
 			}
 			else errf("Error while reading state data.");
 			m_ar.CloseChunk();
+
+			// store the file position and size of the state section
+			if (bindexed) m_entry.fsize = m_ar.Tell() - m_entry.pos;
+			if (pindexed) m_stateIndex[pindexed] = m_entry;
 		
 			// clear end-flag
 			if (m_ar.OpenChunk() != xpltArchive::IO_END)
@@ -245,18 +276,124 @@ bool XpltReader3::Load(FEPostModel& fem)
 
 			++nstate;
 		}
-		if (read_state_flag == XPLT_READ_LAST_STATE_ONLY) { fem.AddState(m_pstate); m_pstate = 0; }
+		if (read_state_flag == XPLT_READ_LAST_STATE_ONLY)
+		{
+			fem.AddState(m_pstate);
+			if (paging) m_stateIndex[m_pstate] = m_entry;
+			m_pstate = 0;
+		}
 	}
 	catch (...)
 	{
 		errf("An unknown exception has occurred.\nNot all data was read in.");
 	}
 
-	Clear();
+	if (HasPagedStates())
+	{
+		// we'll need the dictionary and meshes for reading the states later
+		if (m_pstate) { delete m_pstate; m_pstate = 0; }
+		m_xmeshList.resize(fem.Meshes());
+	}
+	else Clear();
 
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Read the data of a state that was indexed in Load.
+bool XpltReader3::LoadState(FEPostModel& fem, FEState* ps)
+{
+	map<FEState*, STATE_ENTRY>::iterator it = m_stateIndex.find(ps);
+	if (it == m_stateIndex.end()) return false;
+	STATE_ENTRY& entry = it->second;
+
+	// make sure we use the mesh this state was written for
+	SetActiveMesh(fem, entry.mesh);
+
+	// go to the state section
+	const xpltFileReader::HEADER& hdr = m_xplt->GetHeader();
+	m_ar.SetCompression(hdr.ncompression);
+	if (m_ar.Seek(entry.pos) == false) return errf("Failed to find state section.");
+	if (m_ar.OpenChunk() != xpltArchive::IO_OK) return errf("Error while reading state data.");
+
+	bool bret = false;
+	if (m_ar.GetChunkID() == PLT_STATE) bret = ReadStateData(fem, ps);
+	else errf("Error while reading state data.");
+	m_ar.CloseChunk();
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+// Read the data of several states that were indexed in Load. For compressed files,
+// the state sections are decompressed in parallel before the data is read.
+bool XpltReader3::LoadStates(FEPostModel& fem, vector<FEState*>& states)
+{
+	const xpltFileReader::HEADER& hdr = m_xplt->GetHeader();
+	int N = (int)states.size();
+	if ((hdr.ncompression == 0) || (N < 2)) return FEStateLoader::LoadStates(fem, states);
+
+	// read the compressed state sections from file
+	vector<STATE_ENTRY*> entry(N, nullptr);
+	vector< vector<char> > src(N);
+	for (int i = 0; i < N; ++i)
+	{
+		map<FEState*, STATE_ENTRY>::iterator it = m_stateIndex.find(states[i]);
+		if (it == m_stateIndex.end()) continue;
+		if (m_ar.ReadBlock(it->second.pos, (size_t)it->second.fsize, src[i])) entry[i] = &(it->second);
+	}
+
+	// decompress them
+	vector< vector<char> > buf(N);
+	vector<unsigned int> bytes(N, 0);
+	vector<int> ok(N, 0);
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < N; ++i)
+	{
+		if (entry[i]) ok[i] = (m_ar.DecompressBlock(src[i], buf[i], bytes[i]) ? 1 : 0);
+		vector<char>().swap(src[i]);
+	}
+
+	// read the state data
+	bool bret = true;
+	for (int i = 0; i < N; ++i)
+	{
+		if (ok[i] == 0) { bret = errf("Error while reading state data."); continue; }
+
+		// make sure we use the mesh this state was written for
+		SetActiveMesh(fem, entry[i]->mesh);
+
+		if (m_ar.OpenChunk(buf[i], bytes[i]) != xpltArchive::IO_OK) { bret = errf("Error while reading state data."); continue; }
+		if (m_ar.GetChunkID() == PLT_STATE)
+		{
+			if (ReadStateData(fem, states[i]) == false) bret = false;
+		}
+		else bret = errf("Error while reading state data.");
+		m_ar.CloseChunk();
+	}
+
+	return bret;
+}
+
+//-----------------------------------------------------------------------------
+size_t XpltReader3::StateDataSize(FEState* ps)
+{
+	map<FEState*, STATE_ENTRY>::iterator it = m_stateIndex.find(ps);
+	return (it != m_stateIndex.end() ? it->second.size : 0);
+}
+
+//-----------------------------------------------------------------------------
+// Make mesh n the current mesh (only used when paging)
+void XpltReader3::SetActiveMesh(FEPostModel& fem, int n)
+{
+	if (n == m_nxmesh) return;
+	m_xmeshList[m_nxmesh] = m_xmesh;
+	m_xmesh = m_xmeshList[n];
+	m_xmeshList[n].Clear();
+	m_nxmesh = n;
+	m_mesh = fem.GetFEMesh(n);
+}
+
 //-----------------------------------------------------------------------------
 bool XpltReader3::ReadRootSection(FEPostModel& fem)
 {
@@ -1593,6 +1730,43 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 		return errf("Error allocating memory for state data");
 	}
 
+	return ReadStateData(fem, ps);
+}
+
+//-----------------------------------------------------------------------------
+// Only reads the state header. The state data is read later by LoadState.
+bool XpltReader3::IndexStateSection(FEPostModel& fem)
+{
+	// create a state without allocating any data
+	FEState* ps = m_pstate = new FEState(0.f, &fem, GetCurrentMesh(), false);
+
+	m_entry.size = m_ar.GetChunkSize();
+	m_entry.mesh = m_nxmesh;
+
+	while (m_ar.OpenChunk() == xpltArchive::IO_OK)
+	{
+		if (m_ar.GetChunkID() == PLT_STATE_HEADER)
+		{
+			while (m_ar.OpenChunk() == xpltArchive::IO_OK)
+			{
+				int nid = m_ar.GetChunkID();
+				if (nid == PLT_STATE_HDR_TIME) m_ar.read(ps->m_time);
+				if (nid == PLT_STATE_STATUS  ) m_ar.read(ps->m_status);
+				m_ar.CloseChunk();
+			}
+		}
+		m_ar.CloseChunk();
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool XpltReader3::ReadStateData(FEPostModel& fem, FEState* ps)
+{
+	// get the mesh
+	Post::FEPostMesh& mesh = *GetCurrentMesh();
+
 	while (m_ar.OpenChunk() == xpltArchive::IO_OK)
 	{
 		int nid = m_ar.GetChunkID();
@@ -1709,7 +1883,7 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 
 								assert((nv >= 0) && (nv < po->m_data.size()));
 
-								ObjectData* pd = m_pstate->m_objPt[objId].data;
+								ObjectData* pd = ps->m_objPt[objId].data;
 
 								switch (po->m_data[nv]->Type())
 								{
@@ -1768,7 +1942,7 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 
 								assert((nv >= 0) && (nv < po->m_data.size()));
 
-								ObjectData* pd = m_pstate->m_objLn[objId].data;
+								ObjectData* pd = ps->m_objLn[objId].data;
 
 								switch (po->m_data[nv]->Type())
 								{
@@ -1800,8 +1974,8 @@ bool XpltReader3::ReadStateSection(FEPostModel& fem)
 		float h[FSElement::MAX_NODES] = {0.f};
 		for (int i=0; i<NE; ++i)
 		{
-			ELEMDATA& d = ps->m_ELEM[i];
-			if (df.active(i))
+			ElemDataRef d = ps->m_ELEM[i];
+			if (df.active(i) && d.m_h)
 			{
 				df.eval(i, h);
 				int n = mesh.ElementRef(i).Nodes();
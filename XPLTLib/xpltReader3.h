@@ -27,6 +27,7 @@ SOFTWARE.*/
 #pragma once
 #include "xpltFileReader.h"
 #include <MeshLib/FEElement.h>
+#include <map>
 
 namespace Post {
 	class FEState;
@@ -371,9 +372,19 @@ public:
 
 	bool Load(Post::FEPostModel& fem);
 
+	// state paging
+	bool HasPagedStates() const override { return (m_stateIndex.empty() == false); }
+	bool LoadState(Post::FEPostModel& fem, Post::FEState* ps) override;
+	bool LoadStates(Post::FEPostModel& fem, std::vector<Post::FEState*>& states) override;
+	size_t StateDataSize(Post::FEState* ps) override;
+
 protected:
 	bool ReadRootSection(Post::FEPostModel& fem);
 	bool ReadStateSection(Post::FEPostModel& fem);
+	bool IndexStateSection(Post::FEPostModel& fem);
+	bool ReadStateData(Post::FEPostModel& fem, Post::FEState* ps);
+
+	void SetActiveMesh(Post::FEPostModel& fem, int n);
 
 	bool ReadDictionary(Post::FEPostModel& fem);
 	bool ReadMesh(Post::FEPostModel& fem);
@@ -440,4 +451,18 @@ protected:
 
 	Post::FEState*	m_pstate;	//!< last read state section
 	Post::FEPostMesh*	m_mesh;		//!< current mesh
+
+	// state paging
+	struct STATE_ENTRY
+	{
+		off_type		pos;	// file position of state section
+		unsigned int	size;	// size of the (uncompressed) state section
+		off_type		fsize;	// size of the state section in the file
+		int				mesh;	// index of the mesh this state uses
+	};
+
+	std::map<Post::FEState*, STATE_ENTRY>	m_stateIndex;	//!< file positions of states
+	std::vector<XMesh>	m_xmeshList;	//!< meshes read so far (only used when paging)
+	int					m_nxmesh;		//!< index of mesh in m_xmesh
+	STATE_ENTRY			m_entry;		//!< entry of the last indexed state
 };